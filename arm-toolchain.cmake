@@ -9,6 +9,7 @@ set(TOOLCHAIN_PREFIX arm-none-eabi-)
 
 # Find the toolchain programs
 find_program(CMAKE_C_COMPILER ${TOOLCHAIN_PREFIX}gcc)
+find_program(CMAKE_CXX_COMPILER ${TOOLCHAIN_PREFIX}g++)
 find_program(CMAKE_ASM_COMPILER ${TOOLCHAIN_PREFIX}gcc)
 find_program(CMAKE_OBJCOPY ${TOOLCHAIN_PREFIX}objcopy)
 find_program(CMAKE_OBJDUMP ${TOOLCHAIN_PREFIX}objdump)
@@ -16,6 +17,7 @@ find_program(CMAKE_SIZE ${TOOLCHAIN_PREFIX}size)
 
 # Set compilers
 set(CMAKE_C_COMPILER ${TOOLCHAIN_PREFIX}gcc)
+set(CMAKE_CXX_COMPILER ${TOOLCHAIN_PREFIX}g++)
 set(CMAKE_ASM_COMPILER ${TOOLCHAIN_PREFIX}gcc)
 set(CMAKE_AR ${TOOLCHAIN_PREFIX}ar)
 set(CMAKE_RANLIB ${TOOLCHAIN_PREFIX}ranlib)
@@ -26,11 +28,17 @@ set(CPU_FLAGS "-mcpu=cortex-m4 -mthumb -mfloat-abi=soft")
 # Common flags
 set(CMAKE_C_FLAGS_INIT "${CPU_FLAGS} -ffunction-sections -fdata-sections -fno-common -Wall -Wextra")
 set(CMAKE_ASM_FLAGS_INIT "${CPU_FLAGS}")
+
+# C++ (include/rtos.hpp): no exceptions, RTTI or runtime support from libstdc++
+set(CMAKE_CXX_FLAGS_INIT "${CPU_FLAGS} -ffunction-sections -fdata-sections -fno-common -Wall -Wextra \
+-fno-exceptions -fno-rtti -fno-threadsafe-statics -fno-use-cxa-atexit")
 set(CMAKE_EXE_LINKER_FLAGS_INIT "${CPU_FLAGS} -Wl,--gc-sections -nostartfiles -nostdlib")
 
 # Debug flags
 set(CMAKE_C_FLAGS_DEBUG "-O0 -g3 -DDEBUG")
 set(CMAKE_C_FLAGS_RELEASE "-O2 -DNDEBUG")
+set(CMAKE_CXX_FLAGS_DEBUG "-O0 -g3 -DDEBUG")
+set(CMAKE_CXX_FLAGS_RELEASE "-O2 -DNDEBUG")
 
 # Don't run the linker during compiler tests
 set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)
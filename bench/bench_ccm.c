@@ -0,0 +1,241 @@
+/**
+ * @file bench_ccm.c
+ * @brief CCM vs SRAM Placement Benchmark
+ *
+ * Measures the two kernel paths most sensitive to where their data lives:
+ * - Context switch: two tasks ping-pong through semaphores, with their
+ *   stacks and TCBs either in SRAM or in CCM.
+ * - Queue copy: send/receive of a 64-byte message with the queue storage
+ *   and the message buffers either in SRAM or in CCM.
+ *
+ * A memory-to-memory DMA stream runs a continuous copy between SRAM
+ * buffers during the loaded runs, to show bus matrix contention.
+ * Cycle counts come from the DWT cycle counter, or from SysTick where the
+ * DWT is not implemented (QEMU). g_kernel itself follows RTOS_KERNEL_IN_CCM,
+ * so build once with each setting to compare kernel data placement too.
+ */
+
+#include "rtos.h"
+#include "hal.h"
+#include "stm32f4xx.h"
+#include "bench_cycles.h"
+
+/*---------------------------------------------------------------------------*/
+/* Configuration */
+/*---------------------------------------------------------------------------*/
+
+#define BENCH_STACK_SIZE    256     /* Stack size in words */
+#define BENCH_SWITCHES      1000    /* Ping-pong round trips per run */
+#define BENCH_QUEUE_OPS     1000    /* Send/receive pairs per run */
+#define BENCH_MSG_SIZE      64      /* Queue message size in bytes */
+#define BENCH_QUEUE_DEPTH   4
+#define BENCH_DMA_WORDS     4096    /* Background DMA copy size */
+
+/*---------------------------------------------------------------------------*/
+/* Context Switch Pairs */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    const char *name;
+    rtos_sem_t start;
+    rtos_sem_t ping;
+    rtos_sem_t pong;
+    rtos_sem_t done;
+    uint32_t cycles;
+} bench_pair_t;
+
+static bench_pair_t sram_pair = { .name = "SRAM" };
+static bench_pair_t ccm_pair = { .name = "CCM" };
+
+static uint32_t sram_stack_a[BENCH_STACK_SIZE];
+static uint32_t sram_stack_b[BENCH_STACK_SIZE];
+static rtos_tcb_t sram_tcb_a;
+static rtos_tcb_t sram_tcb_b;
+
+static RTOS_CCM uint32_t ccm_stack_a[BENCH_STACK_SIZE];
+static RTOS_CCM uint32_t ccm_stack_b[BENCH_STACK_SIZE];
+static RTOS_CCM rtos_tcb_t ccm_tcb_a;
+static RTOS_CCM rtos_tcb_t ccm_tcb_b;
+
+/* Lower priority side: every post wakes the responder, which preempts */
+static void pinger_fn(void *arg) {
+    bench_pair_t *pair = (bench_pair_t *)arg;
+
+    while (1) {
+        rtos_sem_wait(&pair->start, RTOS_WAIT_FOREVER);
+
+        uint32_t start = bench_cycles();
+        for (uint32_t i = 0; i < BENCH_SWITCHES; i++) {
+            rtos_sem_post(&pair->ping);
+            rtos_sem_wait(&pair->pong, RTOS_WAIT_FOREVER);
+        }
+        pair->cycles = bench_cycles() - start;
+
+        rtos_sem_post(&pair->done);
+    }
+}
+
+static void responder_fn(void *arg) {
+    bench_pair_t *pair = (bench_pair_t *)arg;
+
+    while (1) {
+        rtos_sem_wait(&pair->ping, RTOS_WAIT_FOREVER);
+        rtos_sem_post(&pair->pong);
+    }
+}
+
+static void bench_pair_init(bench_pair_t *pair) {
+    rtos_sem_init(&pair->start, 0);
+    rtos_sem_init(&pair->ping, 0);
+    rtos_sem_init(&pair->pong, 0);
+    rtos_sem_init(&pair->done, 0);
+}
+
+static uint32_t bench_pair_run(bench_pair_t *pair) {
+    rtos_sem_post(&pair->start);
+    rtos_sem_wait(&pair->done, RTOS_WAIT_FOREVER);
+
+    /* Two switches per round trip */
+    return pair->cycles / (BENCH_SWITCHES * 2);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Queue Copy */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    rtos_queue_t queue;
+    uint8_t storage[BENCH_MSG_SIZE * BENCH_QUEUE_DEPTH];
+    uint8_t tx[BENCH_MSG_SIZE];
+    uint8_t rx[BENCH_MSG_SIZE];
+} bench_queue_t;
+
+static bench_queue_t sram_queue;
+static RTOS_CCM bench_queue_t ccm_queue;
+
+static uint32_t bench_queue_run(bench_queue_t *bq) {
+    rtos_queue_init(&bq->queue, bq->storage, BENCH_MSG_SIZE, BENCH_QUEUE_DEPTH);
+
+    uint32_t start = bench_cycles();
+    for (uint32_t i = 0; i < BENCH_QUEUE_OPS; i++) {
+        rtos_queue_send(&bq->queue, bq->tx, RTOS_NO_WAIT);
+        rtos_queue_recv(&bq->queue, bq->rx, RTOS_NO_WAIT);
+    }
+    return (bench_cycles() - start) / BENCH_QUEUE_OPS;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Background DMA Load */
+/*---------------------------------------------------------------------------*/
+
+static uint32_t dma_src[BENCH_DMA_WORDS];
+static uint32_t dma_dst[BENCH_DMA_WORDS];
+static hal_dma_handle_t dma_load;
+static volatile uint8_t dma_load_on;
+
+static void dma_load_irq(uint32_t flags, void *arg) {
+    (void)arg;
+
+    /* Re-arm for as long as the loaded run lasts */
+    if ((flags & DMA_FLAG_TC) && dma_load_on) {
+        hal_dma_start(&dma_load, (uint32_t)dma_src, dma_dst, NULL, BENCH_DMA_WORDS);
+    }
+}
+
+static void dma_load_init(void) {
+    hal_dma_config_t cfg = {
+        .channel = 0,
+        .direction = HAL_DMA_MEM_TO_MEM,
+        .periph_size = HAL_DMA_SIZE_WORD,
+        .mem_size = HAL_DMA_SIZE_WORD,
+        .periph_inc = 1,
+        .mem_inc = 1,
+        .priority = 3,
+    };
+
+    hal_dma_alloc(&dma_load, DMA2, HAL_DMA_ANY_STREAM);
+    hal_dma_configure(&dma_load, &cfg);
+    hal_dma_set_callback(&dma_load, dma_load_irq, NULL);
+}
+
+static void dma_load_set(uint8_t on) {
+    dma_load_on = on;
+    if (on) {
+        hal_dma_start(&dma_load, (uint32_t)dma_src, dma_dst, NULL, BENCH_DMA_WORDS);
+    } else {
+        hal_dma_stop(&dma_load);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Controller */
+/*---------------------------------------------------------------------------*/
+
+static uint32_t ctrl_stack[BENCH_STACK_SIZE];
+static rtos_tcb_t ctrl_tcb;
+
+static void bench_report(const char *test, const char *load,
+                         uint32_t sram, uint32_t ccm) {
+    hal_printf("%s,%s,%u,%u\n", test, load, sram, ccm);
+}
+
+static void ctrl_fn(void *arg) {
+    (void)arg;
+
+    bench_timer_init();
+    dma_load_init();
+
+    hal_printf("[BENCH] g_kernel in %s, counter: %s\n",
+               RTOS_KERNEL_IN_CCM ? "CCM" : "SRAM",
+               bench_use_dwt ? "DWT" : "SysTick");
+    hal_printf("test,load,sram_cycles,ccm_cycles\n");
+
+    for (uint8_t load = 0; load < 2; load++) {
+        const char *load_name = load ? "dma" : "idle";
+
+        dma_load_set(load);
+
+        uint32_t sram = bench_pair_run(&sram_pair);
+        uint32_t ccm = bench_pair_run(&ccm_pair);
+        bench_report("context_switch", load_name, sram, ccm);
+
+        sram = bench_queue_run(&sram_queue);
+        ccm = bench_queue_run(&ccm_queue);
+        bench_report("queue_copy_64", load_name, sram, ccm);
+
+        dma_load_set(0);
+    }
+
+    hal_printf("[BENCH] done\n");
+
+    while (1) {
+        rtos_delay(1000);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Main Entry Point */
+/*---------------------------------------------------------------------------*/
+
+int main(void) {
+    hal_system_init();
+    rtos_init();
+
+    bench_pair_init(&sram_pair);
+    bench_pair_init(&ccm_pair);
+
+    rtos_task_create(ctrl_fn, "BENCH", 0, ctrl_stack, BENCH_STACK_SIZE,
+                     &ctrl_tcb, NULL);
+    rtos_task_create(pinger_fn, "PING_S", 2, sram_stack_a, BENCH_STACK_SIZE,
+                     &sram_tcb_a, &sram_pair);
+    rtos_task_create(responder_fn, "PONG_S", 1, sram_stack_b, BENCH_STACK_SIZE,
+                     &sram_tcb_b, &sram_pair);
+    rtos_task_create(pinger_fn, "PING_C", 2, ccm_stack_a, BENCH_STACK_SIZE,
+                     &ccm_tcb_a, &ccm_pair);
+    rtos_task_create(responder_fn, "PONG_C", 1, ccm_stack_b, BENCH_STACK_SIZE,
+                     &ccm_tcb_b, &ccm_pair);
+
+    rtos_start();
+
+    return 0;
+}
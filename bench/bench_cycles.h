@@ -0,0 +1,53 @@
+/**
+ * @file bench_cycles.h
+ * @brief Benchmark Cycle Counter
+ *
+ * Shared by the benchmark images. Cycle counts come from the DWT cycle
+ * counter, or from SysTick where the DWT is not implemented (QEMU).
+ * Each image includes this from its single benchmark source.
+ */
+
+#ifndef BENCH_CYCLES_H
+#define BENCH_CYCLES_H
+
+#include <stdint.h>
+#include "rtos.h"
+#include "stm32f4xx.h"
+
+static uint8_t bench_use_dwt;
+
+/**
+ * @brief Enable the DWT cycle counter and check that it counts
+ */
+static inline void bench_timer_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA;
+
+    /* The counter is RAZ where DWT is not modelled */
+    uint32_t start = DWT->CYCCNT;
+    for (volatile uint32_t i = 0; i < 100; i++) {
+    }
+    bench_use_dwt = (DWT->CYCCNT != start) ? 1 : 0;
+}
+
+/**
+ * @brief Read the free-running cycle count
+ */
+static inline uint32_t bench_cycles(void) {
+    if (bench_use_dwt) {
+        return DWT->CYCCNT;
+    }
+
+    /* Tick count * reload + elapsed part of the current tick */
+    uint32_t tick;
+    uint32_t val;
+    do {
+        tick = rtos_now();
+        val = SysTick->VAL;
+    } while (tick != rtos_now());
+
+    return tick * (SysTick->LOAD + 1) + (SysTick->LOAD - val);
+}
+
+#endif /* BENCH_CYCLES_H */
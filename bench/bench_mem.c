@@ -0,0 +1,144 @@
+/**
+ * @file bench_mem.c
+ * @brief Kernel memcpy/memset vs newlib Benchmark
+ *
+ * Times newlib's memcpy/memset against rtos_memcpy/rtos_memset, and the
+ * inlined rtos_memcpy_msg for the fixed message sizes, across sizes from
+ * 4 bytes to 4 KB. Each size runs with word-aligned buffers and with the
+ * source one byte off, to exercise the unaligned paths.
+ * Cycle counts come from the DWT cycle counter, or from SysTick where the
+ * DWT is not implemented (QEMU). Output is CSV, cycles per call.
+ */
+
+#include "rtos.h"
+#include "hal.h"
+#include "stm32f4xx.h"
+#include "bench_cycles.h"
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+/* Configuration */
+/*---------------------------------------------------------------------------*/
+
+#define BENCH_STACK_SIZE    256     /* Stack size in words */
+#define BENCH_MAX_SIZE      4096    /* Largest copy in bytes */
+#define BENCH_CALL_BYTES    65536   /* Bytes moved per measurement */
+#define BENCH_MIN_CALLS     16
+
+static const uint32_t bench_sizes[] = {
+    4, 8, 16, 32, 64, 128, 256, 1024, 4096
+};
+
+/*---------------------------------------------------------------------------*/
+/* Measurements */
+/*---------------------------------------------------------------------------*/
+
+typedef enum {
+    OP_NEWLIB_MEMCPY,
+    OP_RTOS_MEMCPY,
+    OP_RTOS_MEMCPY_MSG,
+    OP_NEWLIB_MEMSET,
+    OP_RTOS_MEMSET,
+    OP_COUNT
+} bench_op_t;
+
+static const char *const op_names[OP_COUNT] = {
+    "memcpy", "rtos_memcpy", "rtos_memcpy_msg", "memset", "rtos_memset"
+};
+
+/* One spare word so the source can start one byte into it */
+static uint32_t src_buf[BENCH_MAX_SIZE / 4 + 1];
+static uint32_t dst_buf[BENCH_MAX_SIZE / 4 + 1];
+
+static uint32_t bench_run(bench_op_t op, uint32_t size, uint32_t offset) {
+    uint8_t *dst = (uint8_t *)dst_buf;
+    const uint8_t *src = (const uint8_t *)src_buf + offset;
+    uint32_t calls = BENCH_CALL_BYTES / size;
+
+    if (calls < BENCH_MIN_CALLS) {
+        calls = BENCH_MIN_CALLS;
+    }
+
+    /* Highest priority task; only interrupts can get in the way */
+    uint32_t start = bench_cycles();
+
+    for (uint32_t i = 0; i < calls; i++) {
+        switch (op) {
+        case OP_NEWLIB_MEMCPY:
+            memcpy(dst, src, size);
+            break;
+        case OP_RTOS_MEMCPY:
+            rtos_memcpy(dst, src, size);
+            break;
+        case OP_RTOS_MEMCPY_MSG:
+            rtos_memcpy_msg(dst, src, size);
+            break;
+        case OP_NEWLIB_MEMSET:
+            memset(dst + offset, 0x5A, size);
+            break;
+        default:
+            rtos_memset(dst + offset, 0x5A, size);
+            break;
+        }
+    }
+
+    return (bench_cycles() - start) / calls;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Controller */
+/*---------------------------------------------------------------------------*/
+
+static uint32_t ctrl_stack[BENCH_STACK_SIZE];
+static rtos_tcb_t ctrl_tcb;
+
+static void ctrl_fn(void *arg) {
+    (void)arg;
+
+    bench_timer_init();
+
+    for (uint32_t i = 0; i < sizeof(src_buf) / sizeof(src_buf[0]); i++) {
+        src_buf[i] = i * 0x9E3779B9UL;
+    }
+
+    hal_printf("[BENCH] counter: %s\n", bench_use_dwt ? "DWT" : "SysTick");
+    hal_printf("op,size,aligned,cycles\n");
+
+    for (uint32_t op = 0; op < OP_COUNT; op++) {
+        for (uint32_t i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+            uint32_t size = bench_sizes[i];
+
+            /* The inlined path only differs for the fixed sizes */
+            if (op == OP_RTOS_MEMCPY_MSG && size > 32) {
+                continue;
+            }
+
+            for (uint32_t offset = 0; offset < 2; offset++) {
+                hal_printf("%s,%u,%u,%u\n", op_names[op], size, offset ? 0 : 1,
+                           bench_run((bench_op_t)op, size, offset));
+            }
+        }
+    }
+
+    hal_printf("[BENCH] done\n");
+
+    while (1) {
+        rtos_delay(1000);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Main Entry Point */
+/*---------------------------------------------------------------------------*/
+
+int main(void) {
+    hal_system_init();
+    rtos_init();
+
+    rtos_task_create(ctrl_fn, "BENCH", 0, ctrl_stack, BENCH_STACK_SIZE,
+                     &ctrl_tcb, NULL);
+
+    rtos_start();
+
+    return 0;
+}
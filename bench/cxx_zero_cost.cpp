@@ -0,0 +1,82 @@
+/**
+ * @file cxx_zero_cost.cpp
+ * @brief rtos.hpp Wrappers, Checked Against Hand-written C
+ *
+ * Each wrap_<name> function uses the C++ wrappers the way an application
+ * would. cxx_zero_cost_ref.c writes the same operation against the C API
+ * as ref_<name>, with objects of the same layout. The build disassembles
+ * both (scripts/compare_disasm.py) and fails if any pair differs.
+ */
+
+#include "rtos.hpp"
+
+namespace {
+
+struct Message {
+    uint32_t id;
+    uint32_t value;
+};
+
+rtos::Task<128, 2> task;
+rtos::Queue<Message, 8> queue;
+rtos::Mutex mutex;
+rtos::Semaphore sem;
+rtos::Timer timer;
+
+uint32_t shared_count;
+uint32_t blinks;
+uint32_t work_done;
+
+auto blink = [] { blinks++; };
+auto work = [] {
+    for (;;) {
+        work_done++;
+    }
+};
+
+} // namespace
+
+extern "C" {
+
+rtos_status_t wrap_task_start(void) {
+    return task.start(work, "W");
+}
+
+void wrap_task_invoke(void *arg) {
+    rtos::detail::invoke<decltype(work)>(arg);
+}
+
+rtos_status_t wrap_queue_send(uint32_t id, uint32_t value) {
+    return queue.send({id, value}, RTOS_NO_WAIT);
+}
+
+uint32_t wrap_queue_recv(void) {
+    Message msg;
+    if (queue.recv(msg) != RTOS_OK) {
+        return 0;
+    }
+    return msg.value;
+}
+
+void wrap_locked_increment(void) {
+    rtos::LockGuard guard(mutex);
+    shared_count++;
+}
+
+rtos_status_t wrap_sem_post(void) {
+    return sem.post();
+}
+
+rtos_status_t wrap_sem_wait(void) {
+    return sem.wait(100);
+}
+
+rtos_status_t wrap_timer_start(void) {
+    return timer.start(500, blink);
+}
+
+void wrap_timer_invoke(void *arg) {
+    rtos::detail::invoke<decltype(blink)>(arg);
+}
+
+} // extern "C"
@@ -0,0 +1,83 @@
+/**
+ * @file cxx_zero_cost_ref.c
+ * @brief Hand-written C Reference for cxx_zero_cost.cpp
+ *
+ * ref_<name> is the C API version of wrap_<name>; the objects mirror the
+ * layout of the C++ wrappers (TCB then stack, queue then buffer).
+ */
+
+#include "rtos.h"
+
+typedef struct {
+    uint32_t id;
+    uint32_t value;
+} message_t;
+
+static struct {
+    rtos_tcb_t tcb;
+    uint32_t stack[128] __attribute__((aligned(8)));
+} task;
+
+static struct {
+    rtos_queue_t q;
+    uint8_t buffer[sizeof(message_t) * 8] __attribute__((aligned(4)));
+} queue = { { queue.buffer, sizeof(message_t), 8, 0, 0, 0, { 0 }, { 0 } }, { 0 } };
+
+static rtos_mutex_t mutex;
+static rtos_sem_t sem;
+static rtos_timer_t timer;
+
+static uint32_t shared_count;
+static uint32_t blinks;
+static uint32_t work_done;
+
+/* Stand-ins for the empty lambda objects */
+static char blink;
+static char work;
+
+void ref_task_invoke(void *arg) {
+    (void)arg;
+    for (;;) {
+        work_done++;
+    }
+}
+
+rtos_status_t ref_task_start(void) {
+    return rtos_task_create(ref_task_invoke, "W", 2, task.stack, 128, &task.tcb, &work);
+}
+
+rtos_status_t ref_queue_send(uint32_t id, uint32_t value) {
+    message_t msg = { id, value };
+    return rtos_queue_send(&queue.q, &msg, RTOS_NO_WAIT);
+}
+
+uint32_t ref_queue_recv(void) {
+    message_t msg;
+    if (rtos_queue_recv(&queue.q, &msg, RTOS_WAIT_FOREVER) != RTOS_OK) {
+        return 0;
+    }
+    return msg.value;
+}
+
+void ref_locked_increment(void) {
+    rtos_mutex_lock(&mutex, RTOS_WAIT_FOREVER);
+    shared_count++;
+    rtos_mutex_unlock(&mutex);
+}
+
+rtos_status_t ref_sem_post(void) {
+    return rtos_sem_post(&sem);
+}
+
+rtos_status_t ref_sem_wait(void) {
+    return rtos_sem_wait(&sem, 100);
+}
+
+void ref_timer_invoke(void *arg) {
+    (void)arg;
+    blinks++;
+}
+
+rtos_status_t ref_timer_start(void) {
+    return rtos_timer_start(&timer, 500, ref_timer_invoke, &blink);
+}
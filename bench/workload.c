@@ -0,0 +1,866 @@
+/**
+ * @file workload.c
+ * @brief Synthetic Workload Generator
+ *
+ * Runs a described task set under the kernel and reports how it coped:
+ * - Periodic tasks: period, WCET (calibrated busy loop) and priority,
+ *   optionally holding a shared mutex for part of the WCET. A job that
+ *   completes after its next release is a deadline miss.
+ * - Producer/consumer chains: a producer sends fixed-size messages at a
+ *   rate into a pipeline of queue stages, each doing some work per message.
+ *   Reports throughput, drops (queue full) and end-to-end latency.
+ * - Timer ISR sources: TIM2-TIM5 update interrupts at a rate, each event
+ *   handed to a task through a semaphore. An event arriving while the
+ *   previous one is still being handled is an overrun.
+ *
+ * The description is read from WORKLOAD_FILE on the host over semihosting
+ * when present (see bench/workload.txt for the format), otherwise the
+ * compiled-in wl_builtin is used. Results are printed as CSV at the end of
+ * the run, together with the CPU load measured from per-task run ticks.
+ */
+
+#include "rtos.h"
+#include "hal.h"
+#include "stm32f4xx.h"
+
+/*---------------------------------------------------------------------------*/
+/* Configuration */
+/*---------------------------------------------------------------------------*/
+
+#ifndef WORKLOAD_FILE
+#define WORKLOAD_FILE           "workload.txt"
+#endif
+
+#define WL_MAX_PERIODIC         8
+#define WL_MAX_CHAINS           2
+#define WL_MAX_STAGES           3       /* Consumer stages per chain */
+#define WL_MAX_ISRS             4       /* One per TIM2-TIM5 */
+#define WL_MAX_GROUPS           4       /* Mutex sharing groups */
+#define WL_MAX_TASKS            (WL_MAX_PERIODIC + \
+                                 WL_MAX_CHAINS * (1 + WL_MAX_STAGES) + \
+                                 WL_MAX_ISRS)
+
+#define WL_MAX_MSG_SIZE         64      /* Bytes, including the 8-byte header */
+#define WL_MAX_DEPTH            16
+#define WL_QUEUE_ARENA          4096    /* Bytes for all chain queues */
+#define WL_MAX_WORK_US          100000
+#define WL_FILE_MAX             1024
+
+#define WL_STACK_SIZE           256     /* Workload task stack in words */
+#define WL_CTRL_STACK_SIZE      512
+#define WL_CTRL_PRIORITY        0
+#define WL_TIMER_IRQ_PRIORITY   5
+#define WL_CALIBRATE_TICKS      100
+#define WL_SPIN_CHUNK           1000
+
+/*---------------------------------------------------------------------------*/
+/* Workload Description */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t period_ms;
+    uint32_t wcet_us;
+    uint32_t priority;
+    uint32_t group;             /* Mutex group 1..WL_MAX_GROUPS, 0 = none */
+    uint32_t hold_us;           /* Part of wcet_us spent holding the mutex */
+} wl_periodic_desc_t;
+
+typedef struct {
+    uint32_t rate_hz;           /* Messages per second from the producer */
+    uint32_t msg_size;          /* Bytes, 8..WL_MAX_MSG_SIZE */
+    uint32_t stages;            /* Consumer stages, 1..WL_MAX_STAGES */
+    uint32_t depth;             /* Queue depth in front of each stage */
+    uint32_t priority;
+    uint32_t work_us;           /* Per message, per stage */
+} wl_chain_desc_t;
+
+typedef struct {
+    uint32_t timer;             /* 2..5 = TIM2..TIM5 */
+    uint32_t rate_hz;
+    uint32_t priority;          /* Handler task */
+    uint32_t work_us;           /* Handler work per event */
+} wl_isr_desc_t;
+
+typedef struct {
+    uint32_t duration_ms;
+    uint32_t periodic_count;
+    uint32_t chain_count;
+    uint32_t isr_count;
+    wl_periodic_desc_t periodic[WL_MAX_PERIODIC];
+    wl_chain_desc_t chain[WL_MAX_CHAINS];
+    wl_isr_desc_t isr[WL_MAX_ISRS];
+} wl_desc_t;
+
+/* About 65% load: four periodic tasks (two sharing a mutex), a two-stage
+ * chain and a 1 kHz timer interrupt */
+static const wl_desc_t wl_builtin = {
+    .duration_ms = 5000,
+    .periodic_count = 4,
+    .periodic = {
+        { 5,  500,  1, 0, 0   },
+        { 10, 1500, 1, 1, 300 },
+        { 20, 3000, 2, 1, 800 },
+        { 50, 8000, 3, 0, 0   },
+    },
+    .chain_count = 1,
+    .chain = {
+        { 200, 32, 2, 4, 2, 100 },
+    },
+    .isr_count = 1,
+    .isr = {
+        { 3, 1000, 0, 50 },
+    },
+};
+
+static wl_desc_t wl_desc;
+
+/*---------------------------------------------------------------------------*/
+/* Runtime State */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    const wl_periodic_desc_t *desc;
+    uint32_t jobs;
+    uint32_t misses;
+    uint32_t max_response;      /* Ticks from release to completion */
+} wl_periodic_t;
+
+typedef struct {
+    const wl_chain_desc_t *desc;
+    rtos_queue_t queue[WL_MAX_STAGES];
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t received;
+    uint32_t max_latency;       /* Ticks from send to the last stage */
+} wl_chain_t;
+
+typedef struct {
+    wl_chain_t *chain;
+    uint32_t index;
+} wl_stage_t;
+
+typedef struct {
+    const wl_isr_desc_t *desc;
+    rtos_sem_t sem;
+    volatile uint32_t events;
+    volatile uint32_t overruns;
+    volatile uint32_t handled;
+    volatile uint8_t busy;      /* An event is not fully handled yet */
+} wl_isr_t;
+
+typedef struct {
+    rtos_mutex_t mutex;
+    uint32_t locks;
+    uint32_t contended;
+} wl_group_t;
+
+static wl_periodic_t wl_periodic[WL_MAX_PERIODIC];
+static wl_chain_t wl_chain[WL_MAX_CHAINS];
+static wl_stage_t wl_stage[WL_MAX_CHAINS][WL_MAX_STAGES];
+static wl_isr_t wl_isr[WL_MAX_ISRS];
+static wl_group_t wl_group[WL_MAX_GROUPS];
+
+static uint32_t wl_queue_arena[WL_QUEUE_ARENA / 4];
+static uint32_t wl_queue_used;
+
+/* Workload tasks wait here until the controller has calibrated; it posts
+ * once per task while all of them are waiting (semaphores are binary) */
+static rtos_sem_t wl_gate;
+static uint32_t wl_start;
+
+static uint32_t wl_stacks[WL_MAX_TASKS][WL_STACK_SIZE];
+static rtos_tcb_t wl_tcbs[WL_MAX_TASKS];
+static uint32_t wl_task_count;
+
+/*---------------------------------------------------------------------------*/
+/* Busy Work */
+/*---------------------------------------------------------------------------*/
+
+/* Spin loop iterations per microsecond, 24.8 fixed point */
+static uint32_t wl_spin_q8;
+
+static void wl_spin(uint32_t iterations) {
+    for (volatile uint32_t i = 0; i < iterations; i++) {
+    }
+}
+
+static void wl_work(uint32_t us) {
+    wl_spin((us * wl_spin_q8) >> 8);
+}
+
+static void wl_calibrate(void) {
+    uint32_t chunks = 0;
+    uint32_t start = rtos_now();
+
+    /* Count whole chunks over a fixed number of ticks, from a tick edge */
+    while (rtos_now() == start) {
+    }
+    start = rtos_now();
+
+    while (rtos_now() - start < WL_CALIBRATE_TICKS) {
+        wl_spin(WL_SPIN_CHUNK);
+        chunks++;
+    }
+
+    uint32_t us = WL_CALIBRATE_TICKS * (1000000UL / RTOS_TICK_RATE_HZ);
+    wl_spin_q8 = (chunks * WL_SPIN_CHUNK * 256UL) / us;
+    if (wl_spin_q8 == 0) {
+        wl_spin_q8 = 1;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Periodic Tasks */
+/*---------------------------------------------------------------------------*/
+
+static void periodic_fn(void *arg) {
+    wl_periodic_t *p = (wl_periodic_t *)arg;
+    const wl_periodic_desc_t *d = p->desc;
+    uint32_t period = d->period_ms / RTOS_TICK_PERIOD_MS;
+
+    rtos_sem_wait(&wl_gate, RTOS_WAIT_FOREVER);
+    uint32_t release = wl_start;
+
+    while (1) {
+        rtos_delay_until(release);
+
+        if (d->group != 0) {
+            wl_group_t *g = &wl_group[d->group - 1];
+            uint8_t contended = 0;
+
+            if (rtos_mutex_lock(&g->mutex, RTOS_NO_WAIT) != RTOS_OK) {
+                contended = 1;
+                rtos_mutex_lock(&g->mutex, RTOS_WAIT_FOREVER);
+            }
+            g->locks++;
+            g->contended += contended;
+            wl_work(d->hold_us);
+            rtos_mutex_unlock(&g->mutex);
+
+            wl_work(d->wcet_us - d->hold_us);
+        } else {
+            wl_work(d->wcet_us);
+        }
+
+        uint32_t response = rtos_now() - release;
+
+        p->jobs++;
+        if (response > p->max_response) {
+            p->max_response = response;
+        }
+
+        /* Implicit deadline: done before the next release */
+        release += period;
+        if (response > period) {
+            p->misses++;
+
+            /* Releases already passed are skipped, and missed too */
+            while ((int32_t)(rtos_now() - release) >= (int32_t)period) {
+                release += period;
+                p->misses++;
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Producer/Consumer Chains */
+/*---------------------------------------------------------------------------*/
+
+/* Message header; the rest of msg_size is padding */
+typedef struct {
+    uint32_t seq;
+    uint32_t sent_at;
+} wl_msg_header_t;
+
+static void producer_fn(void *arg) {
+    wl_chain_t *c = (wl_chain_t *)arg;
+    const wl_chain_desc_t *d = c->desc;
+    uint32_t msg[WL_MAX_MSG_SIZE / 4];
+    wl_msg_header_t *header = (wl_msg_header_t *)msg;
+
+    rtos_memset(msg, 0, sizeof(msg));
+
+    /* Rates above the tick rate send a burst per tick */
+    uint32_t interval = RTOS_TICK_RATE_HZ / d->rate_hz;
+    uint32_t burst = d->rate_hz / RTOS_TICK_RATE_HZ;
+    if (interval == 0) {
+        interval = 1;
+    }
+    if (burst == 0) {
+        burst = 1;
+    }
+
+    rtos_sem_wait(&wl_gate, RTOS_WAIT_FOREVER);
+    uint32_t release = wl_start;
+
+    while (1) {
+        rtos_delay_until(release);
+
+        for (uint32_t i = 0; i < burst; i++) {
+            header->seq = c->sent + c->dropped;
+            header->sent_at = rtos_now();
+
+            if (rtos_queue_send(&c->queue[0], msg, RTOS_NO_WAIT) == RTOS_OK) {
+                c->sent++;
+            } else {
+                c->dropped++;
+            }
+        }
+
+        release += interval;
+    }
+}
+
+static void stage_fn(void *arg) {
+    wl_stage_t *s = (wl_stage_t *)arg;
+    wl_chain_t *c = s->chain;
+    const wl_chain_desc_t *d = c->desc;
+    uint32_t msg[WL_MAX_MSG_SIZE / 4];
+    const wl_msg_header_t *header = (const wl_msg_header_t *)msg;
+
+    rtos_sem_wait(&wl_gate, RTOS_WAIT_FOREVER);
+
+    while (1) {
+        if (rtos_queue_recv(&c->queue[s->index], msg, RTOS_WAIT_FOREVER) != RTOS_OK) {
+            continue;
+        }
+
+        wl_work(d->work_us);
+
+        if (s->index + 1 < d->stages) {
+            /* Blocking forward: a slow stage backs up to the producer */
+            rtos_queue_send(&c->queue[s->index + 1], msg, RTOS_WAIT_FOREVER);
+        } else {
+            uint32_t latency = rtos_now() - header->sent_at;
+
+            c->received++;
+            if (latency > c->max_latency) {
+                c->max_latency = latency;
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Timer ISR Sources */
+/*---------------------------------------------------------------------------*/
+
+static TIM_TypeDef *const wl_timers[WL_MAX_ISRS] = { TIM2, TIM3, TIM4, TIM5 };
+static const int32_t wl_timer_irqs[WL_MAX_ISRS] = {
+    TIM2_IRQn, TIM3_IRQn, TIM4_IRQn, TIM5_IRQn
+};
+static const uint32_t wl_timer_clocks[WL_MAX_ISRS] = {
+    RCC_APB1ENR_TIM2EN, RCC_APB1ENR_TIM3EN, RCC_APB1ENR_TIM4EN, RCC_APB1ENR_TIM5EN
+};
+
+/* Source driven by each timer, NULL if unused */
+static wl_isr_t *wl_timer_source[WL_MAX_ISRS];
+
+static void wl_timer_isr(uint32_t slot) {
+    wl_isr_t *src = wl_timer_source[slot];
+
+    rtos_isr_enter();
+
+    wl_timers[slot]->SR = ~TIM_SR_UIF;
+
+    src->events++;
+    if (src->busy) {
+        src->overruns++;
+    }
+    src->busy = 1;
+    rtos_sem_post(&src->sem);
+
+    rtos_isr_exit();
+}
+
+static void wl_tim2_isr(void) { wl_timer_isr(0); }
+static void wl_tim3_isr(void) { wl_timer_isr(1); }
+static void wl_tim4_isr(void) { wl_timer_isr(2); }
+static void wl_tim5_isr(void) { wl_timer_isr(3); }
+
+static const rtos_irq_handler_t wl_timer_handlers[WL_MAX_ISRS] = {
+    wl_tim2_isr, wl_tim3_isr, wl_tim4_isr, wl_tim5_isr
+};
+
+static void wl_timer_start(uint32_t slot, uint32_t rate_hz) {
+    TIM_TypeDef *tim = wl_timers[slot];
+    uint32_t counts = hal_clock_timer(1) / rate_hz;
+    uint32_t psc = counts / 65536;      /* TIM3/TIM4 are 16-bit */
+
+    RCC->APB1ENR |= wl_timer_clocks[slot];
+    tim->CR1 = 0;
+    tim->PSC = psc;
+    tim->ARR = counts / (psc + 1) - 1;
+    tim->EGR = TIM_EGR_UG;
+    tim->SR = 0;
+    tim->DIER = TIM_DIER_UIE;
+
+    rtos_irq_enable(wl_timer_irqs[slot]);
+    tim->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+}
+
+static void wl_timer_stop(uint32_t slot) {
+    wl_timers[slot]->CR1 = 0;
+    wl_timers[slot]->DIER = 0;
+    rtos_irq_disable(wl_timer_irqs[slot]);
+}
+
+static void isr_handler_fn(void *arg) {
+    wl_isr_t *src = (wl_isr_t *)arg;
+
+    rtos_sem_wait(&wl_gate, RTOS_WAIT_FOREVER);
+
+    while (1) {
+        rtos_sem_wait(&src->sem, RTOS_WAIT_FOREVER);
+
+        /* Semaphores are binary: work through every event counted so far */
+        while (1) {
+            uint32_t state = rtos_critical_enter();
+            if (src->handled == src->events) {
+                src->busy = 0;
+                rtos_critical_exit(state);
+                break;
+            }
+            rtos_critical_exit(state);
+
+            wl_work(src->desc->work_us);
+            src->handled++;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Description Parser */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * One entry per line, '#' starts a comment:
+ *   duration <ms>
+ *   periodic <period_ms> <wcet_us> <priority> [<group> <hold_us>]
+ *   chain <rate_hz> <msg_size> <stages> <depth> <priority> <work_us>
+ *   isr <timer 2-5> <rate_hz> <priority> <work_us>
+ */
+
+static const char *wl_skip_space(const char *p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r') {
+        p++;
+    }
+    return p;
+}
+
+static uint8_t wl_parse_uint(const char **pp, uint32_t *out) {
+    const char *p = wl_skip_space(*pp);
+    uint32_t value = 0;
+
+    if (*p < '0' || *p > '9') {
+        return 0;
+    }
+    while (*p >= '0' && *p <= '9') {
+        value = value * 10 + (uint32_t)(*p - '0');
+        p++;
+    }
+
+    *out = value;
+    *pp = p;
+    return 1;
+}
+
+static uint8_t wl_parse_keyword(const char **pp, const char *word) {
+    const char *p = *pp;
+
+    while (*word != '\0') {
+        if (*p++ != *word++) {
+            return 0;
+        }
+    }
+    if (*p != ' ' && *p != '\t') {
+        return 0;
+    }
+
+    *pp = p;
+    return 1;
+}
+
+static uint8_t wl_line_end(const char *p) {
+    p = wl_skip_space(p);
+    return *p == '\0' || *p == '\n' || *p == '#';
+}
+
+static uint8_t wl_valid_priority(uint32_t priority) {
+    return priority < RTOS_MAX_PRIORITIES;
+}
+
+static uint8_t wl_valid_work(uint32_t us) {
+    return us <= WL_MAX_WORK_US;
+}
+
+static uint8_t wl_parse_line(const char *p, wl_desc_t *desc) {
+    p = wl_skip_space(p);
+
+    if (wl_line_end(p)) {
+        return 1;
+    }
+
+    if (wl_parse_keyword(&p, "duration")) {
+        return wl_parse_uint(&p, &desc->duration_ms) && desc->duration_ms > 0 &&
+               wl_line_end(p);
+    }
+
+    if (wl_parse_keyword(&p, "periodic")) {
+        if (desc->periodic_count >= WL_MAX_PERIODIC) {
+            return 0;
+        }
+        wl_periodic_desc_t *d = &desc->periodic[desc->periodic_count];
+
+        if (!wl_parse_uint(&p, &d->period_ms) || !wl_parse_uint(&p, &d->wcet_us) ||
+            !wl_parse_uint(&p, &d->priority)) {
+            return 0;
+        }
+        d->group = 0;
+        d->hold_us = 0;
+        if (!wl_line_end(p) &&
+            (!wl_parse_uint(&p, &d->group) || !wl_parse_uint(&p, &d->hold_us))) {
+            return 0;
+        }
+        if (!wl_line_end(p) || d->period_ms < RTOS_TICK_PERIOD_MS ||
+            !wl_valid_work(d->wcet_us) || !wl_valid_priority(d->priority) ||
+            d->group > WL_MAX_GROUPS || d->hold_us > d->wcet_us) {
+            return 0;
+        }
+
+        desc->periodic_count++;
+        return 1;
+    }
+
+    if (wl_parse_keyword(&p, "chain")) {
+        if (desc->chain_count >= WL_MAX_CHAINS) {
+            return 0;
+        }
+        wl_chain_desc_t *d = &desc->chain[desc->chain_count];
+
+        if (!wl_parse_uint(&p, &d->rate_hz) || !wl_parse_uint(&p, &d->msg_size) ||
+            !wl_parse_uint(&p, &d->stages) || !wl_parse_uint(&p, &d->depth) ||
+            !wl_parse_uint(&p, &d->priority) || !wl_parse_uint(&p, &d->work_us) ||
+            !wl_line_end(p)) {
+            return 0;
+        }
+        if (d->rate_hz == 0 || d->msg_size < sizeof(wl_msg_header_t) ||
+            d->msg_size > WL_MAX_MSG_SIZE || d->stages == 0 ||
+            d->stages > WL_MAX_STAGES || d->depth == 0 || d->depth > WL_MAX_DEPTH ||
+            !wl_valid_priority(d->priority) || !wl_valid_work(d->work_us)) {
+            return 0;
+        }
+
+        desc->chain_count++;
+        return 1;
+    }
+
+    if (wl_parse_keyword(&p, "isr")) {
+        if (desc->isr_count >= WL_MAX_ISRS) {
+            return 0;
+        }
+        wl_isr_desc_t *d = &desc->isr[desc->isr_count];
+
+        if (!wl_parse_uint(&p, &d->timer) || !wl_parse_uint(&p, &d->rate_hz) ||
+            !wl_parse_uint(&p, &d->priority) || !wl_parse_uint(&p, &d->work_us) ||
+            !wl_line_end(p)) {
+            return 0;
+        }
+        if (d->timer < 2 || d->timer > 5 || d->rate_hz == 0 ||
+            !wl_valid_priority(d->priority) || !wl_valid_work(d->work_us)) {
+            return 0;
+        }
+
+        /* One source per timer */
+        for (uint32_t i = 0; i < desc->isr_count; i++) {
+            if (desc->isr[i].timer == d->timer) {
+                return 0;
+            }
+        }
+
+        desc->isr_count++;
+        return 1;
+    }
+
+    return 0;
+}
+
+static char wl_file_buf[WL_FILE_MAX + 1];
+
+/* Returns 1 if the host file was loaded, 0 to use the built-in set */
+static uint8_t wl_load(wl_desc_t *desc) {
+    int32_t file = hal_semihost_open(WORKLOAD_FILE, HAL_SEMIHOST_MODE_R);
+
+    if (file < 0) {
+        return 0;
+    }
+
+    uint32_t len = hal_semihost_read(file, wl_file_buf, WL_FILE_MAX);
+    hal_semihost_close(file);
+    wl_file_buf[len] = '\0';
+
+    rtos_memset(desc, 0, sizeof(*desc));
+    desc->duration_ms = wl_builtin.duration_ms;
+
+    const char *line = wl_file_buf;
+    uint32_t line_no = 1;
+
+    while (*line != '\0') {
+        if (!wl_parse_line(line, desc)) {
+            hal_printf("[WL] %s:%u: invalid entry, using the built-in workload\n",
+                       WORKLOAD_FILE, line_no);
+            return 0;
+        }
+
+        while (*line != '\0' && *line != '\n') {
+            line++;
+        }
+        if (*line == '\n') {
+            line++;
+        }
+        line_no++;
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Setup */
+/*---------------------------------------------------------------------------*/
+
+static rtos_tcb_t *wl_spawn(rtos_task_fn_t fn, const char *name, uint32_t priority,
+                            void *arg) {
+    rtos_tcb_t *tcb = &wl_tcbs[wl_task_count];
+
+    if (rtos_task_create(fn, name, priority, wl_stacks[wl_task_count],
+                         WL_STACK_SIZE, tcb, arg) != RTOS_OK) {
+        return NULL;
+    }
+
+    wl_task_count++;
+    return tcb;
+}
+
+static void *wl_queue_alloc(uint32_t bytes) {
+    bytes = (bytes + 3) & ~3UL;
+
+    if (wl_queue_used + bytes > WL_QUEUE_ARENA) {
+        return NULL;
+    }
+
+    void *buffer = (uint8_t *)wl_queue_arena + wl_queue_used;
+    wl_queue_used += bytes;
+    return buffer;
+}
+
+static rtos_status_t wl_setup(const wl_desc_t *desc) {
+    rtos_sem_init(&wl_gate, 0);
+
+    for (uint32_t i = 0; i < WL_MAX_GROUPS; i++) {
+        rtos_mutex_init(&wl_group[i].mutex);
+    }
+
+    for (uint32_t i = 0; i < desc->periodic_count; i++) {
+        wl_periodic[i].desc = &desc->periodic[i];
+        if (wl_spawn(periodic_fn, "PERIODIC", desc->periodic[i].priority,
+                     &wl_periodic[i]) == NULL) {
+            return RTOS_ERR_PARAM;
+        }
+    }
+
+    for (uint32_t i = 0; i < desc->chain_count; i++) {
+        const wl_chain_desc_t *d = &desc->chain[i];
+        wl_chain_t *c = &wl_chain[i];
+
+        c->desc = d;
+        for (uint32_t s = 0; s < d->stages; s++) {
+            void *buffer = wl_queue_alloc(d->msg_size * d->depth);
+
+            if (buffer == NULL ||
+                rtos_queue_init(&c->queue[s], buffer, d->msg_size, d->depth) != RTOS_OK) {
+                return RTOS_ERR_NO_MEM;
+            }
+
+            wl_stage[i][s].chain = c;
+            wl_stage[i][s].index = s;
+            if (wl_spawn(stage_fn, "STAGE", d->priority, &wl_stage[i][s]) == NULL) {
+                return RTOS_ERR_PARAM;
+            }
+        }
+
+        if (wl_spawn(producer_fn, "PRODUCER", d->priority, c) == NULL) {
+            return RTOS_ERR_PARAM;
+        }
+    }
+
+    for (uint32_t i = 0; i < desc->isr_count; i++) {
+        const wl_isr_desc_t *d = &desc->isr[i];
+        uint32_t slot = d->timer - 2;
+        wl_isr_t *src = &wl_isr[i];
+
+        src->desc = d;
+        rtos_sem_init(&src->sem, 0);
+
+        rtos_status_t status = rtos_irq_register(wl_timer_irqs[slot],
+                                                 wl_timer_handlers[slot],
+                                                 WL_TIMER_IRQ_PRIORITY);
+        if (status != RTOS_OK) {
+            return status;
+        }
+        wl_timer_source[slot] = src;
+
+        if (wl_spawn(isr_handler_fn, "ISR", d->priority, src) == NULL) {
+            return RTOS_ERR_PARAM;
+        }
+    }
+
+    return RTOS_OK;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Controller and Report */
+/*---------------------------------------------------------------------------*/
+
+static void wl_report(uint32_t duration_ms, uint32_t ctx_switches) {
+    uint32_t total_misses = 0;
+
+    hal_printf("periodic,index,priority,period_ms,wcet_us,jobs,misses,max_response_ms\n");
+    for (uint32_t i = 0; i < wl_desc.periodic_count; i++) {
+        const wl_periodic_t *p = &wl_periodic[i];
+
+        hal_printf("periodic,%u,%u,%u,%u,%u,%u,%u\n", i, p->desc->priority,
+                   p->desc->period_ms, p->desc->wcet_us, p->jobs, p->misses,
+                   p->max_response * RTOS_TICK_PERIOD_MS);
+        total_misses += p->misses;
+    }
+
+    hal_printf("chain,index,priority,rate_hz,msg_size,stages,sent,dropped,received,"
+               "throughput_per_s,max_latency_ms\n");
+    for (uint32_t i = 0; i < wl_desc.chain_count; i++) {
+        const wl_chain_t *c = &wl_chain[i];
+
+        hal_printf("chain,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", i, c->desc->priority,
+                   c->desc->rate_hz, c->desc->msg_size, c->desc->stages, c->sent,
+                   c->dropped, c->received, (c->received * 1000UL) / duration_ms,
+                   c->max_latency * RTOS_TICK_PERIOD_MS);
+    }
+
+    hal_printf("isr,index,timer,rate_hz,events,handled,overruns\n");
+    for (uint32_t i = 0; i < wl_desc.isr_count; i++) {
+        const wl_isr_t *src = &wl_isr[i];
+
+        hal_printf("isr,%u,TIM%u,%u,%u,%u,%u\n", i, src->desc->timer,
+                   src->desc->rate_hz, src->events, src->handled, src->overruns);
+        total_misses += src->overruns;
+    }
+
+    hal_printf("mutex,group,locks,contended\n");
+    for (uint32_t i = 0; i < WL_MAX_GROUPS; i++) {
+        if (wl_group[i].locks != 0) {
+            hal_printf("mutex,%u,%u,%u\n", i + 1, wl_group[i].locks,
+                       wl_group[i].contended);
+        }
+    }
+
+    hal_printf("[WL] deadline misses: %u\n", total_misses);
+
+#if RTOS_ENABLE_STATS
+    /* Tick-sampled: ISR time is charged to the task it interrupted */
+    uint32_t busy_ticks = 0;
+    for (uint32_t i = 0; i < wl_task_count; i++) {
+        busy_ticks += rtos_stats_task_ticks(&wl_tcbs[i]);
+    }
+
+    uint32_t window = duration_ms / RTOS_TICK_PERIOD_MS;
+    hal_printf("[WL] cpu load: %u%% (%u/%u ticks), ctx_sw=%u\n",
+               (busy_ticks * 100) / window, busy_ticks, window, ctx_switches);
+#else
+    (void)ctx_switches;
+#endif
+}
+
+static uint32_t ctrl_stack[WL_CTRL_STACK_SIZE];
+static rtos_tcb_t ctrl_tcb;
+
+static void ctrl_fn(void *arg) {
+    (void)arg;
+    uint32_t duration = wl_desc.duration_ms / RTOS_TICK_PERIOD_MS;
+
+    /* Let every workload task reach the gate, then calibrate undisturbed */
+    rtos_delay(1);
+    wl_calibrate();
+    hal_printf("[WL] spin: %u.%u loops/us\n", wl_spin_q8 >> 8,
+               ((wl_spin_q8 & 0xFF) * 100) >> 8);
+
+    for (uint32_t slot = 0; slot < WL_MAX_ISRS; slot++) {
+        if (wl_timer_source[slot] != NULL) {
+            wl_timer_start(slot, wl_timer_source[slot]->desc->rate_hz);
+        }
+    }
+
+#if RTOS_ENABLE_STATS
+    uint32_t ctx_start = rtos_stats_context_switches();
+#else
+    uint32_t ctx_start = 0;
+#endif
+
+    /* First releases on the next tick, after this task blocks */
+    wl_start = rtos_now() + 1;
+    for (uint32_t i = 0; i < wl_task_count; i++) {
+        rtos_sem_post(&wl_gate);
+    }
+
+    rtos_delay_until(wl_start + duration);
+
+    for (uint32_t slot = 0; slot < WL_MAX_ISRS; slot++) {
+        if (wl_timer_source[slot] != NULL) {
+            wl_timer_stop(slot);
+        }
+    }
+
+#if RTOS_ENABLE_STATS
+    uint32_t ctx_switches = rtos_stats_context_switches() - ctx_start;
+#else
+    uint32_t ctx_switches = ctx_start;
+#endif
+
+    wl_report(wl_desc.duration_ms, ctx_switches);
+    hal_printf("[WL] done\n");
+
+    while (1) {
+        rtos_delay(1000);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Main Entry Point */
+/*---------------------------------------------------------------------------*/
+
+int main(void) {
+    hal_system_init();
+    rtos_init();
+
+    uint8_t from_file = wl_load(&wl_desc);
+    if (!from_file) {
+        rtos_memcpy(&wl_desc, &wl_builtin, sizeof(wl_desc));
+    }
+
+    hal_printf("[WL] workload: %s, %u periodic, %u chains, %u isr, %u ms\n",
+               from_file ? WORKLOAD_FILE : "built-in", wl_desc.periodic_count,
+               wl_desc.chain_count, wl_desc.isr_count, wl_desc.duration_ms);
+
+    rtos_status_t status = wl_setup(&wl_desc);
+    if (status != RTOS_OK) {
+        hal_printf("[WL] setup failed (%d)\n", status);
+        while (1) {
+        }
+    }
+
+    rtos_task_create(ctrl_fn, "WL_CTRL", WL_CTRL_PRIORITY, ctrl_stack,
+                     WL_CTRL_STACK_SIZE, &ctrl_tcb, NULL);
+
+    rtos_start();
+
+    return 0;
+}
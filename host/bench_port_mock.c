@@ -0,0 +1,87 @@
+/**
+ * @file bench_port_mock.c
+ * @brief Mocked Port for the Host Scaling Benchmark
+ *
+ * Satisfies the port interface of the kernel sources with the cheapest
+ * possible stand-ins, so the benchmark times only the kernel's list, delay
+ * and timer code. The scheduler is never started: critical sections are
+ * a nesting counter, context switches are only counted and no task ever
+ * runs.
+ */
+
+#include <stdlib.h>
+
+#include "rtos.h"
+#include "rtos_internal.h"
+#include "stm32f4xx.h"
+
+/*---------------------------------------------------------------------------*/
+/* Mock State */
+/*---------------------------------------------------------------------------*/
+
+/* Read by the benchmark to check the scheduler was never asked to switch */
+volatile uint32_t bench_mock_switches;
+
+static uint32_t mock_critical_depth;
+
+DWT_Type rtos_host_dwt;
+uint32_t rtos_host_msp[RTOS_HOST_MSP_WORDS];
+
+/*---------------------------------------------------------------------------*/
+/* Core Stand-ins */
+/*---------------------------------------------------------------------------*/
+
+void rtos_host_wfi(void) {
+}
+
+void rtos_trigger_context_switch(void) {
+    bench_mock_switches++;
+}
+
+RTOS_RAMFUNC uint32_t rtos_enter_critical(void) {
+    return mock_critical_depth++;
+}
+
+RTOS_RAMFUNC void rtos_exit_critical(uint32_t state) {
+    mock_critical_depth = state;
+}
+
+uint32_t rtos_critical_enter(void) {
+    return rtos_enter_critical();
+}
+
+void rtos_critical_exit(uint32_t state) {
+    rtos_exit_critical(state);
+}
+
+uint8_t rtos_in_isr(void) {
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Port Interface */
+/*---------------------------------------------------------------------------*/
+
+void rtos_port_init(void) {
+    mock_critical_depth = 0;
+}
+
+void rtos_port_stack_guard_init(rtos_tcb_t *tcb) {
+    (void)tcb;
+}
+
+uint32_t rtos_port_stack_guard_words(const rtos_tcb_t *tcb) {
+    (void)tcb;
+    return 0;
+}
+
+uint32_t *rtos_port_init_stack(uint32_t *stack_top, void (*task_fn)(void *), void *arg) {
+    (void)task_fn;
+    (void)arg;
+    return stack_top;
+}
+
+void rtos_port_start_first_task(void) {
+    /* The benchmark drives the kernel directly and never starts it */
+    abort();
+}
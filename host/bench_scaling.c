@@ -0,0 +1,608 @@
+/**
+ * @file bench_scaling.c
+ * @brief Kernel Data-Structure Scaling Benchmark (host)
+ *
+ * Times the kernel's sorted lists natively while the number of waiters,
+ * delayed tasks and timers sweeps from 4 to 4096:
+ * - list_add_priority: a lowest-priority waiter joins a wait list
+ * - add_to_delay_list: a task sleeps past every other delayed task
+ * - check_delayed_tasks: a tick on which every delayed task times out
+ * - timer_insert: a timer starts behind every active timer
+ *   (timer_insert is static; it is reached through rtos_timer_start_once)
+ * - timer_tick_one_due: one periodic timer expires per tick
+ * - timer_tick_all_due: every periodic timer expires on the same tick
+ * Each case puts the new entry at the end of the walk, so the times are
+ * upper bounds for that size. The kernel runs on a mocked port
+ * (bench_port_mock.c) and is never started.
+ *
+ * Output is Google Benchmark style CSV on stdout: mean, median and stddev
+ * over the repetitions for each size, then the fitted complexity
+ * (_BigO, _RMS) for each benchmark. Run context goes to stderr.
+ *
+ * Usage: rtos_host_bench [--benchmark_filter=<substring>]
+ *                        [--benchmark_repetitions=<n>]
+ *                        [--benchmark_min_time=<ms per repetition>]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rtos.h"
+#include "rtos_internal.h"
+
+/*---------------------------------------------------------------------------*/
+/* Configuration */
+/*---------------------------------------------------------------------------*/
+
+#define BENCH_MIN_N             4
+#define BENCH_MAX_N             4096
+#define BENCH_SIZE_COUNT        11          /* 4, 8, ... 4096 */
+#define BENCH_DEFAULT_REPS      10
+#define BENCH_DEFAULT_MIN_MS    2
+#define BENCH_MAX_REPS          100
+#define BENCH_MAX_ITERS         100000000ULL
+#define BENCH_TIMER_PERIOD      10          /* Ticks, all-due timer case */
+
+/* Ticks to the milliseconds the timer API takes */
+#define BENCH_MS(ticks)         ((ticks) * 1000UL / RTOS_TICK_RATE_HZ)
+
+/*---------------------------------------------------------------------------*/
+/* External References */
+/*---------------------------------------------------------------------------*/
+extern rtos_kernel_t g_kernel;
+extern volatile uint32_t bench_mock_switches;
+
+/*---------------------------------------------------------------------------*/
+/* Benchmark State */
+/*---------------------------------------------------------------------------*/
+
+static rtos_tcb_t tcb_pool[BENCH_MAX_N];
+static rtos_tcb_t probe_tcb;
+static rtos_list_t wait_list;
+static rtos_timer_t timer_pool[BENCH_MAX_N];
+static rtos_timer_t probe_timer;
+static volatile uint32_t timer_fired;
+
+/* Cost of one back-to-back clock read, taken off per-call samples */
+static uint64_t clock_overhead_ns;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_timer_cb(void *arg) {
+    (void)arg;
+    timer_fired++;
+}
+
+static void kernel_reset(void) {
+    memset(&g_kernel, 0, sizeof(g_kernel));
+    for (uint32_t i = 0; i < RTOS_MAX_PRIORITIES; i++) {
+        rtos_list_init(&g_kernel.ready_list[i]);
+    }
+
+    rtos_list_init(&wait_list);
+    memset(tcb_pool, 0, sizeof(tcb_pool));
+    memset(&probe_tcb, 0, sizeof(probe_tcb));
+
+    for (uint32_t i = 0; i < BENCH_MAX_N; i++) {
+        rtos_timer_init(&timer_pool[i]);
+    }
+    rtos_timer_init(&probe_timer);
+}
+
+static void tcb_set_priority(rtos_tcb_t *tcb, uint32_t priority) {
+    tcb->priority = (rtos_prio_t)priority;
+    tcb->base_priority = (rtos_prio_t)priority;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Structure Checks (after the timed runs) */
+/*---------------------------------------------------------------------------*/
+
+static int check_wait_list(uint32_t n) {
+    uint32_t count = 0;
+
+    for (rtos_tcb_t *t = wait_list.head; t != NULL; t = t->next) {
+        if (t->next != NULL && t->next->priority < t->priority) {
+            return 0;
+        }
+        count++;
+    }
+    return count == n;
+}
+
+static int check_delay_list(uint32_t n) {
+    uint32_t count = 0;
+
+    for (rtos_tcb_t *t = g_kernel.delay_list; t != NULL; t = t->delay_next) {
+        if (t->delay_next != NULL &&
+            (int32_t)(t->delay_next->wake_tick - t->wake_tick) < 0) {
+            return 0;
+        }
+        count++;
+    }
+    return count == n;
+}
+
+static int check_timer_list(uint32_t n) {
+    uint32_t count = 0;
+
+    for (rtos_timer_t *t = g_kernel.timer_list; t != NULL; t = t->next) {
+        if (t->next != NULL &&
+            (int32_t)(t->next->next_expiry - t->next_expiry) < 0) {
+            return 0;
+        }
+        count++;
+    }
+    return count == n;
+}
+
+static int check_all_ready(uint32_t n) {
+    uint32_t count = 0;
+
+    for (uint32_t p = 0; p < RTOS_MAX_PRIORITIES; p++) {
+        for (rtos_tcb_t *t = g_kernel.ready_list[p].head; t != NULL; t = t->next) {
+            count++;
+        }
+    }
+    return count == n && g_kernel.delay_list == NULL && wait_list.head == NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* rtos_list_add_priority */
+/*---------------------------------------------------------------------------*/
+
+static void list_add_priority_setup(uint32_t n) {
+    kernel_reset();
+
+    /* Waiters of every priority level, in priority order */
+    for (uint32_t i = 0; i < n; i++) {
+        tcb_set_priority(&tcb_pool[i], i % RTOS_MAX_PRIORITIES);
+        rtos_list_add_priority(&wait_list, &tcb_pool[i]);
+    }
+    tcb_set_priority(&probe_tcb, RTOS_MAX_PRIORITIES - 1);
+}
+
+static uint64_t list_add_priority_run(uint32_t n, uint64_t iters) {
+    (void)n;
+    uint64_t start = bench_now_ns();
+
+    /* Lowest priority goes behind every waiter; the remove is O(1) */
+    for (uint64_t i = 0; i < iters; i++) {
+        rtos_list_add_priority(&wait_list, &probe_tcb);
+        rtos_list_remove(&wait_list, &probe_tcb);
+    }
+
+    return bench_now_ns() - start;
+}
+
+/*---------------------------------------------------------------------------*/
+/* rtos_add_to_delay_list */
+/*---------------------------------------------------------------------------*/
+
+static void add_to_delay_list_setup(uint32_t n) {
+    kernel_reset();
+
+    for (uint32_t i = 0; i < n; i++) {
+        rtos_add_to_delay_list(&tcb_pool[i], i + 1);
+    }
+}
+
+static uint64_t add_to_delay_list_run(uint32_t n, uint64_t iters) {
+    rtos_tcb_t *last = &tcb_pool[n - 1];
+    uint64_t start = bench_now_ns();
+
+    /* Wakes after every sleeper; unlinked from the known tail in O(1) */
+    for (uint64_t i = 0; i < iters; i++) {
+        rtos_add_to_delay_list(&probe_tcb, n + 1);
+        last->delay_next = NULL;
+        probe_tcb.flags &= (uint8_t)~RTOS_TCB_DELAYED;
+    }
+
+    return bench_now_ns() - start;
+}
+
+/*---------------------------------------------------------------------------*/
+/* rtos_check_delayed_tasks */
+/*---------------------------------------------------------------------------*/
+
+/* n timed waiters on one wait list, all due on the next tick */
+static void delayed_waiters_build(uint32_t n) {
+    rtos_tcb_t **link = &g_kernel.delay_list;
+
+    for (uint32_t p = 0; p < RTOS_MAX_PRIORITIES; p++) {
+        rtos_list_init(&g_kernel.ready_list[p]);
+    }
+    g_kernel.priority_bitmap = 0;
+    rtos_list_init(&wait_list);
+
+    for (uint32_t i = 0; i < n; i++) {
+        rtos_tcb_t *tcb = &tcb_pool[i];
+
+        tcb_set_priority(tcb, i % RTOS_MAX_PRIORITIES);
+        tcb->state = RTOS_TASK_BLOCKED;
+        tcb->flags = RTOS_TCB_DELAYED;
+        tcb->wake_tick = g_kernel.tick_count + 1;
+        tcb->wait_list = &wait_list;
+        rtos_list_add_tail(&wait_list, tcb);
+
+        *link = tcb;
+        link = &tcb->delay_next;
+    }
+    *link = NULL;
+}
+
+static void check_delayed_tasks_setup(uint32_t n) {
+    (void)n;
+    kernel_reset();
+}
+
+static uint64_t check_delayed_tasks_run(uint32_t n, uint64_t iters) {
+    uint64_t total = 0;
+
+    /* The tick consumes the list, so it is rebuilt untimed every call */
+    for (uint64_t i = 0; i < iters; i++) {
+        delayed_waiters_build(n);
+        g_kernel.tick_count++;
+
+        uint64_t start = bench_now_ns();
+        rtos_check_delayed_tasks();
+        uint64_t elapsed = bench_now_ns() - start;
+
+        total += (elapsed > clock_overhead_ns) ? elapsed - clock_overhead_ns : 0;
+    }
+
+    return total;
+}
+
+/*---------------------------------------------------------------------------*/
+/* timer_insert (through rtos_timer_start_once) */
+/*---------------------------------------------------------------------------*/
+
+static void timer_insert_setup(uint32_t n) {
+    kernel_reset();
+
+    for (uint32_t i = 0; i < n; i++) {
+        rtos_timer_start_once(&timer_pool[i], BENCH_MS(i + 1), bench_timer_cb, NULL);
+    }
+}
+
+static uint64_t timer_insert_run(uint32_t n, uint64_t iters) {
+    rtos_timer_t *last = &timer_pool[n - 1];
+    uint64_t start = bench_now_ns();
+
+    /* Expires after every active timer; unlinked from the tail in O(1) */
+    for (uint64_t i = 0; i < iters; i++) {
+        rtos_timer_start_once(&probe_timer, BENCH_MS(n + 1), bench_timer_cb, NULL);
+        last->next = NULL;
+        probe_timer.active = 0;
+    }
+
+    return bench_now_ns() - start;
+}
+
+/*---------------------------------------------------------------------------*/
+/* rtos_timer_tick */
+/*---------------------------------------------------------------------------*/
+
+static void timer_tick_one_due_setup(uint32_t n) {
+    kernel_reset();
+
+    /* Period n, phases 1..n: exactly one timer is due on every tick */
+    for (uint32_t i = 0; i < n; i++) {
+        g_kernel.tick_count = i;
+        rtos_timer_start(&timer_pool[i], BENCH_MS(n), bench_timer_cb, NULL);
+    }
+}
+
+static void timer_tick_all_due_setup(uint32_t n) {
+    kernel_reset();
+
+    for (uint32_t i = 0; i < n; i++) {
+        rtos_timer_start(&timer_pool[i], BENCH_MS(BENCH_TIMER_PERIOD),
+                         bench_timer_cb, NULL);
+    }
+}
+
+static uint64_t timer_tick_one_due_run(uint32_t n, uint64_t iters) {
+    (void)n;
+    uint64_t start = bench_now_ns();
+
+    /* Steady state: each tick re-inserts its timer behind the others */
+    for (uint64_t i = 0; i < iters; i++) {
+        g_kernel.tick_count++;
+        rtos_timer_tick();
+    }
+
+    return bench_now_ns() - start;
+}
+
+static uint64_t timer_tick_all_due_run(uint32_t n, uint64_t iters) {
+    (void)n;
+    uint64_t start = bench_now_ns();
+
+    for (uint64_t i = 0; i < iters; i++) {
+        g_kernel.tick_count += BENCH_TIMER_PERIOD;
+        rtos_timer_tick();
+    }
+
+    return bench_now_ns() - start;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Benchmark Table */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    const char *name;
+    void (*setup)(uint32_t n);                      /* Untimed, once per size */
+    uint64_t (*run)(uint32_t n, uint64_t iters);    /* Timed ns for iters */
+    int (*check)(uint32_t n);                       /* Structure intact after */
+    uint8_t items_per_n;                            /* Items/iter: 1 or n */
+} bench_t;
+
+static const bench_t benchmarks[] = {
+    { "BM_list_add_priority", list_add_priority_setup, list_add_priority_run,
+      check_wait_list, 0 },
+    { "BM_add_to_delay_list", add_to_delay_list_setup, add_to_delay_list_run,
+      check_delay_list, 0 },
+    { "BM_check_delayed_tasks", check_delayed_tasks_setup, check_delayed_tasks_run,
+      check_all_ready, 1 },
+    { "BM_timer_insert", timer_insert_setup, timer_insert_run,
+      check_timer_list, 0 },
+    { "BM_timer_tick_one_due", timer_tick_one_due_setup, timer_tick_one_due_run,
+      check_timer_list, 0 },
+    { "BM_timer_tick_all_due", timer_tick_all_due_setup, timer_tick_all_due_run,
+      check_timer_list, 1 },
+};
+
+#define BENCH_COUNT     (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/*---------------------------------------------------------------------------*/
+/* Statistics */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    double mean;
+    double median;
+    double stddev;
+} bench_stats_t;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static bench_stats_t bench_stats(double *samples, uint32_t count) {
+    bench_stats_t s = { 0.0, 0.0, 0.0 };
+
+    for (uint32_t i = 0; i < count; i++) {
+        s.mean += samples[i];
+    }
+    s.mean /= count;
+
+    /* Sample standard deviation, as Google Benchmark reports it */
+    if (count > 1) {
+        double sq = 0.0;
+        for (uint32_t i = 0; i < count; i++) {
+            sq += (samples[i] - s.mean) * (samples[i] - s.mean);
+        }
+        s.stddev = sqrt(sq / (count - 1));
+    }
+
+    qsort(samples, count, sizeof(double), cmp_double);
+    s.median = (count & 1) ? samples[count / 2]
+                           : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+    return s;
+}
+
+/* Least-squares fit of t = coef * f(n), best by relative RMS (oAuto) */
+typedef enum {
+    FIT_1,
+    FIT_N,
+    FIT_NLGN,
+    FIT_N2,
+    FIT_COUNT
+} bench_fit_t;
+
+static const char *const fit_names[FIT_COUNT] = { "(1)", "N", "NlgN", "N^2" };
+
+static double fit_term(bench_fit_t fit, double n) {
+    switch (fit) {
+    case FIT_1:     return 1.0;
+    case FIT_N:     return n;
+    case FIT_NLGN:  return n * log2(n);
+    default:        return n * n;
+    }
+}
+
+static void bench_report_fit(const char *name, const uint32_t *sizes,
+                             const double *means, uint32_t count) {
+    double mean_t = 0.0;
+    double best_coef = 0.0;
+    double best_rms = INFINITY;
+    bench_fit_t best = FIT_1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        mean_t += means[i];
+    }
+    mean_t /= count;
+
+    for (uint32_t f = 0; f < FIT_COUNT; f++) {
+        double num = 0.0;
+        double den = 0.0;
+
+        for (uint32_t i = 0; i < count; i++) {
+            double term = fit_term((bench_fit_t)f, sizes[i]);
+            num += means[i] * term;
+            den += term * term;
+        }
+
+        double coef = num / den;
+        double err = 0.0;
+
+        for (uint32_t i = 0; i < count; i++) {
+            double d = means[i] - coef * fit_term((bench_fit_t)f, sizes[i]);
+            err += d * d;
+        }
+
+        double rms = sqrt(err / count) / mean_t;
+        if (rms < best_rms) {
+            best_rms = rms;
+            best_coef = coef;
+            best = (bench_fit_t)f;
+        }
+    }
+
+    printf("\"%s_BigO\",,%.4f,%s,,,,\n", name, best_coef, fit_names[best]);
+    printf("\"%s_RMS\",,%.4f,,,,,\n", name, best_rms);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Runner */
+/*---------------------------------------------------------------------------*/
+
+static uint64_t bench_calibrate(const bench_t *b, uint32_t n, uint64_t min_ns) {
+    uint64_t iters = 1;
+
+    /* Grow the count until one repetition takes min_ns (at most x10 a step) */
+    while (iters < BENCH_MAX_ITERS) {
+        uint64_t elapsed = b->run(n, iters);
+
+        if (elapsed >= min_ns) {
+            break;
+        }
+
+        double mult = (elapsed > 0) ? (double)min_ns * 1.4 / (double)elapsed : 10.0;
+        if (mult > 10.0) {
+            mult = 10.0;
+        }
+
+        uint64_t next = (uint64_t)((double)iters * mult);
+        iters = (next > iters) ? next : iters + 1;
+    }
+
+    return (iters < BENCH_MAX_ITERS) ? iters : BENCH_MAX_ITERS;
+}
+
+static void bench_report_row(const char *name, uint32_t n, const char *aggregate,
+                             uint64_t iters, double ns, double items) {
+    printf("\"%s/%u_%s\",%llu,%.3f,ns,", name, n, aggregate,
+           (unsigned long long)iters, ns);
+    if (items > 0.0 && ns > 0.0) {
+        printf("%.6g", items * 1e9 / ns);
+    }
+    printf(",,,\n");
+}
+
+static int bench_run(const bench_t *b, uint32_t reps, uint64_t min_ns) {
+    uint32_t sizes[BENCH_SIZE_COUNT];
+    double means[BENCH_SIZE_COUNT];
+    double samples[BENCH_MAX_REPS];
+    uint32_t count = 0;
+    int failed = 0;
+
+    for (uint32_t n = BENCH_MIN_N; n <= BENCH_MAX_N; n *= 2) {
+        b->setup(n);
+
+        uint64_t iters = bench_calibrate(b, n, min_ns);
+
+        for (uint32_t r = 0; r < reps; r++) {
+            samples[r] = (double)b->run(n, iters) / (double)iters;
+        }
+
+        if (!b->check(n) || bench_mock_switches != 0) {
+            printf("\"%s/%u\",,,,,,true,\"kernel structure corrupted\"\n", b->name, n);
+            failed = 1;
+            continue;
+        }
+
+        bench_stats_t s = bench_stats(samples, reps);
+        double items = b->items_per_n ? (double)n : 1.0;
+
+        bench_report_row(b->name, n, "mean", iters, s.mean, items);
+        bench_report_row(b->name, n, "median", iters, s.median, items);
+        bench_report_row(b->name, n, "stddev", iters, s.stddev, 0.0);
+
+        sizes[count] = n;
+        means[count] = s.mean;
+        count++;
+    }
+
+    if (count > 1) {
+        bench_report_fit(b->name, sizes, means, count);
+    }
+
+    fflush(stdout);
+    return failed;
+}
+
+static uint64_t bench_clock_overhead(void) {
+    double samples[BENCH_MAX_REPS];
+
+    for (uint32_t i = 0; i < BENCH_MAX_REPS; i++) {
+        uint64_t start = bench_now_ns();
+        samples[i] = (double)(bench_now_ns() - start);
+    }
+
+    return (uint64_t)bench_stats(samples, BENCH_MAX_REPS).median;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Main Entry Point */
+/*---------------------------------------------------------------------------*/
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    uint32_t reps = BENCH_DEFAULT_REPS;
+    uint32_t min_ms = BENCH_DEFAULT_MIN_MS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--benchmark_filter=", 19) == 0) {
+            filter = argv[i] + 19;
+        } else if (strncmp(argv[i], "--benchmark_repetitions=", 24) == 0) {
+            reps = (uint32_t)strtoul(argv[i] + 24, NULL, 0);
+        } else if (strncmp(argv[i], "--benchmark_min_time=", 21) == 0) {
+            min_ms = (uint32_t)strtoul(argv[i] + 21, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--benchmark_filter=<substring>] "
+                    "[--benchmark_repetitions=<n>] [--benchmark_min_time=<ms>]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    if (reps < 1) {
+        reps = 1;
+    } else if (reps > BENCH_MAX_REPS) {
+        reps = BENCH_MAX_REPS;
+    }
+
+    clock_overhead_ns = bench_clock_overhead();
+
+    fprintf(stderr, "[BENCH] sizes %u..%u, %u repetitions, min %u ms each\n",
+            BENCH_MIN_N, BENCH_MAX_N, reps, min_ms);
+    fprintf(stderr, "[BENCH] clock overhead %llu ns (taken off per-call samples)\n",
+            (unsigned long long)clock_overhead_ns);
+
+    printf("name,iterations,real_time,time_unit,items_per_second,label,"
+           "error_occurred,error_message\n");
+
+    int failed = 0;
+
+    for (uint32_t i = 0; i < BENCH_COUNT; i++) {
+        if (filter == NULL || strstr(benchmarks[i].name, filter) != NULL) {
+            failed |= bench_run(&benchmarks[i], reps, (uint64_t)min_ms * 1000000ULL);
+        }
+    }
+
+    return failed ? 1 : 0;
+}
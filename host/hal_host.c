@@ -0,0 +1,40 @@
+/**
+ * @file hal_host.c
+ * @brief Host Port Console
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "hal.h"
+
+/*---------------------------------------------------------------------------*/
+/* Console Output */
+/*---------------------------------------------------------------------------*/
+
+void hal_printf(const char *fmt, ...) {
+    va_list args;
+
+    /* stdio is not reentrant: keep the tick from switching mid-line */
+    uint32_t state = rtos_enter_critical();
+
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+
+    rtos_exit_critical(state);
+}
+
+uint32_t hal_snprintf(char *buf, uint32_t size, const char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    int len = vsnprintf(buf, size, fmt, args);
+    va_end(args);
+
+    /* Characters written, as on the target, not the untruncated length */
+    if (len < 0 || size == 0) {
+        return 0;
+    }
+    return ((uint32_t)len < size) ? (uint32_t)len : size - 1;
+}
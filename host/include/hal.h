@@ -0,0 +1,30 @@
+/**
+ * @file hal.h
+ * @brief Host Port HAL Subset
+ *
+ * Only the console and formatting calls the kernel sources use. Output
+ * goes to stdout.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "stm32f4xx.h"
+#include "rtos_config.h"
+#include "rtos.h"
+
+/**
+ * @brief Print formatted output to the console (stdout)
+ * @param fmt Format string
+ */
+void hal_printf(const char *fmt, ...);
+
+/**
+ * @brief Format into a buffer
+ * @return Characters written, excluding the NUL (output is truncated)
+ */
+uint32_t hal_snprintf(char *buf, uint32_t size, const char *fmt, ...);
+
+#endif /* HAL_H */
@@ -0,0 +1,80 @@
+/**
+ * @file stm32f4xx.h
+ * @brief Host Port Stand-in for the STM32F4 Device Header
+ *
+ * The kernel sources include "stm32f4xx.h" for a handful of core
+ * intrinsics. The host build puts this directory first on the include
+ * path, so they resolve to the C equivalents below instead of Cortex-M4
+ * instructions and registers.
+ */
+
+#ifndef STM32F4XX_H
+#define STM32F4XX_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/* Core Intrinsics */
+/*---------------------------------------------------------------------------*/
+
+/* Count Leading Zeros - used for O(1) priority lookup */
+static inline uint32_t __CLZ(uint32_t value) {
+    return value ? (uint32_t)__builtin_clz(value) : 32;
+}
+
+/* Idle wait: the host port advances the tick (see rtos_port_host.c) */
+void rtos_host_wfi(void);
+
+static inline void __WFI(void) {
+    rtos_host_wfi();
+}
+
+static inline void __DSB(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __ISB(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __DMB(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Simulated Device Interrupt */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Raise a device interrupt as if it arrived while interrupts are masked:
+ * handler runs as an ISR the next time a critical section re-enables
+ * them outside an ISR, ahead of any pending PendSV. Lets a test land an
+ * interrupt in the window between a kernel call's critical section and
+ * its switch. One may be pending at a time.
+ */
+void rtos_host_irq_pend(void (*handler)(void));
+
+/*---------------------------------------------------------------------------*/
+/* Data Watchpoint and Trace (DWT) */
+/*---------------------------------------------------------------------------*/
+
+/* No cycle counter: reads as 0, as on QEMU */
+typedef struct {
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+extern DWT_Type rtos_host_dwt;
+#define DWT                     (&rtos_host_dwt)
+
+/*---------------------------------------------------------------------------*/
+/* Main Stack */
+/*---------------------------------------------------------------------------*/
+
+/* No linker-reserved MSP; the stack monitor watches a painted stand-in */
+#define RTOS_HOST_MSP_WORDS     1024
+
+extern uint32_t rtos_host_msp[RTOS_HOST_MSP_WORDS];
+#define MSP_WORDS               RTOS_HOST_MSP_WORDS
+#define MSP_BOTTOM              rtos_host_msp
+
+#endif /* STM32F4XX_H */
@@ -0,0 +1,236 @@
+/**
+ * @file main_host.c
+ * @brief Host Port Demo Scenario
+ *
+ * Exercises the scheduler paths of the firmware demo on the host: a
+ * producer and consumer over a queue (with receive timeouts), three tasks
+ * sharing a mutex at different priorities, a periodic soft timer, and a
+ * task woken by an interrupt between blocking and its context switch.
+ * A supervisor runs the scenario for a fixed simulated time, prints the
+ * counters and exits non-zero if any path made no progress.
+ *
+ * Usage: rtos_host_demo [run_ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rtos.h"
+#include "hal.h"
+
+/*---------------------------------------------------------------------------*/
+/* Configuration */
+/*---------------------------------------------------------------------------*/
+
+/* Host tasks call into libc, so stacks are far larger than on the target */
+#define HOST_STACK_WORDS    8192
+#define DEFAULT_RUN_MS      10000
+
+#define PRIO_SUPERVISOR     0
+#define PRIO_HIGH           1
+#define PRIO_MID            2
+#define PRIO_LOW            3
+
+/* Above the demo tasks, so a waiter woken in the window is picked again */
+#define PRIO_WINDOW         PRIO_SUPERVISOR
+
+/*---------------------------------------------------------------------------*/
+/* Scenario State */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t seq;
+    uint32_t sent_at;
+} demo_msg_t;
+
+static rtos_queue_t msg_queue;
+static demo_msg_t msg_buffer[8];
+static rtos_mutex_t shared_mutex;
+static rtos_timer_t heartbeat;
+
+static volatile uint32_t sent;
+static volatile uint32_t received;
+static volatile uint32_t recv_timeouts;
+static volatile uint32_t lock_count[3];
+static volatile uint32_t heartbeats;
+
+static rtos_sem_t window_sem;
+static rtos_sem_t peer_go;
+static volatile uint32_t window_wakes;
+static volatile uint32_t window_stuck;
+static volatile uint32_t peer_runs;
+static uint32_t run_ms = DEFAULT_RUN_MS;
+
+/*---------------------------------------------------------------------------*/
+/* Tasks */
+/*---------------------------------------------------------------------------*/
+
+static void producer_fn(void *arg) {
+    (void)arg;
+
+    while (1) {
+        demo_msg_t msg = { sent, rtos_now() };
+
+        if (rtos_queue_send(&msg_queue, &msg, 50) == RTOS_OK) {
+            sent++;
+        }
+
+        /* Bursts of four, then a gap longer than the consumer's timeout */
+        rtos_delay((sent % 4 == 0) ? 250 : 10);
+    }
+}
+
+static void consumer_fn(void *arg) {
+    (void)arg;
+    demo_msg_t msg;
+
+    while (1) {
+        if (rtos_queue_recv(&msg_queue, &msg, 100) == RTOS_OK) {
+            received++;
+        } else {
+            recv_timeouts++;
+        }
+    }
+}
+
+static void locker_fn(void *arg) {
+    uint32_t index = (uint32_t)(uintptr_t)arg;
+
+    while (1) {
+        if (rtos_mutex_lock(&shared_mutex, RTOS_WAIT_FOREVER) == RTOS_OK) {
+            lock_count[index]++;
+            rtos_delay(2);      /* Hold it across a tick */
+            rtos_mutex_unlock(&shared_mutex);
+        }
+        rtos_delay(5 + index * 3);
+    }
+}
+
+static void heartbeat_cb(void *arg) {
+    (void)arg;
+    heartbeats++;
+}
+
+/* Device interrupt: posts the semaphore the window task just blocked on */
+static void window_irq(void) {
+    rtos_isr_enter();
+    rtos_sem_post(&window_sem);
+    rtos_isr_exit();
+}
+
+/*
+ * The interrupt fires when rtos_sem_wait leaves its critical section, after
+ * the task is off the ready list but before the switch, so PendSV picks
+ * the same task again. It must come back as RUNNING: a yield then has to
+ * run the equal-priority peer.
+ */
+static void window_fn(void *arg) {
+    (void)arg;
+
+    while (1) {
+        rtos_host_irq_pend(window_irq);
+        if (rtos_sem_wait(&window_sem, 100) == RTOS_OK) {
+            window_wakes++;
+        }
+
+        uint32_t runs = peer_runs;
+        rtos_sem_post(&peer_go);
+        rtos_yield();
+        if (peer_runs == runs) {
+            window_stuck++;
+        }
+
+        rtos_delay(20);
+    }
+}
+
+static void peer_fn(void *arg) {
+    (void)arg;
+
+    while (1) {
+        rtos_sem_wait(&peer_go, RTOS_WAIT_FOREVER);
+        peer_runs++;
+    }
+}
+
+static void supervisor_fn(void *arg) {
+    (void)arg;
+
+    rtos_delay(run_ms);
+
+    hal_printf("[HOST] ran %u ms (tick %u)\n", run_ms, rtos_now());
+    hal_printf("[HOST] queue: sent=%u received=%u timeouts=%u\n",
+               sent, received, recv_timeouts);
+    hal_printf("[HOST] mutex: high=%u mid=%u low=%u\n",
+               lock_count[0], lock_count[1], lock_count[2]);
+    hal_printf("[HOST] timer: heartbeats=%u\n", heartbeats);
+    hal_printf("[HOST] window: wakes=%u stuck=%u\n", window_wakes, window_stuck);
+#if RTOS_ENABLE_STATS
+    hal_printf("[HOST] ctx_sw=%u idle_ticks=%u\n",
+               rtos_stats_context_switches(), rtos_stats_idle_ticks());
+#endif
+
+    int ok = sent > 0 && received > 0 && recv_timeouts > 0 &&
+             lock_count[0] > 0 && lock_count[1] > 0 && lock_count[2] > 0 &&
+             heartbeats > 0 && window_wakes > 0 && window_stuck == 0;
+
+    hal_printf("[HOST] %s\n", ok ? "PASS" : "FAIL");
+    fflush(stdout);
+    exit(ok ? 0 : 1);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Main Entry Point */
+/*---------------------------------------------------------------------------*/
+
+static uint32_t supervisor_stack[HOST_STACK_WORDS];
+static uint32_t producer_stack[HOST_STACK_WORDS];
+static uint32_t consumer_stack[HOST_STACK_WORDS];
+static uint32_t locker_stack[3][HOST_STACK_WORDS];
+
+static rtos_tcb_t supervisor_tcb;
+static rtos_tcb_t producer_tcb;
+static rtos_tcb_t consumer_tcb;
+static rtos_tcb_t locker_tcb[3];
+
+static uint32_t window_stack[HOST_STACK_WORDS];
+static uint32_t peer_stack[HOST_STACK_WORDS];
+static rtos_tcb_t window_tcb;
+static rtos_tcb_t peer_tcb;
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        run_ms = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+
+    rtos_init();
+
+    rtos_queue_init(&msg_queue, msg_buffer, sizeof(demo_msg_t), 8);
+    rtos_mutex_init(&shared_mutex);
+    rtos_timer_init(&heartbeat);
+    rtos_timer_start(&heartbeat, 100, heartbeat_cb, NULL);
+    rtos_sem_init(&window_sem, 0);
+    rtos_sem_init(&peer_go, 0);
+
+    rtos_task_create(supervisor_fn, "SUPER", PRIO_SUPERVISOR, supervisor_stack,
+                     HOST_STACK_WORDS, &supervisor_tcb, NULL);
+    rtos_task_create(producer_fn, "PROD", PRIO_MID, producer_stack,
+                     HOST_STACK_WORDS, &producer_tcb, NULL);
+    rtos_task_create(consumer_fn, "CONS", PRIO_HIGH, consumer_stack,
+                     HOST_STACK_WORDS, &consumer_tcb, NULL);
+
+    static const uint8_t locker_prio[3] = { PRIO_HIGH, PRIO_MID, PRIO_LOW };
+    for (uint32_t i = 0; i < 3; i++) {
+        rtos_task_create(locker_fn, "LOCK", locker_prio[i], locker_stack[i],
+                         HOST_STACK_WORDS, &locker_tcb[i], (void *)(uintptr_t)i);
+    }
+
+    rtos_task_create(window_fn, "WIN", PRIO_WINDOW, window_stack,
+                     HOST_STACK_WORDS, &window_tcb, NULL);
+    rtos_task_create(peer_fn, "PEER", PRIO_WINDOW, peer_stack,
+                     HOST_STACK_WORDS, &peer_tcb, NULL);
+
+    rtos_start();
+
+    return 0;
+}
@@ -0,0 +1,387 @@
+/**
+ * @file rtos_port_host.c
+ * @brief Host (Linux) Port Implementation
+ *
+ * Runs the unmodified kernel sources as a Linux process. Each task is a
+ * ucontext whose stack is the task's own stack array, so stack painting
+ * and the high-water monitor work as on the target.
+ *
+ * Interrupts are simulated on one CPU:
+ * - PRIMASK is host_primask; with the signal tick it also blocks SIGALRM
+ * - SysTick comes from the idle task (virtual clock, the default: time only
+ *   advances when every task is blocked, runs are deterministic) or from
+ *   an ITIMER_REAL SIGALRM (RTOS_HOST_VIRTUAL_TICK=0: real preemption)
+ * - A device interrupt (rtos_host_irq_pend) is taken when a critical
+ *   section next enables interrupts outside an ISR, ahead of PendSV
+ * - PendSV is a pending flag, taken as soon as interrupts are enabled
+ *   outside an ISR, or at the end of the tick or device interrupt
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include "rtos.h"
+#include "rtos_internal.h"
+#include "stm32f4xx.h"
+#include "hal.h"
+
+/*---------------------------------------------------------------------------*/
+/* External References */
+/*---------------------------------------------------------------------------*/
+extern rtos_kernel_t g_kernel;
+
+/*---------------------------------------------------------------------------*/
+/* Port Configuration */
+/*---------------------------------------------------------------------------*/
+
+/* 1 = tick advanced by the idle task, 0 = SIGALRM at RTOS_TICK_RATE_HZ */
+#ifndef RTOS_HOST_VIRTUAL_TICK
+#define RTOS_HOST_VIRTUAL_TICK  1
+#endif
+
+/* Saved task context, at the top of the task's stack */
+typedef struct {
+    ucontext_t ctx;
+    rtos_task_fn_t fn;
+    void *arg;
+} host_frame_t;
+
+#define HOST_FRAME(tcb)     ((host_frame_t *)(void *)(tcb)->stack_ptr)
+
+/* makecontext only uses ss_sp + ss_size (the top); the span is nominal */
+#define HOST_CONTEXT_SPAN   4096
+
+/* Simulated core state */
+static volatile sig_atomic_t host_primask;      /* 1 = interrupts disabled */
+static volatile sig_atomic_t host_in_isr;       /* Inside the tick handler */
+static volatile sig_atomic_t host_pendsv;       /* PendSV pending */
+static void (*volatile host_irq_handler)(void); /* Device interrupt pending */
+
+DWT_Type rtos_host_dwt;
+uint32_t rtos_host_msp[RTOS_HOST_MSP_WORDS];
+
+/*---------------------------------------------------------------------------*/
+/* Simulated PRIMASK */
+/*---------------------------------------------------------------------------*/
+
+static uint32_t host_irq_disable(void) {
+    uint32_t old = (uint32_t)host_primask;
+
+    if (!old) {
+#if !RTOS_HOST_VIRTUAL_TICK
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGALRM);
+        sigprocmask(SIG_BLOCK, &set, NULL);
+#endif
+        host_primask = 1;
+    }
+    return old;
+}
+
+static void host_irq_restore(uint32_t state) {
+    if (!state) {
+        host_primask = 0;
+#if !RTOS_HOST_VIRTUAL_TICK
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGALRM);
+        sigprocmask(SIG_UNBLOCK, &set, NULL);
+#endif
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* PendSV - Context Switch */
+/*---------------------------------------------------------------------------*/
+
+static void host_pendsv_handler(void) {
+    uint32_t state = host_irq_disable();
+
+    while (host_pendsv) {
+        host_pendsv = 0;
+
+        rtos_tcb_t *prev = g_kernel.current_task;
+        rtos_tcb_t *next = rtos_schedule();
+
+        if (next != prev) {
+            g_kernel.current_task = next;
+            swapcontext(&HOST_FRAME(prev)->ctx, &HOST_FRAME(next)->ctx);
+            /* Resumed: whatever was pended meanwhile is handled below */
+        }
+    }
+
+    host_irq_restore(state);
+}
+
+RTOS_RAMFUNC void rtos_trigger_context_switch(void) {
+    host_pendsv = 1;
+
+    /* Taken at once unless masked or in the tick; then on the way out */
+    if (!host_primask && !host_in_isr) {
+        host_pendsv_handler();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* SysTick Handler - System Tick */
+/*---------------------------------------------------------------------------*/
+
+static void host_systick(void) {
+    rtos_isr_enter();
+
+    uint32_t state = rtos_enter_critical();
+
+    /* Increment tick counter */
+    g_kernel.tick_count++;
+
+#if RTOS_ENABLE_STATS
+    if (g_kernel.current_task != NULL) {
+        g_kernel.current_task->total_ticks++;
+    }
+#endif
+
+    /* Process timers */
+    rtos_timer_tick();
+
+    /* Wake up delayed tasks (sets need_resched on a preempting wake) */
+    rtos_check_delayed_tasks();
+
+    /* Time slice among equal priorities */
+    if (g_kernel.scheduler_running && !g_kernel.scheduler_locked) {
+        rtos_rotate_current();
+    }
+
+    rtos_exit_critical(state);
+
+    /* Switch only if needed, once for the whole tick */
+    rtos_isr_exit();
+}
+
+/* Exception entry and exit around a handler, then the tail-chained PendSV */
+static void host_interrupt(void (*handler)(void)) {
+    uint32_t state = host_irq_disable();
+
+    host_in_isr = 1;
+    handler();
+    host_in_isr = 0;
+
+    host_irq_restore(state);
+
+    if (host_pendsv) {
+        host_pendsv_handler();
+    }
+}
+
+#if !RTOS_HOST_VIRTUAL_TICK
+static void host_sigalrm(int sig) {
+    (void)sig;
+
+    /* SIGALRM is blocked while this runs, like an active exception */
+    host_primask = 1;
+    host_in_isr = 1;
+    host_systick();
+    host_in_isr = 0;
+
+    if (host_pendsv) {
+        host_pendsv_handler();
+    }
+    host_primask = 0;
+}
+#endif
+
+void rtos_host_wfi(void) {
+#if RTOS_HOST_VIRTUAL_TICK
+    /* Nothing can run until the next tick, so take it now */
+    host_interrupt(host_systick);
+#else
+    sigset_t none;
+    sigemptyset(&none);
+    sigsuspend(&none);
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/* Device Interrupt */
+/*---------------------------------------------------------------------------*/
+
+static void host_take_irq(void) {
+    void (*handler)(void) = host_irq_handler;
+
+    host_irq_handler = NULL;
+    host_interrupt(handler);
+}
+
+void rtos_host_irq_pend(void (*handler)(void)) {
+    /* Taken by the next rtos_exit_critical that unmasks */
+    host_irq_handler = handler;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Port Initialization */
+/*---------------------------------------------------------------------------*/
+void rtos_port_init(void) {
+    host_primask = 0;
+    host_in_isr = 0;
+    host_pendsv = 0;
+    host_irq_handler = NULL;
+
+#if RTOS_ENABLE_STACK_CHECK
+    /* Reset_Handler paints the real main stack; paint the stand-in */
+    for (uint32_t i = 0; i < RTOS_HOST_MSP_WORDS; i++) {
+        rtos_host_msp[i] = 0xDEADBEEF;
+    }
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/* Stack Guard (no MPU on the host) */
+/*---------------------------------------------------------------------------*/
+void rtos_port_stack_guard_init(rtos_tcb_t *tcb) {
+    (void)tcb;
+}
+
+uint32_t rtos_port_stack_guard_words(const rtos_tcb_t *tcb) {
+    (void)tcb;
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Stack Initialization */
+/*---------------------------------------------------------------------------*/
+
+static void host_task_entry(void) {
+    host_frame_t *frame = HOST_FRAME(g_kernel.current_task);
+
+    /* First switch-in happens with interrupts masked by PendSV */
+    host_irq_restore(0);
+
+    frame->fn(frame->arg);
+
+    rtos_task_exit();
+}
+
+uint32_t *rtos_port_init_stack(uint32_t *stack_top, void (*task_fn)(void *), void *arg) {
+    /* The context lives at the top of the stack; the task runs below it */
+    uintptr_t top = ((uintptr_t)stack_top - sizeof(host_frame_t)) & ~(uintptr_t)63;
+    host_frame_t *frame = (host_frame_t *)top;
+
+    frame->fn = task_fn;
+    frame->arg = arg;
+
+    getcontext(&frame->ctx);
+
+    /* Starts masked, like every switch-in; host_task_entry unmasks */
+    sigemptyset(&frame->ctx.uc_sigmask);
+#if !RTOS_HOST_VIRTUAL_TICK
+    sigaddset(&frame->ctx.uc_sigmask, SIGALRM);
+#endif
+
+    frame->ctx.uc_stack.ss_sp = (char *)frame - HOST_CONTEXT_SPAN;
+    frame->ctx.uc_stack.ss_size = HOST_CONTEXT_SPAN;
+    frame->ctx.uc_link = NULL;
+    makecontext(&frame->ctx, host_task_entry, 0);
+
+    return (uint32_t *)(void *)frame;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Task Exit Handler (should never be called) */
+/*---------------------------------------------------------------------------*/
+void rtos_task_exit(void) {
+    /* Task returned from its function - suspend it for good */
+    rtos_task_suspend(NULL);
+
+    /* Only reached if the scheduler could not switch away */
+    abort();
+}
+
+/*---------------------------------------------------------------------------*/
+/* Start First Task */
+/*---------------------------------------------------------------------------*/
+void rtos_port_start_first_task(void) {
+#if !RTOS_HOST_VIRTUAL_TICK
+    struct sigaction sa;
+    sa.sa_handler = host_sigalrm;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGALRM, &sa, NULL);
+
+    struct itimerval period;
+    period.it_interval.tv_sec = 0;
+    period.it_interval.tv_usec = 1000000 / RTOS_TICK_RATE_HZ;
+    period.it_value = period.it_interval;
+    setitimer(ITIMER_REAL, &period, NULL);
+#endif
+
+    /* The main thread's context is abandoned, as MSP is on the target */
+    host_primask = 1;
+    setcontext(&HOST_FRAME(g_kernel.current_task)->ctx);
+
+    /* Should never reach here */
+    abort();
+}
+
+/*---------------------------------------------------------------------------*/
+/* Critical Section Implementation */
+/*---------------------------------------------------------------------------*/
+RTOS_RAMFUNC uint32_t rtos_enter_critical(void) {
+    return host_irq_disable();
+}
+
+RTOS_RAMFUNC void rtos_exit_critical(uint32_t state) {
+    host_irq_restore(state);
+
+    /* An interrupt, then a PendSV, pended inside the section is taken now */
+    if (!state && !host_in_isr) {
+        if (host_irq_handler != NULL) {
+            host_take_irq();
+        }
+        if (host_pendsv) {
+            host_pendsv_handler();
+        }
+    }
+}
+
+/* Public API wrappers */
+uint32_t rtos_critical_enter(void) {
+    return rtos_enter_critical();
+}
+
+void rtos_critical_exit(uint32_t state) {
+    rtos_exit_critical(state);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Interrupt Registration (no NVIC on the host) */
+/*---------------------------------------------------------------------------*/
+rtos_status_t rtos_irq_register(int32_t irqn, rtos_irq_handler_t handler,
+                                uint8_t priority) {
+    (void)irqn;
+    (void)handler;
+    (void)priority;
+    return RTOS_ERR_STATE;
+}
+
+void rtos_irq_enable(int32_t irqn) {
+    (void)irqn;
+}
+
+void rtos_irq_disable(int32_t irqn) {
+    (void)irqn;
+}
+
+void rtos_irq_set_priority(int32_t irqn, uint8_t priority) {
+    (void)irqn;
+    (void)priority;
+}
+
+/*---------------------------------------------------------------------------*/
+/* ISR Detection */
+/*---------------------------------------------------------------------------*/
+uint8_t rtos_in_isr(void) {
+    return host_in_isr ? 1 : 0;
+}
@@ -10,6 +10,7 @@
 #include <stddef.h>
 #include "stm32f4xx.h"
 #include "rtos_config.h"
+#include "rtos.h"
 
 /*---------------------------------------------------------------------------*/
 /* GPIO HAL */
@@ -69,6 +70,128 @@ uint8_t hal_gpio_read(GPIO_TypeDef *port, uint8_t pin);
  */
 void hal_gpio_enable_clock(GPIO_TypeDef *port);
 
+/**
+ * @brief Set and clear several pins of a port in one atomic write
+ * @param port GPIO port
+ * @param set_mask Pins to drive high
+ * @param clear_mask Pins to drive low (set_mask wins on overlap)
+ */
+void hal_gpio_write_mask(GPIO_TypeDef *port, uint16_t set_mask, uint16_t clear_mask);
+
+/**
+ * @brief Write a value to the masked pins of a port in one atomic write
+ * @param port GPIO port
+ * @param mask Pins to update
+ * @param value New levels (bits outside mask are ignored)
+ */
+void hal_gpio_write_port(GPIO_TypeDef *port, uint16_t mask, uint16_t value);
+
+/**
+ * @brief Read all 16 pins of a port
+ * @param port GPIO port
+ * @return Input levels
+ */
+uint16_t hal_gpio_read_port(GPIO_TypeDef *port);
+
+/*
+ * Inline variants for hot paths (bit-banged buses, timer callbacks).
+ * Same semantics as the functions above, without the call.
+ */
+
+static inline void hal_gpio_fast_set(GPIO_TypeDef *port, uint8_t pin) {
+    port->BSRR = 1UL << pin;
+}
+
+static inline void hal_gpio_fast_clear(GPIO_TypeDef *port, uint8_t pin) {
+    port->BSRR = 1UL << (pin + 16);
+}
+
+static inline void hal_gpio_fast_toggle(GPIO_TypeDef *port, uint8_t pin) {
+    uint32_t bit = 1UL << pin;
+
+    /* Reset if currently high, set if low: only this pin is written */
+    port->BSRR = (port->ODR & bit) ? (bit << 16) : bit;
+}
+
+static inline uint8_t hal_gpio_fast_read(GPIO_TypeDef *port, uint8_t pin) {
+    return (port->IDR >> pin) & 0x1;
+}
+
+static inline void hal_gpio_fast_write_mask(GPIO_TypeDef *port, uint16_t set_mask,
+                                            uint16_t clear_mask) {
+    port->BSRR = ((uint32_t)clear_mask << 16) | set_mask;
+}
+
+/* Bit-band aliases: a load or store on one word reads or writes one pin */
+#define HAL_GPIO_BB_OUT(port, pin)  BITBAND_PERIPH(&(port)->ODR, (pin))
+#define HAL_GPIO_BB_IN(port, pin)   BITBAND_PERIPH(&(port)->IDR, (pin))
+
+/*---------------------------------------------------------------------------*/
+/* EXTI HAL */
+/*---------------------------------------------------------------------------*/
+
+/* Edge selection */
+#define HAL_EXTI_RISING         0x01
+#define HAL_EXTI_FALLING        0x02
+#define HAL_EXTI_BOTH           0x03
+
+/**
+ * @brief EXTI line callback prototype
+ * @param pin Line (pin number 0-15)
+ * @param level Pin level after the edge
+ * @param arg User argument
+ * @note Called from interrupt context (EXTI or SysTick when debounced)
+ */
+typedef void (*hal_exti_cb_t)(uint8_t pin, uint8_t level, void *arg);
+
+/**
+ * @brief EXTI line configuration
+ */
+typedef struct {
+    GPIO_TypeDef *port;         /* GPIO port (pin already configured as input) */
+    uint8_t pin;                /* Pin number / EXTI line (0-15) */
+    uint8_t edge;               /* HAL_EXTI_RISING, FALLING or BOTH */
+    uint16_t debounce_ms;       /* Settle time, 0 to report every edge */
+    hal_exti_cb_t callback;     /* Called on each reported edge, or NULL */
+    void *arg;                  /* Argument passed to callback */
+    rtos_sem_t *sem;            /* Posted on each reported edge, or NULL */
+} hal_exti_config_t;
+
+/**
+ * @brief Route a GPIO pin to its EXTI line and enable the interrupt
+ * @param config Line configuration (callback and/or sem required)
+ * @return RTOS_OK, RTOS_ERR_PARAM, or RTOS_ERR_RESOURCE if the line is
+ *         already attached (each line serves one port)
+ * @note With debounce_ms set, the line is masked while a one-shot soft
+ *       timer waits for the contact to settle; nothing spins.
+ */
+rtos_status_t hal_exti_attach(const hal_exti_config_t *config);
+
+/**
+ * @brief Disable a line and free it
+ * @param pin Line (0-15)
+ */
+void hal_exti_detach(uint8_t pin);
+
+/**
+ * @brief Unmask an attached line
+ * @param pin Line (0-15)
+ */
+void hal_exti_enable(uint8_t pin);
+
+/**
+ * @brief Mask a line without detaching it
+ * @param pin Line (0-15)
+ */
+void hal_exti_disable(uint8_t pin);
+
+/**
+ * @brief Get the number of edges reported on a line
+ * @param pin Line (0-15)
+ * @return Event count since attach
+ */
+uint32_t hal_exti_events(uint8_t pin);
+
 /*---------------------------------------------------------------------------*/
 /* UART HAL */
 /*---------------------------------------------------------------------------*/
@@ -130,6 +253,501 @@ uint8_t hal_uart_rx_available(USART_TypeDef *uart);
  */
 uint8_t hal_uart_tx_ready(USART_TypeDef *uart);
 
+/**
+ * @brief Interrupt-driven UART error counters
+ */
+typedef struct {
+    uint32_t rx_overruns;   /* Bytes dropped because the RX ring was full */
+    uint32_t hw_overruns;   /* Bytes lost in hardware (USART_SR_ORE) */
+    uint32_t framing_errors;/* Frames received with USART_SR_FE set */
+    uint32_t dma_rx_overruns;/* Times a DMA RX reader was lapped */
+} hal_uart_stats_t;
+
+/**
+ * @brief Switch a UART to interrupt-driven operation
+ * @param uart UART peripheral (USART1 or USART2, already initialized)
+ * @param tx_buf TX ring storage
+ * @param tx_size TX ring size in bytes (power of 2)
+ * @param rx_buf RX ring storage
+ * @param rx_size RX ring size in bytes (power of 2)
+ * @return RTOS_OK on success, RTOS_ERR_PARAM on invalid arguments
+ * @note Must be called before the UART is used from several tasks
+ */
+rtos_status_t hal_uart_irq_init(USART_TypeDef *uart,
+                                uint8_t *tx_buf, uint32_t tx_size,
+                                uint8_t *rx_buf, uint32_t rx_size);
+
+/**
+ * @brief Queue bytes for interrupt-driven transmission
+ * @param uart UART peripheral
+ * @param buf Data to send
+ * @param len Number of bytes
+ * @param timeout_ms Timeout in ms (RTOS_WAIT_FOREVER for infinite)
+ * @return Number of bytes queued (less than len on timeout)
+ * @note Blocks while the TX ring is full instead of spinning on TXE
+ */
+uint32_t hal_uart_write(USART_TypeDef *uart, const void *buf, uint32_t len,
+                        uint32_t timeout_ms);
+
+/**
+ * @brief Read received bytes
+ * @param uart UART peripheral
+ * @param buf Destination buffer
+ * @param len Maximum number of bytes
+ * @param timeout_ms Timeout in ms (RTOS_WAIT_FOREVER for infinite)
+ * @return Number of bytes read (0 on timeout)
+ * @note Blocks until at least one byte is available, then returns what
+ *       is buffered up to len
+ */
+uint32_t hal_uart_read(USART_TypeDef *uart, void *buf, uint32_t len,
+                       uint32_t timeout_ms);
+
+/**
+ * @brief Get interrupt-driven UART error counters
+ * @param uart UART peripheral
+ * @param stats Output counters
+ */
+void hal_uart_get_stats(USART_TypeDef *uart, hal_uart_stats_t *stats);
+
+/**
+ * @brief DMA transmit completion callback
+ * @param buf Buffer that has been fully handed to the UART
+ * @param len Buffer length
+ * @param arg User argument
+ * @note Called from interrupt context; the buffer may be reused on return
+ */
+typedef void (*hal_uart_dma_cb_t)(const void *buf, uint32_t len, void *arg);
+
+/**
+ * @brief Enable DMA transmission on a UART
+ * @param uart UART peripheral (USART1 or USART2, already initialized)
+ * @return RTOS_OK on success, RTOS_ERR_PARAM if the UART has no DMA stream,
+ *         RTOS_ERR_RESOURCE if the stream is already claimed
+ */
+rtos_status_t hal_uart_dma_tx_init(USART_TypeDef *uart);
+
+/**
+ * @brief Submit a caller-owned buffer for DMA transmission (zero-copy)
+ * @param uart UART peripheral
+ * @param buf Data to send (must stay valid until the callback; not in CCM)
+ * @param len Number of bytes (1-65535)
+ * @param done Completion callback (may be NULL)
+ * @param arg Argument passed to callback
+ * @return RTOS_OK if queued, RTOS_ERR_RESOURCE if both slots are busy
+ * @note Two buffers can be outstanding: one in flight, one queued behind it
+ */
+rtos_status_t hal_uart_dma_submit(USART_TypeDef *uart, const void *buf,
+                                  uint32_t len, hal_uart_dma_cb_t done,
+                                  void *arg);
+
+/**
+ * @brief Wait until a DMA transmit slot is free
+ * @param uart UART peripheral
+ * @param timeout_ms Timeout in ms (RTOS_WAIT_FOREVER for infinite)
+ * @return RTOS_OK when a slot is free, RTOS_ERR_TIMEOUT on timeout
+ */
+rtos_status_t hal_uart_dma_tx_wait(USART_TypeDef *uart, uint32_t timeout_ms);
+
+/**
+ * @brief Start continuous circular DMA reception
+ * @param uart UART peripheral (USART1 or USART2, already initialized)
+ * @param buf Receive buffer (not in CCM)
+ * @param size Buffer size in bytes (2-65535)
+ * @return RTOS_OK on success, RTOS_ERR_PARAM if the UART has no DMA stream,
+ *         RTOS_ERR_RESOURCE if the stream is already claimed
+ * @note Replaces RXNE-interrupt reception on this UART
+ */
+rtos_status_t hal_uart_dma_rx_start(USART_TypeDef *uart, uint8_t *buf,
+                                    uint32_t size);
+
+/**
+ * @brief Wait for the next burst of received bytes
+ * @param uart UART peripheral
+ * @param data Set to the first new byte inside the DMA buffer
+ * @param timeout_ms Timeout in ms (RTOS_WAIT_FOREVER for infinite)
+ * @return Number of contiguous bytes at *data (0 on timeout)
+ * @note Wakes on half-transfer, transfer-complete and idle line. Bytes are
+ *       consumed in place and released by the next call; the reader must
+ *       keep up with the buffer or the overrun counter is incremented.
+ */
+uint32_t hal_uart_dma_rx_wait(USART_TypeDef *uart, const uint8_t **data,
+                              uint32_t timeout_ms);
+
+/*---------------------------------------------------------------------------*/
+/* DMA HAL */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief DMA stream interrupt handler prototype
+ * @param flags DMA_FLAG_* bits that were set (already cleared)
+ * @param arg User argument
+ * @note Called from interrupt context
+ */
+typedef void (*hal_dma_handler_t)(uint32_t flags, void *arg);
+
+/**
+ * @brief Enable clock for a DMA controller
+ * @param dma DMA controller (DMA1 or DMA2)
+ */
+void hal_dma_enable_clock(DMA_TypeDef *dma);
+
+/**
+ * @brief Get stream registers
+ * @param dma DMA controller
+ * @param stream Stream number (0-7)
+ * @return Stream register block
+ */
+DMA_Stream_TypeDef *hal_dma_stream(DMA_TypeDef *dma, uint8_t stream);
+
+/**
+ * @brief Disable a stream and wait until it has stopped
+ * @param dma DMA controller
+ * @param stream Stream number (0-7)
+ */
+void hal_dma_disable(DMA_TypeDef *dma, uint8_t stream);
+
+/**
+ * @brief Read a stream's interrupt flags
+ * @param dma DMA controller
+ * @param stream Stream number (0-7)
+ * @return DMA_FLAG_* bits
+ */
+uint32_t hal_dma_read_flags(DMA_TypeDef *dma, uint8_t stream);
+
+/**
+ * @brief Clear a stream's interrupt flags
+ * @param dma DMA controller
+ * @param stream Stream number (0-7)
+ * @param flags DMA_FLAG_* bits to clear
+ */
+void hal_dma_clear_flags(DMA_TypeDef *dma, uint8_t stream, uint32_t flags);
+
+/**
+ * @brief Install the interrupt handler for a stream
+ * @param dma DMA controller
+ * @param stream Stream number (0-7)
+ * @param handler Handler (NULL to remove)
+ * @param arg Argument passed to handler
+ */
+void hal_dma_set_handler(DMA_TypeDef *dma, uint8_t stream,
+                         hal_dma_handler_t handler, void *arg);
+
+/**
+ * @brief Get the interrupt number of a stream
+ * @param dma DMA controller
+ * @param stream Stream number (0-7)
+ * @return NVIC interrupt number
+ */
+IRQn_Type hal_dma_irqn(DMA_TypeDef *dma, uint8_t stream);
+
+/**
+ * @brief Reserve a stream for exclusive use
+ * @param dma DMA controller
+ * @param stream Stream number (0-7)
+ * @return RTOS_OK on success, RTOS_ERR_RESOURCE if already claimed
+ */
+rtos_status_t hal_dma_claim(DMA_TypeDef *dma, uint8_t stream);
+
+/**
+ * @brief Return a stream claimed with hal_dma_claim
+ * @param dma DMA controller
+ * @param stream Stream number (0-7)
+ */
+void hal_dma_release(DMA_TypeDef *dma, uint8_t stream);
+
+/* Stream selection for hal_dma_alloc */
+#define HAL_DMA_ANY_STREAM      0xFF
+
+/* Transfer direction (matches CR.DIR) */
+#define HAL_DMA_PERIPH_TO_MEM   0
+#define HAL_DMA_MEM_TO_PERIPH   1
+#define HAL_DMA_MEM_TO_MEM      2   /* DMA2 only; source goes in periph_addr */
+
+/* Data item size (matches CR.PSIZE/MSIZE) */
+#define HAL_DMA_SIZE_BYTE       0
+#define HAL_DMA_SIZE_HALFWORD   1
+#define HAL_DMA_SIZE_WORD       2
+
+/**
+ * @brief Stream transfer configuration
+ */
+typedef struct {
+    uint8_t channel;        /* Request channel (0-7) */
+    uint8_t direction;      /* HAL_DMA_PERIPH_TO_MEM, ... */
+    uint8_t periph_size;    /* HAL_DMA_SIZE_* */
+    uint8_t mem_size;       /* HAL_DMA_SIZE_* */
+    uint8_t periph_inc;     /* Increment peripheral address */
+    uint8_t mem_inc;        /* Increment memory address */
+    uint8_t circular;       /* Reload NDTR and restart when done */
+    uint8_t double_buffer;  /* Alternate between two buffers (implies circular) */
+    uint8_t priority;       /* 0 = low .. 3 = very high */
+    uint8_t half_irq;       /* Also interrupt at half transfer */
+} hal_dma_config_t;
+
+/**
+ * @brief Allocated stream state
+ */
+typedef struct {
+    DMA_TypeDef *dma;
+    uint8_t stream;
+    volatile uint8_t busy;          /* Transfer in progress */
+    uint32_t cr;                    /* Configured CR (without EN) */
+    uint32_t fcr;                   /* Configured FCR */
+    volatile uint32_t flags;        /* DMA_FLAG_* from the last interrupt */
+    uint32_t errors;                /* Transfer and direct mode errors */
+    rtos_sem_t done;                /* Posted on transfer complete or error */
+    hal_dma_handler_t callback;     /* Optional, called from the interrupt */
+    void *arg;
+} hal_dma_handle_t;
+
+/**
+ * @brief Claim a stream and hook its interrupt to a handle
+ * @param h Handle to initialize
+ * @param dma DMA controller
+ * @param stream Stream number (0-7) or HAL_DMA_ANY_STREAM
+ * @return RTOS_OK on success, RTOS_ERR_RESOURCE if no stream is free
+ */
+rtos_status_t hal_dma_alloc(hal_dma_handle_t *h, DMA_TypeDef *dma,
+                            uint8_t stream);
+
+/**
+ * @brief Stop a stream and release it
+ * @param h Stream handle
+ */
+void hal_dma_free(hal_dma_handle_t *h);
+
+/**
+ * @brief Set the transfer configuration used by the next hal_dma_start
+ * @param h Stream handle
+ * @param cfg Transfer configuration
+ * @return RTOS_OK, RTOS_ERR_PARAM if invalid, RTOS_ERR_STATE if busy
+ */
+rtos_status_t hal_dma_configure(hal_dma_handle_t *h, const hal_dma_config_t *cfg);
+
+/**
+ * @brief Install a per-interrupt callback on a handle
+ * @param h Stream handle
+ * @param callback Callback (NULL to remove)
+ * @param arg Argument passed to callback
+ */
+void hal_dma_set_callback(hal_dma_handle_t *h, hal_dma_handler_t callback,
+                          void *arg);
+
+/**
+ * @brief Start a transfer
+ * @param h Stream handle
+ * @param periph_addr Peripheral register (or source for memory-to-memory)
+ * @param mem0 Memory buffer (destination for memory-to-memory)
+ * @param mem1 Second buffer in double-buffer mode, else NULL
+ * @param count Number of data items (1-65535)
+ * @return RTOS_OK, RTOS_ERR_PARAM, or RTOS_ERR_STATE if busy
+ */
+rtos_status_t hal_dma_start(hal_dma_handle_t *h, uint32_t periph_addr,
+                            void *mem0, void *mem1, uint32_t count);
+
+/**
+ * @brief Block until the transfer (or the next circular pass) completes
+ * @param h Stream handle
+ * @param timeout_ms Timeout in ms (RTOS_WAIT_FOREVER for infinite)
+ * @return RTOS_OK, RTOS_ERR_TIMEOUT, or RTOS_ERR_STATE on transfer error
+ */
+rtos_status_t hal_dma_wait(hal_dma_handle_t *h, uint32_t timeout_ms);
+
+/**
+ * @brief Abort a transfer
+ * @param h Stream handle
+ */
+void hal_dma_stop(hal_dma_handle_t *h);
+
+/**
+ * @brief Get the number of data items not yet transferred
+ * @param h Stream handle
+ * @return NDTR value
+ */
+uint32_t hal_dma_remaining(hal_dma_handle_t *h);
+
+/**
+ * @brief Get the buffer the stream is filling in double-buffer mode
+ * @param h Stream handle
+ * @return 0 for mem0, 1 for mem1
+ */
+uint8_t hal_dma_current_target(hal_dma_handle_t *h);
+
+/**
+ * @brief Replace the idle buffer in double-buffer mode
+ * @param h Stream handle
+ * @param target 0 for mem0, 1 for mem1
+ * @param mem New buffer
+ * @return RTOS_OK, or RTOS_ERR_STATE if target is in use by the stream
+ */
+rtos_status_t hal_dma_set_buffer(hal_dma_handle_t *h, uint8_t target, void *mem);
+
+/**
+ * @brief Start a memory copy on the DMA2 memcpy stream
+ * @param dst Destination
+ * @param src Source
+ * @param len Length in bytes
+ * @return RTOS_OK on success
+ * @note Copies shorter than RTOS_DMA_MEMCPY_THRESHOLD, or touching CCM
+ *       (which DMA cannot reach), are done by the CPU before returning.
+ *       Always pair with rtos_dma_memcpy_wait from the same task; neither
+ *       buffer may be touched until then.
+ */
+rtos_status_t rtos_dma_memcpy_async(void *dst, const void *src, uint32_t len);
+
+/**
+ * @brief Wait for the calling task's rtos_dma_memcpy_async to finish
+ * @param timeout_ms Timeout in ms (RTOS_WAIT_FOREVER for infinite)
+ * @return RTOS_OK, RTOS_ERR_TIMEOUT (call again), or RTOS_ERR_STATE
+ */
+rtos_status_t rtos_dma_memcpy_wait(uint32_t timeout_ms);
+
+/**
+ * @brief Copy memory using DMA and block until done
+ * @param dst Destination
+ * @param src Source
+ * @param len Length in bytes
+ * @return RTOS_OK on success
+ */
+rtos_status_t rtos_dma_memcpy(void *dst, const void *src, uint32_t len);
+
+/*---------------------------------------------------------------------------*/
+/* ADC HAL */
+/*---------------------------------------------------------------------------*/
+
+/* ADC sample time codes (ADC clock cycles) */
+#define HAL_ADC_SMP_3           0
+#define HAL_ADC_SMP_15          1
+#define HAL_ADC_SMP_28          2
+#define HAL_ADC_SMP_56          3
+#define HAL_ADC_SMP_84          4
+#define HAL_ADC_SMP_112         5
+#define HAL_ADC_SMP_144         6
+#define HAL_ADC_SMP_480         7
+
+/**
+ * @brief Continuous sampling configuration
+ */
+typedef struct {
+    const uint8_t *channels;    /* ADC1 channels scanned per trigger (0-18) */
+    uint8_t num_channels;       /* Channels in the scan (1-16) */
+    uint8_t sample_time;        /* HAL_ADC_SMP_* for every channel */
+    uint32_t sample_rate_hz;    /* Scan rate (TIM2 trigger frequency) */
+    uint16_t *buf0;             /* Ping-pong buffers (not in CCM) */
+    uint16_t *buf1;
+    uint32_t block_samples;     /* Samples per buffer, multiple of num_channels */
+} hal_adc_config_t;
+
+/**
+ * @brief Completed sample block
+ */
+typedef struct {
+    const uint16_t *samples;    /* Interleaved samples, in scan order */
+    uint32_t count;             /* Number of samples */
+    uint32_t sequence;          /* Block number since start */
+    uint32_t timestamp;         /* Tick at which the block completed */
+    uint8_t overrun;            /* Samples were lost before this block */
+} hal_adc_block_t;
+
+/**
+ * @brief Sampler statistics
+ */
+typedef struct {
+    uint32_t blocks;            /* Blocks completed */
+    uint32_t overruns;          /* Blocks overwritten before release */
+    uint32_t adc_overruns;      /* Conversions lost by the ADC */
+    uint32_t dma_errors;        /* DMA transfer errors */
+} hal_adc_stats_t;
+
+/**
+ * @brief Start timer-triggered sampling into DMA ping-pong buffers
+ * @param config Sampling configuration
+ * @return RTOS_OK, RTOS_ERR_PARAM, RTOS_ERR_STATE if already running,
+ *         or RTOS_ERR_RESOURCE if DMA2 Stream 0 is taken
+ * @note Uses ADC1, TIM2 and DMA2 Stream 0. The analog pins must already
+ *       be in GPIO_MODE_ANALOG. No interrupt is taken per sample.
+ */
+rtos_status_t hal_adc_start(const hal_adc_config_t *config);
+
+/**
+ * @brief Stop sampling and release the DMA stream
+ */
+void hal_adc_stop(void);
+
+/**
+ * @brief Wait for the next completed block
+ * @param block Filled with the block descriptor
+ * @param timeout_ms Timeout in ms (RTOS_WAIT_FOREVER for infinite)
+ * @return RTOS_OK on success, RTOS_ERR_TIMEOUT on timeout
+ * @note Samples are read in place. Release the block before the other
+ *       buffer fills, or it is overwritten and the next block reports
+ *       an overrun.
+ */
+rtos_status_t hal_adc_wait_block(hal_adc_block_t *block, uint32_t timeout_ms);
+
+/**
+ * @brief Hand a block's buffer back to the sampler
+ * @param block Block returned by hal_adc_wait_block
+ */
+void hal_adc_release_block(const hal_adc_block_t *block);
+
+/**
+ * @brief Get sampler statistics
+ * @param stats Filled with current counters
+ */
+void hal_adc_get_stats(hal_adc_stats_t *stats);
+
+/*---------------------------------------------------------------------------*/
+/* Clock HAL */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief Switch SYSCLK to the PLL
+ * @param sysclk_hz Target SYSCLK in Hz (multiple of 1 MHz, max 168 MHz)
+ * @return RTOS_OK, RTOS_ERR_PARAM, or RTOS_ERR_TIMEOUT if the PLL did not
+ *         lock (the system is left on HSI)
+ * @note Uses HSE when RTOS_HSE_HZ is set and the crystal starts, else HSI.
+ *       Sets FLASH wait states, prefetch and I/D caches, and the smallest
+ *       APB dividers within 42 MHz (APB1) and 84 MHz (APB2).
+ */
+rtos_status_t hal_clock_init(uint32_t sysclk_hz);
+
+/**
+ * @brief Recompute the cached bus clocks from RCC
+ */
+void hal_clock_update(void);
+
+/**
+ * @brief Get SYSCLK frequency
+ * @return Frequency in Hz
+ */
+uint32_t hal_clock_sysclk(void);
+
+/**
+ * @brief Get AHB (CPU, SysTick) frequency
+ * @return Frequency in Hz
+ */
+uint32_t hal_clock_hclk(void);
+
+/**
+ * @brief Get APB1 peripheral clock (USART2, TIM2 bus)
+ * @return Frequency in Hz
+ */
+uint32_t hal_clock_pclk1(void);
+
+/**
+ * @brief Get APB2 peripheral clock (USART1, ADC bus)
+ * @return Frequency in Hz
+ */
+uint32_t hal_clock_pclk2(void);
+
+/**
+ * @brief Get the timer kernel clock of an APB bus
+ * @param apb 1 or 2
+ * @return Frequency in Hz (twice PCLK when the bus is divided)
+ */
+uint32_t hal_clock_timer(uint8_t apb);
+
 /*---------------------------------------------------------------------------*/
 /* System HAL */
 /*---------------------------------------------------------------------------*/
@@ -150,12 +768,25 @@ void hal_delay_ms(uint32_t ms);
 /*---------------------------------------------------------------------------*/
 
 /**
- * @brief Print formatted string to UART
+ * @brief Print formatted string to the host console
  * @param fmt Format string
  * @param ... Arguments
+ * @note Buffered and written with one semihosting call, so output from
+ *       concurrent tasks does not interleave within a line
  */
 void hal_printf(const char *fmt, ...);
 
+/**
+ * @brief Format into a buffer (the hal_printf conversions)
+ * @param buf Destination, always NUL-terminated
+ * @param size Buffer size in bytes
+ * @param fmt Format string
+ * @param ... Arguments
+ * @return Characters written, excluding the NUL; output that does not fit
+ *         is dropped
+ */
+uint32_t hal_snprintf(char *buf, uint32_t size, const char *fmt, ...);
+
 /**
  * @brief Print debug message with tag
  * @param tag Message tag (e.g., "BOOT", "TASK")
@@ -163,4 +794,136 @@ void hal_printf(const char *fmt, ...);
  */
 void hal_debug(const char *tag, const char *msg);
 
+/**
+ * @brief Write raw bytes to the host console
+ * @param buf Data to write
+ * @param len Number of bytes
+ */
+void hal_console_write(const char *buf, uint32_t len);
+
+/**
+ * @brief Redirect console output to a semihosting handle
+ * @param handle Handle from hal_semihost_open (e.g. a host log file), or -1
+ *               to go back to the host terminal
+ * @note The caller still owns and closes the handle
+ */
+void hal_console_set_handle(int32_t handle);
+
+/*---------------------------------------------------------------------------*/
+/* Semihosting */
+/*---------------------------------------------------------------------------*/
+
+/* SYS_OPEN modes (fopen equivalents) */
+#define HAL_SEMIHOST_MODE_R     0       /* "r" */
+#define HAL_SEMIHOST_MODE_RB    1       /* "rb" */
+#define HAL_SEMIHOST_MODE_W     4       /* "w" */
+#define HAL_SEMIHOST_MODE_WB    5       /* "wb" */
+#define HAL_SEMIHOST_MODE_A     8       /* "a" */
+
+/**
+ * @brief Open a host file (":tt" is the host console)
+ * @param path Host path
+ * @param mode HAL_SEMIHOST_MODE_* value
+ * @return Handle, or -1 on error
+ */
+int32_t hal_semihost_open(const char *path, uint32_t mode);
+
+/**
+ * @brief Write a buffer to a host file with a single SYS_WRITE
+ * @param handle Handle from hal_semihost_open
+ * @param buf Data to write
+ * @param len Number of bytes
+ */
+void hal_semihost_write(int32_t handle, const void *buf, uint32_t len);
+
+/**
+ * @brief Read from a host file with a single SYS_READ
+ * @param handle Handle from hal_semihost_open
+ * @param buf Destination buffer
+ * @param len Buffer size in bytes
+ * @return Number of bytes read (0 at end of file or on error)
+ */
+uint32_t hal_semihost_read(int32_t handle, void *buf, uint32_t len);
+
+/**
+ * @brief Close a host file
+ * @param handle Handle from hal_semihost_open
+ */
+void hal_semihost_close(int32_t handle);
+
+/*---------------------------------------------------------------------------*/
+/* Deferred Binary Log */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * HAL_LOG() stores the format string in the non-loaded .hal_log_fmt section
+ * and writes only its section offset, the tick count and the raw 32-bit
+ * arguments into a lock-free ring. Formatting happens on the host
+ * (scripts/log_decode.py) against rtos.elf. Arguments must be integers;
+ * %s is not supported because the target memory is not available there.
+ *
+ * Frame layout (little-endian words):
+ *   [0] HAL_LOG_FRAME_VALID | nargs << 24 | format offset
+ *   [1] tick count
+ *   [2..] arguments
+ */
+#define HAL_LOG_FRAME_VALID     0x80000000UL
+#define HAL_LOG_MAX_ARGS        15
+
+#if RTOS_ENABLE_LOG
+#define HAL_LOG(fmt, ...) do {                                                  \
+    static const char hal_log_fmt_[]                                            \
+        __attribute__((section(".hal_log_fmt"), used)) = fmt;                   \
+    const uint32_t hal_log_args_[] = { 0, ##__VA_ARGS__ };                     \
+    hal_log_write((uint32_t)hal_log_fmt_, &hal_log_args_[1],                    \
+                  (sizeof(hal_log_args_) / sizeof(uint32_t)) - 1);              \
+} while (0)
+#else
+#define HAL_LOG(fmt, ...) do {                                                  \
+    if (0) {                                                                    \
+        const uint32_t hal_log_args_[] = { 0, ##__VA_ARGS__ };                 \
+        (void)hal_log_args_;                                                    \
+    }                                                                           \
+} while (0)
+#endif
+
+/**
+ * @brief Log sink prototype (receives encoded frames)
+ */
+typedef void (*hal_log_sink_t)(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Append a log frame to the ring (use HAL_LOG instead)
+ * @param fmt_id Format string offset in .hal_log_fmt
+ * @param args Argument words
+ * @param nargs Number of arguments (max HAL_LOG_MAX_ARGS)
+ * @note Lock-free, callable from tasks and ISRs
+ */
+void hal_log_write(uint32_t fmt_id, const uint32_t *args, uint32_t nargs);
+
+/**
+ * @brief Ship all committed frames to the sink
+ * @return Number of frames drained
+ * @note Single consumer - call from one task only
+ */
+uint32_t hal_log_drain(void);
+
+/**
+ * @brief Set the output sink used by hal_log_drain
+ * @param sink Sink function (NULL restores the default USART2 sink)
+ */
+void hal_log_set_sink(hal_log_sink_t sink);
+
+/**
+ * @brief Get number of frames dropped because the ring was full
+ * @return Dropped frame count
+ */
+uint32_t hal_log_dropped(void);
+
+/**
+ * @brief Low-priority task that periodically drains the log ring
+ * @param arg Unused
+ */
+void hal_log_drain_task(void *arg);
+
 #endif /* HAL_H */
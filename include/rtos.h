@@ -25,6 +25,25 @@ extern "C" {
 /* Type Definitions */
 /*---------------------------------------------------------------------------*/
 
+/**
+ * @brief Core-coupled RAM placement (64KB at 0x10000000)
+ *
+ * CCM is zero-wait-state and sits on the CPU data bus only, so it never
+ * contends with DMA on the bus matrix - and DMA cannot reach it. Use it
+ * for stacks and kernel data, never for DMA buffers.
+ *
+ * RTOS_CCM places zero-initialized data, RTOS_CCM_DATA initialized data.
+ * RTOS_KERNEL_DATA follows RTOS_KERNEL_IN_CCM.
+ */
+#define RTOS_CCM                __attribute__((section(".ccmbss")))
+#define RTOS_CCM_DATA           __attribute__((section(".ccmdata")))
+
+#if RTOS_KERNEL_IN_CCM
+#define RTOS_KERNEL_DATA        RTOS_CCM
+#else
+#define RTOS_KERNEL_DATA
+#endif
+
 /**
  * @brief Task function prototype
  */
@@ -52,6 +71,16 @@ void rtos_start(void);
  */
 uint32_t rtos_now(void);
 
+#if RTOS_ENABLE_BOOT_PROFILE
+/**
+ * @brief Boot profiling hook, called once just before the first task runs
+ * @param cycles CPU cycles since Reset_Handler (DWT), 0 where the DWT
+ *               cycle counter is not implemented (QEMU)
+ * @note Weak; the default does nothing. Runs in rtos_start on the main stack
+ */
+void rtos_boot_hook(uint32_t cycles);
+#endif
+
 /**
  * @brief Check if scheduler is running
  * @return 1 if running, 0 otherwise
@@ -64,6 +93,18 @@ uint8_t rtos_is_running(void);
  */
 uint8_t rtos_in_isr(void);
 
+/**
+ * @brief Mark entry to an interrupt handler that calls the kernel
+ * @note Pair with rtos_isr_exit. Wakeups made in between only flag a
+ *       reschedule; the outermost rtos_isr_exit pends one context switch
+ */
+void rtos_isr_enter(void);
+
+/**
+ * @brief Mark exit from an interrupt handler entered with rtos_isr_enter
+ */
+void rtos_isr_exit(void);
+
 /*---------------------------------------------------------------------------*/
 /* Task API */
 /*---------------------------------------------------------------------------*/
@@ -71,7 +112,7 @@ uint8_t rtos_in_isr(void);
 /**
  * @brief Create a new task
  * @param fn Task function
- * @param name Task name (max 15 chars)
+ * @param name Task name (max RTOS_TASK_NAME_LEN - 1 chars)
  * @param priority Task priority (0 = highest, RTOS_MAX_PRIORITIES-1 = lowest)
  * @param stack Stack memory (must be word-aligned)
  * @param stack_size Stack size in words
@@ -135,6 +176,56 @@ const char *rtos_task_name(rtos_tcb_t *tcb);
  */
 uint8_t rtos_task_priority(rtos_tcb_t *tcb);
 
+#if RTOS_ENABLE_STACK_CHECK
+/**
+ * @brief Get unused stack space (scans down to the current high-water mark)
+ * @param tcb Task TCB
+ * @return Bytes never used since the task was created
+ */
+uint32_t rtos_task_stack_unused(rtos_tcb_t *tcb);
+
+/**
+ * @brief Get peak stack use as last seen by the idle-task stack monitor
+ * @param tcb Task TCB
+ * @return Peak bytes used (no scan; may lag by one monitor pass)
+ */
+uint32_t rtos_task_stack_peak(rtos_tcb_t *tcb);
+
+/**
+ * @brief Check whether a task has used its whole stack
+ * @param tcb Task TCB
+ * @return 1 if the lowest usable stack word was overwritten, 0 otherwise
+ */
+uint8_t rtos_task_stack_overflow(rtos_tcb_t *tcb);
+
+/**
+ * @brief Get peak main stack (MSP) use by startup code and interrupts
+ * @return Peak bytes used out of _Min_Stack_Size
+ */
+uint32_t rtos_msp_stack_peak(void);
+
+/**
+ * @brief Format recommended stack sizes as a C header
+ * @param buf Destination, NUL-terminated (about 64 bytes per task plus 256)
+ * @param size Buffer size in bytes
+ * @return Length of the report; it is cut short if buf is too small
+ * @note Each size is the peak use seen so far plus RTOS_STACK_REPORT_MARGIN
+ *       percent (and room for the MPU guard), so call it at the end of a
+ *       representative workload run.
+ */
+uint32_t rtos_stack_report(char *buf, uint32_t size);
+#endif
+
+#if RTOS_ENABLE_MPU_GUARD
+/**
+ * @brief Stack overflow hook, called from MemManage when a task hits its guard
+ * @param tcb The task whose stack overflowed
+ * @note Weak; the default does nothing. Runs in the fault handler on the
+ *       main stack with interrupts disabled; the system halts afterwards.
+ */
+void rtos_stack_overflow_hook(rtos_tcb_t *tcb);
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* Semaphore API */
 /*---------------------------------------------------------------------------*/
@@ -320,6 +411,105 @@ uint32_t rtos_critical_enter(void);
  */
 void rtos_critical_exit(uint32_t state);
 
+/*---------------------------------------------------------------------------*/
+/* Interrupt API */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief Interrupt handler prototype
+ */
+typedef void (*rtos_irq_handler_t)(void);
+
+/**
+ * @brief Install an interrupt handler in the RAM vector table
+ * @param irqn External interrupt number (IRQn_Type, >= 0)
+ * @param handler Handler; wrap kernel calls in rtos_isr_enter/rtos_isr_exit
+ * @param priority NVIC priority (0-15, 0 = highest)
+ * @return RTOS_OK, RTOS_ERR_PARAM, or RTOS_ERR_STATE without
+ *         RTOS_ENABLE_RAM_VECTORS
+ * @note Does not enable the interrupt; call rtos_irq_enable afterwards
+ */
+rtos_status_t rtos_irq_register(int32_t irqn, rtos_irq_handler_t handler,
+                                uint8_t priority);
+
+/**
+ * @brief Clear any stale pending state and enable an interrupt
+ * @param irqn External interrupt number
+ */
+void rtos_irq_enable(int32_t irqn);
+
+/**
+ * @brief Disable an interrupt; it will not be taken after this returns
+ * @param irqn External interrupt number
+ */
+void rtos_irq_disable(int32_t irqn);
+
+/**
+ * @brief Set an interrupt's NVIC priority
+ * @param irqn External interrupt number
+ * @param priority NVIC priority (0-15, 0 = highest)
+ */
+void rtos_irq_set_priority(int32_t irqn, uint8_t priority);
+
+/*---------------------------------------------------------------------------*/
+/* Memory API */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief Copy memory (kernel replacement for memcpy)
+ * @param dst Destination (any alignment)
+ * @param src Source (any alignment, must not overlap dst)
+ * @param len Number of bytes
+ * @return dst
+ * @note Copies between word-aligned buffers move 32 bytes per LDM/STM
+ */
+void *rtos_memcpy(void *dst, const void *src, uint32_t len);
+
+/**
+ * @brief Fill memory (kernel replacement for memset)
+ * @param dst Destination (any alignment)
+ * @param value Byte value to store
+ * @param len Number of bytes
+ * @return dst
+ */
+void *rtos_memset(void *dst, uint8_t value, uint32_t len);
+
+/* Word access that may alias any type (e.g. uint8_t message buffers) */
+typedef uint32_t __attribute__((may_alias)) rtos_word_t;
+
+/**
+ * @brief Copy a message, fully inlined for word-aligned 4/8/16/32 bytes
+ * @note Other sizes and alignments go through rtos_memcpy
+ */
+static inline void rtos_memcpy_msg(void *dst, const void *src, uint32_t len) {
+    rtos_word_t *d = (rtos_word_t *)dst;
+    const rtos_word_t *s = (const rtos_word_t *)src;
+
+    if ((((uint32_t)(uintptr_t)dst | (uint32_t)(uintptr_t)src) & 3) == 0) {
+        switch (len) {
+        case 32:
+            d[7] = s[7];
+            d[6] = s[6];
+            d[5] = s[5];
+            d[4] = s[4];
+            /* fall through */
+        case 16:
+            d[3] = s[3];
+            d[2] = s[2];
+            /* fall through */
+        case 8:
+            d[1] = s[1];
+            /* fall through */
+        case 4:
+            d[0] = s[0];
+            return;
+        default:
+            break;
+        }
+    }
+    rtos_memcpy(dst, src, len);
+}
+
 /*---------------------------------------------------------------------------*/
 /* Statistics API (if enabled) */
 /*---------------------------------------------------------------------------*/
@@ -343,6 +533,33 @@ uint32_t rtos_stats_idle_ticks(void);
  * @return Number of times task has been scheduled
  */
 uint32_t rtos_stats_task_runs(rtos_tcb_t *tcb);
+
+/**
+ * @brief Get task run time
+ * @param tcb Task TCB
+ * @return Number of ticks on which the task was running
+ */
+uint32_t rtos_stats_task_ticks(rtos_tcb_t *tcb);
+
+/**
+ * @brief Get ISR entry count at one nesting depth
+ * @param depth Nesting depth, 1 = outermost; the last level
+ *              (RTOS_ISR_NEST_LEVELS) also counts everything deeper
+ * @return Number of rtos_isr_enter calls at that depth
+ */
+uint32_t rtos_stats_isr_entries(uint32_t depth);
+
+/**
+ * @brief Get number of context switches requested at outermost ISR exit
+ * @return Coalesced PendSV requests from rtos_isr_exit
+ */
+uint32_t rtos_stats_isr_switches(void);
+
+/**
+ * @brief Get deepest ISR nesting seen
+ * @return Maximum rtos_isr_enter depth
+ */
+uint8_t rtos_stats_isr_max_nesting(void);
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,259 @@
+/**
+ * @file rtos.hpp
+ * @brief Header-only C++17 Wrappers for the RTOS API
+ *
+ * Each wrapper owns the kernel object (and its stack or ring buffer, sized
+ * from template arguments) and forwards to the C API, so at -O2 a call
+ * compiles to the same code as the hand-written C call; the build checks
+ * this (bench/cxx_zero_cost.cpp). Nothing throws, nothing is virtual, so
+ * -fno-exceptions -fno-rtti work.
+ *
+ * startup.c runs no static constructors. All constructors are constexpr
+ * and leave the object in the state its init function would, so global
+ * wrappers are constant-initialized and usable before main without any
+ * rtos_*_init call. Task stacks are still set up by Task::start.
+ */
+
+#ifndef RTOS_HPP
+#define RTOS_HPP
+
+#if __cplusplus < 201703L
+#error "rtos.hpp needs C++17"
+#endif
+
+#include <type_traits>
+
+#include "rtos.h"
+
+namespace rtos {
+
+namespace detail {
+
+/* Trampoline: a kernel callback that calls the callable behind arg */
+template <typename F>
+void invoke(void *arg) {
+    (*static_cast<F *>(arg))();
+}
+
+/* Callables are passed by address; a const one is never modified */
+template <typename F>
+void *callable_arg(F &fn) {
+    return const_cast<void *>(static_cast<const void *>(&fn));
+}
+
+} // namespace detail
+
+/*---------------------------------------------------------------------------*/
+/* Task */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief Task with its stack and TCB
+ * @tparam StackWords Stack size in words
+ * @tparam Priority Task priority (0 = highest)
+ */
+template <uint32_t StackWords, uint8_t Priority>
+class Task {
+    static_assert(StackWords >= RTOS_MIN_STACK_WORDS && StackWords <= UINT16_MAX,
+                  "Stack must be RTOS_MIN_STACK_WORDS..65535 words");
+    static_assert(Priority < RTOS_MAX_PRIORITIES, "Priority must be below RTOS_MAX_PRIORITIES");
+
+public:
+    constexpr Task() : tcb_{}, stack_{} {}
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    /**
+     * @brief Create the task with a C entry point
+     * @return RTOS_OK on success
+     */
+    rtos_status_t start(rtos_task_fn_t fn, void *arg = nullptr, const char *name = nullptr) {
+        return rtos_task_create(fn, name, Priority, stack_, StackWords, &tcb_, arg);
+    }
+
+    /**
+     * @brief Create the task running fn() (a lambda or function object)
+     * @note fn is called through its address and must outlive the task
+     */
+    template <typename F>
+    rtos_status_t start(F &fn, const char *name = nullptr) {
+        return rtos_task_create(&detail::invoke<F>, name, Priority, stack_, StackWords,
+                                &tcb_, detail::callable_arg(fn));
+    }
+
+    rtos_status_t suspend() { return rtos_task_suspend(&tcb_); }
+    rtos_status_t resume() { return rtos_task_resume(&tcb_); }
+    const char *name() { return rtos_task_name(&tcb_); }
+
+#if RTOS_ENABLE_STACK_CHECK
+    uint32_t stack_unused() { return rtos_task_stack_unused(&tcb_); }
+    uint32_t stack_peak() { return rtos_task_stack_peak(&tcb_); }
+#endif
+
+    /** @brief The TCB, for the C API */
+    rtos_tcb_t *handle() { return &tcb_; }
+
+private:
+    rtos_tcb_t tcb_;
+    alignas(8) uint32_t stack_[StackWords];
+};
+
+/*---------------------------------------------------------------------------*/
+/* Queue */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief Typed message queue with its ring buffer
+ * @tparam T Message type, copied bytewise
+ * @tparam Depth Maximum number of messages
+ * @note The message size is a constant; 4/8/16/32-byte messages take the
+ *       inlined copy in rtos_memcpy_msg
+ */
+template <typename T, uint32_t Depth>
+class Queue {
+    static_assert(std::is_trivially_copyable<T>::value, "Queue messages are copied bytewise");
+    static_assert(Depth > 0, "Queue depth must be > 0");
+
+public:
+    constexpr Queue()
+        : q_{buffer_, sizeof(T), Depth, 0, 0, 0, {}, {}}, buffer_{} {}
+    Queue(const Queue &) = delete;
+    Queue &operator=(const Queue &) = delete;
+
+    rtos_status_t send(const T &msg, uint32_t timeout_ms = RTOS_WAIT_FOREVER) {
+        return rtos_queue_send(&q_, &msg, timeout_ms);
+    }
+
+    rtos_status_t recv(T &msg, uint32_t timeout_ms = RTOS_WAIT_FOREVER) {
+        return rtos_queue_recv(&q_, &msg, timeout_ms);
+    }
+
+    uint32_t count() { return rtos_queue_count(&q_); }
+    bool empty() { return rtos_queue_is_empty(&q_) != 0; }
+    bool full() { return rtos_queue_is_full(&q_) != 0; }
+
+    /** @brief The queue, for the C API */
+    rtos_queue_t *handle() { return &q_; }
+
+private:
+    rtos_queue_t q_;
+    /* Word aligned so word-sized messages take the inlined copy */
+    alignas(alignof(T) > 4 ? alignof(T) : 4) uint8_t buffer_[sizeof(T) * Depth];
+};
+
+/*---------------------------------------------------------------------------*/
+/* Mutex */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief Recursive mutex with priority inheritance
+ */
+class Mutex {
+public:
+    constexpr Mutex() : m_{} {}
+    Mutex(const Mutex &) = delete;
+    Mutex &operator=(const Mutex &) = delete;
+
+    rtos_status_t lock(uint32_t timeout_ms = RTOS_WAIT_FOREVER) {
+        return rtos_mutex_lock(&m_, timeout_ms);
+    }
+
+    rtos_status_t unlock() { return rtos_mutex_unlock(&m_); }
+    rtos_status_t try_lock() { return rtos_mutex_try(&m_); }
+
+    /** @brief The mutex, for the C API */
+    rtos_mutex_t *handle() { return &m_; }
+
+private:
+    rtos_mutex_t m_;
+};
+
+/**
+ * @brief Holds a Mutex for the enclosing scope (task context only)
+ */
+class LockGuard {
+public:
+    explicit LockGuard(Mutex &mtx) : mtx_(mtx) { mtx_.lock(); }
+    ~LockGuard() { mtx_.unlock(); }
+    LockGuard(const LockGuard &) = delete;
+    LockGuard &operator=(const LockGuard &) = delete;
+
+private:
+    Mutex &mtx_;
+};
+
+/*---------------------------------------------------------------------------*/
+/* Semaphore */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief Binary semaphore
+ */
+class Semaphore {
+public:
+    constexpr explicit Semaphore(bool initial = false) : s_{initial ? 1u : 0u, {}} {}
+    Semaphore(const Semaphore &) = delete;
+    Semaphore &operator=(const Semaphore &) = delete;
+
+    rtos_status_t wait(uint32_t timeout_ms = RTOS_WAIT_FOREVER) {
+        return rtos_sem_wait(&s_, timeout_ms);
+    }
+
+    rtos_status_t post() { return rtos_sem_post(&s_); }
+    rtos_status_t try_wait() { return rtos_sem_try(&s_); }
+
+    /** @brief The semaphore, for the C API */
+    rtos_sem_t *handle() { return &s_; }
+
+private:
+    rtos_sem_t s_;
+};
+
+/*---------------------------------------------------------------------------*/
+/* Timer */
+/*---------------------------------------------------------------------------*/
+
+/**
+ * @brief Soft timer; callbacks run from the tick interrupt
+ */
+class Timer {
+public:
+    constexpr Timer() : t_{} {}
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+    rtos_status_t start(uint32_t period_ms, rtos_timer_cb_t callback, void *arg = nullptr) {
+        return rtos_timer_start(&t_, period_ms, callback, arg);
+    }
+
+    /**
+     * @brief Start a periodic timer calling fn() (a lambda or function object)
+     * @note fn is called through its address and must outlive the timer
+     */
+    template <typename F>
+    rtos_status_t start(uint32_t period_ms, F &fn) {
+        return rtos_timer_start(&t_, period_ms, &detail::invoke<F>, detail::callable_arg(fn));
+    }
+
+    rtos_status_t start_once(uint32_t delay_ms, rtos_timer_cb_t callback, void *arg = nullptr) {
+        return rtos_timer_start_once(&t_, delay_ms, callback, arg);
+    }
+
+    template <typename F>
+    rtos_status_t start_once(uint32_t delay_ms, F &fn) {
+        return rtos_timer_start_once(&t_, delay_ms, &detail::invoke<F>, detail::callable_arg(fn));
+    }
+
+    rtos_status_t stop() { return rtos_timer_stop(&t_); }
+    bool active() { return rtos_timer_is_active(&t_) != 0; }
+
+    /** @brief The timer, for the C API */
+    rtos_timer_t *handle() { return &t_; }
+
+private:
+    rtos_timer_t t_;
+};
+
+} // namespace rtos
+
+#endif /* RTOS_HPP */
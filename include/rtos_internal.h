@@ -7,8 +7,18 @@
 #define RTOS_INTERNAL_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "rtos_config.h"
 
+#ifdef __cplusplus
+/* Included from C++ through rtos.h (rtos.hpp) */
+#ifndef _Static_assert
+#define _Static_assert static_assert
+#endif
+
+extern "C" {
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* Task States */
 /*---------------------------------------------------------------------------*/
@@ -32,6 +42,24 @@ typedef enum {
     RTOS_ERR_ISR        = -6    /* Called from ISR when not allowed */
 } rtos_status_t;
 
+/*---------------------------------------------------------------------------*/
+/* Code Placement */
+/*---------------------------------------------------------------------------*/
+/*
+ * RTOS_RAMFUNC puts a function in .ramfunc, which Reset_Handler copies to
+ * SRAM, so its timing no longer depends on flash wait states or the ART
+ * cache. Calls between flash and SRAM are out of BL range; the linker
+ * inserts long-branch veneers for them. CCM is data-only and cannot hold
+ * code. Ports without the section (host builds) define it empty.
+ */
+#ifndef RTOS_RAMFUNC
+#if RTOS_ENABLE_RAMFUNC
+#define RTOS_RAMFUNC            __attribute__((section(".ramfunc"), noinline))
+#else
+#define RTOS_RAMFUNC
+#endif
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* Forward Declarations */
 /*---------------------------------------------------------------------------*/
@@ -53,18 +81,52 @@ struct rtos_list {
 /*---------------------------------------------------------------------------*/
 /* Task Control Block (TCB) */
 /*---------------------------------------------------------------------------*/
+
+/* Priority storage; RTOS_MAX_PRIORITIES is far below 256 */
+typedef uint8_t rtos_prio_t;
+
+/* TCB flags */
+#define RTOS_TCB_DELAYED    0x01    /* On the delay list */
+#define RTOS_TCB_TIMEOUT    0x02    /* Last wait ended by its timeout */
+
+/*
+ * Hot fields first: everything PendSV, the scheduler, the list operations
+ * and the wait paths touch lives in the first 32 bytes (checked below).
+ * Debug and bookkeeping fields follow and compile out with their feature.
+ */
 struct rtos_tcb {
+    /* Hot */
     uint32_t *stack_ptr;        /* Current stack pointer (MUST be first for asm) */
-    uint32_t priority;          /* Current task priority (0 = highest) */
-    uint32_t base_priority;     /* Original priority (for priority inheritance) */
-    rtos_task_state_t state;    /* Current task state */
-    uint32_t wake_tick;         /* Tick count when task should wake (for delay) */
     struct rtos_tcb *next;      /* Next task in ready/wait list */
     struct rtos_tcb *prev;      /* Previous task in ready/wait list */
-    char name[16];              /* Task name for debugging */
+    struct rtos_tcb *delay_next; /* Next task in delay list (by wake_tick) */
+    uint32_t wake_tick;         /* Tick count when task should wake (for delay) */
+    rtos_list_t *wait_list;     /* Wait list task is blocked on (sem/mutex/queue) */
+    rtos_prio_t priority;       /* Current task priority (0 = highest) */
+    rtos_prio_t base_priority;  /* Original priority (for priority inheritance) */
+    uint8_t state;              /* Current task state (rtos_task_state_t) */
+    uint8_t flags;              /* RTOS_TCB_* flags */
+
+#if RTOS_ENABLE_MPU_GUARD
+    uint32_t mpu_rbar;          /* Guard region base (written by PendSV) */
+#endif
+
+    /* Cold */
     uint32_t *stack_base;       /* Stack base address (for overflow detection) */
-    uint32_t stack_size;        /* Stack size in words */
-    void *wait_object;          /* Object task is waiting on (sem/mutex/queue) */
+    uint16_t stack_size;        /* Stack size in words */
+#if RTOS_ENABLE_STACK_CHECK
+    uint16_t stack_hwm;         /* Lowest stack word index seen in use */
+#endif
+    struct rtos_tcb *task_next; /* Next task in creation order (all tasks) */
+
+#if RTOS_ENABLE_STACK_CHECK && RTOS_STACK_PAINT_DEFERRED
+    struct rtos_tcb *paint_next; /* Next task waiting for the idle painter */
+    uint16_t stack_painted;     /* Words painted so far, from the bottom */
+#endif
+
+#if RTOS_ENABLE_TASK_NAMES
+    char name[RTOS_TASK_NAME_LEN]; /* Task name for debugging */
+#endif
 
 #if RTOS_ENABLE_STATS
     uint32_t run_count;         /* Number of times task has run */
@@ -72,6 +134,12 @@ struct rtos_tcb {
 #endif
 };
 
+_Static_assert(RTOS_MAX_PRIORITIES <= 256, "rtos_prio_t is 8 bits");
+_Static_assert(offsetof(struct rtos_tcb, stack_ptr) == 0,
+               "PendSV saves and loads the stack pointer at offset 0");
+_Static_assert(offsetof(struct rtos_tcb, stack_base) <= 8 * sizeof(void *),
+               "Hot TCB fields must fit in 32 bytes (8 pointers on hosts)");
+
 /*---------------------------------------------------------------------------*/
 /* Binary Semaphore */
 /*---------------------------------------------------------------------------*/
@@ -126,16 +194,32 @@ typedef struct {
     uint32_t priority_bitmap;                           /* Bitmap of ready priorities */
     rtos_list_t ready_list[RTOS_MAX_PRIORITIES];       /* Per-priority ready lists */
     rtos_tcb_t *current_task;                          /* Currently running task */
-    rtos_tcb_t *next_task;                             /* Next task to run */
     volatile uint32_t tick_count;                       /* System tick counter */
     uint8_t scheduler_running;                          /* Scheduler started flag */
     uint8_t scheduler_locked;                           /* Scheduler lock count */
-    rtos_list_t delay_list;                            /* Tasks waiting on delay */
+    volatile uint8_t need_resched;                      /* A wake or block changed the task to run */
+    uint8_t isr_nesting;                                /* rtos_isr_enter depth, 0 = thread */
+    rtos_tcb_t *delay_list;                            /* Delayed tasks, sorted by wake_tick */
     rtos_timer_t *timer_list;                          /* Active timer list */
 
+    rtos_tcb_t *task_list;                             /* All tasks, creation order */
+
+#if RTOS_ENABLE_STACK_CHECK
+    rtos_tcb_t *monitor_task;                          /* Stack monitor position, NULL = MSP */
+    uint32_t monitor_cursor;                           /* Next word to check */
+    uint32_t msp_hwm;                                  /* Lowest MSP word index seen in use */
+#endif
+
+#if RTOS_ENABLE_STACK_CHECK && RTOS_STACK_PAINT_DEFERRED
+    rtos_tcb_t *paint_list;                            /* Stacks still to be painted */
+#endif
+
 #if RTOS_ENABLE_STATS
     uint32_t context_switches;                         /* Total context switches */
     uint32_t idle_ticks;                               /* Ticks spent in idle */
+    uint32_t isr_entries[RTOS_ISR_NEST_LEVELS];        /* ISR entries per nesting depth */
+    uint32_t isr_switches;                             /* Outermost exits that pended PendSV */
+    uint8_t isr_max_nesting;                           /* Deepest nesting seen */
 #endif
 } rtos_kernel_t;
 
@@ -158,18 +242,34 @@ rtos_tcb_t *rtos_list_pop_head(rtos_list_t *list);
 uint8_t rtos_list_is_empty(const rtos_list_t *list);
 
 /* Scheduler operations */
-void rtos_schedule(void);
+rtos_tcb_t *rtos_schedule(void);
 void rtos_add_ready(rtos_tcb_t *tcb);
 void rtos_remove_ready(rtos_tcb_t *tcb);
+void rtos_block_current(rtos_task_state_t state);
+void rtos_rotate_current(void);
+void rtos_set_priority(rtos_tcb_t *tcb, uint32_t priority);
+void rtos_reschedule(void);
 rtos_tcb_t *rtos_get_highest_priority_task(void);
 
 /* Delay list operations */
 void rtos_add_to_delay_list(rtos_tcb_t *tcb, uint32_t ticks);
+void rtos_remove_from_delay_list(rtos_tcb_t *tcb);
 void rtos_check_delayed_tasks(void);
 
 /* Timer operations */
 void rtos_timer_tick(void);
 
+/* Stack high-water monitor, run by the idle task */
+#if RTOS_ENABLE_STACK_CHECK
+void rtos_stack_monitor_init(void);
+void rtos_stack_monitor_step(void);
+#endif
+
+/* Deferred stack painting, run by the idle task */
+#if RTOS_ENABLE_STACK_CHECK && RTOS_STACK_PAINT_DEFERRED
+void rtos_stack_paint_step(void);
+#endif
+
 /* Critical section helpers */
 uint32_t rtos_enter_critical(void);
 void rtos_exit_critical(uint32_t state);
@@ -180,7 +280,10 @@ void rtos_trigger_context_switch(void);
 /* Port-specific functions */
 void rtos_port_init(void);
 void rtos_port_start_first_task(void);
+void rtos_port_stack_guard_init(rtos_tcb_t *tcb);
+uint32_t rtos_port_stack_guard_words(const rtos_tcb_t *tcb);
 uint32_t *rtos_port_init_stack(uint32_t *stack_top, void (*task_fn)(void *), void *arg);
+void rtos_task_exit(void);
 
 /* Idle task */
 void rtos_idle_task(void *arg);
@@ -227,7 +330,42 @@ void rtos_idle_task(void *arg);
 /* xPSR Thumb bit must be set */
 #define XPSR_INIT_VALUE     0x01000000
 
+/*
+ * Initial frame of a new task, lowest address (stack_ptr) first: the layout
+ * rtos_port_init_stack writes, as an initializer for generated stacks.
+ */
+#define RTOS_INITIAL_FRAME_WORDS    16
+#define RTOS_INITIAL_FRAME(fn, arg)                                 \
+    0x04040404, 0x05050505, 0x06060606, 0x07070707,                 \
+    0x08080808, 0x09090909, 0x10101010, 0x11111111,                 \
+    (uint32_t)(arg), 0x01010101, 0x02020202, 0x03030303,            \
+    0x12121212, (uint32_t)rtos_task_exit, (uint32_t)(fn), XPSR_INIT_VALUE
+
+/* Stack marker for overflow detection and the high-water monitor */
+#define STACK_MARKER        0xDEADBEEF
+
+/* Smallest stack accepted by rtos_task_create (and recommended by the report) */
+#define RTOS_MIN_STACK_WORDS    32
+
+#if RTOS_ENABLE_MPU_GUARD
+_Static_assert(RTOS_MPU_GUARD_SIZE >= 32 &&
+               (RTOS_MPU_GUARD_SIZE & (RTOS_MPU_GUARD_SIZE - 1)) == 0,
+               "RTOS_MPU_GUARD_SIZE must be a power of two >= 32");
+
+/* Stack guard region: no access at any privilege, never executable */
+#define MPU_GUARD_RASR      (MPU_RASR_XN | (0UL << MPU_RASR_AP_Pos) | \
+                             ((uint32_t)(__builtin_ctz(RTOS_MPU_GUARD_SIZE) - 1) << MPU_RASR_SIZE_Pos) | \
+                             MPU_RASR_ENABLE)
+
+/* Guard block for tasks whose stack is too small to hold one (rtos_port.c) */
+extern uint32_t rtos_port_spare_guard[RTOS_MPU_GUARD_SIZE / sizeof(uint32_t)];
+#endif
+
 /* EXC_RETURN values */
 #define EXC_RETURN_PSP_UNPRIV   0xFFFFFFFD  /* Return to Thread mode, use PSP */
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* RTOS_INTERNAL_H */
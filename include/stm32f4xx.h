@@ -13,12 +13,26 @@
 #define APB1PERIPH_BASE         PERIPH_BASE
 #define APB2PERIPH_BASE         (PERIPH_BASE + 0x00010000UL)
 #define AHB1PERIPH_BASE         (PERIPH_BASE + 0x00020000UL)
+#define SRAM_BASE               0x20000000UL
+
+/* Bit-band regions: one word alias per bit of the first 1MB */
+#define SRAM_BB_BASE            0x22000000UL
+#define PERIPH_BB_BASE          0x42000000UL
+
+/* Alias word for bit 'bit' of the SRAM or peripheral word at 'addr' */
+#define BITBAND_SRAM(addr, bit) \
+    ((volatile uint32_t *)(SRAM_BB_BASE + (((uint32_t)(addr) - SRAM_BASE) << 5) + ((bit) << 2)))
+#define BITBAND_PERIPH(addr, bit) \
+    ((volatile uint32_t *)(PERIPH_BB_BASE + (((uint32_t)(addr) - PERIPH_BASE) << 5) + ((bit) << 2)))
 
 /* Core peripherals base addresses */
 #define SCS_BASE                0xE000E000UL
 #define SYSTICK_BASE            (SCS_BASE + 0x0010UL)
 #define NVIC_BASE               (SCS_BASE + 0x0100UL)
 #define SCB_BASE                (SCS_BASE + 0x0D00UL)
+#define MPU_BASE                (SCS_BASE + 0x0D90UL)
+#define DWT_BASE                0xE0001000UL
+#define COREDEBUG_BASE          0xE000EDF0UL
 
 /* Peripheral base addresses */
 #define GPIOA_BASE              (AHB1PERIPH_BASE + 0x0000UL)
@@ -26,7 +40,19 @@
 #define GPIOC_BASE              (AHB1PERIPH_BASE + 0x0800UL)
 #define GPIOD_BASE              (AHB1PERIPH_BASE + 0x0C00UL)
 #define RCC_BASE                (AHB1PERIPH_BASE + 0x3800UL)
+#define FLASH_R_BASE            (AHB1PERIPH_BASE + 0x3C00UL)
+#define PWR_BASE                (APB1PERIPH_BASE + 0x7000UL)
+#define DMA1_BASE               (AHB1PERIPH_BASE + 0x6000UL)
+#define DMA2_BASE               (AHB1PERIPH_BASE + 0x6400UL)
 #define USART2_BASE             (APB1PERIPH_BASE + 0x4400UL)
+#define TIM2_BASE               (APB1PERIPH_BASE + 0x0000UL)
+#define TIM3_BASE               (APB1PERIPH_BASE + 0x0400UL)
+#define TIM4_BASE               (APB1PERIPH_BASE + 0x0800UL)
+#define TIM5_BASE               (APB1PERIPH_BASE + 0x0C00UL)
+#define SYSCFG_BASE             (APB2PERIPH_BASE + 0x3800UL)
+#define EXTI_BASE               (APB2PERIPH_BASE + 0x3C00UL)
+#define ADC1_BASE               (APB2PERIPH_BASE + 0x2000UL)
+#define ADC_COMMON_BASE         (APB2PERIPH_BASE + 0x2300UL)
 #define USART1_BASE             (APB2PERIPH_BASE + 0x1000UL)
 
 /*---------------------------------------------------------------------------*/
@@ -61,6 +87,40 @@ typedef struct {
 #define SCB_SHP_PENDSV_IDX      10      /* PendSV priority index in SHP array */
 #define SCB_SHP_SYSTICK_IDX     11      /* SysTick priority index in SHP array */
 
+/* SCB SHCSR / CFSR bit definitions */
+#define SCB_SHCSR_MEMFAULTENA   (1UL << 16) /* Enable MemManage fault */
+#define SCB_CFSR_IACCVIOL       (1UL << 0)  /* Instruction access violation */
+#define SCB_CFSR_DACCVIOL       (1UL << 1)  /* Data access violation */
+#define SCB_CFSR_MUNSTKERR      (1UL << 3)  /* Fault on exception return unstacking */
+#define SCB_CFSR_MSTKERR        (1UL << 4)  /* Fault on exception entry stacking */
+#define SCB_CFSR_MMARVALID      (1UL << 7)  /* MMFAR holds the fault address */
+#define SCB_CFSR_MMFSR_Msk      0xFFUL
+
+/*---------------------------------------------------------------------------*/
+/* Memory Protection Unit (MPU) */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t TYPE;         /* MPU Type Register */
+    volatile uint32_t CTRL;         /* MPU Control Register */
+    volatile uint32_t RNR;          /* Region Number Register */
+    volatile uint32_t RBAR;         /* Region Base Address Register */
+    volatile uint32_t RASR;         /* Region Attribute and Size Register */
+} MPU_Type;
+
+#define MPU                     ((MPU_Type *)MPU_BASE)
+
+#define MPU_CTRL_ENABLE         (1UL << 0)  /* Enable the MPU */
+#define MPU_CTRL_HFNMIENA       (1UL << 1)  /* Keep the MPU on in HardFault/NMI */
+#define MPU_CTRL_PRIVDEFENA     (1UL << 2)  /* Default map for privileged code */
+
+#define MPU_RBAR_VALID          (1UL << 4)  /* Use the REGION field */
+#define MPU_RBAR_REGION_Msk     0xFUL
+
+#define MPU_RASR_ENABLE         (1UL << 0)
+#define MPU_RASR_SIZE_Pos       1           /* Region size is 2^(SIZE+1) bytes */
+#define MPU_RASR_AP_Pos         24          /* 0 = no access at any privilege */
+#define MPU_RASR_XN             (1UL << 28) /* Execute never */
+
 /*---------------------------------------------------------------------------*/
 /* SysTick Timer */
 /*---------------------------------------------------------------------------*/
@@ -104,6 +164,35 @@ typedef struct {
 
 #define NVIC                    ((NVIC_Type *)NVIC_BASE)
 
+#define NVIC_IRQ_COUNT          82      /* STM32F407 external interrupts */
+#define VECTOR_COUNT            (16 + NVIC_IRQ_COUNT)
+
+/*---------------------------------------------------------------------------*/
+/* Data Watchpoint and Trace (DWT) */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t CTRL;         /* Control Register */
+    volatile uint32_t CYCCNT;       /* Cycle Count Register */
+    volatile uint32_t CPICNT;       /* CPI Count Register */
+    volatile uint32_t EXCCNT;       /* Exception Overhead Count Register */
+    volatile uint32_t SLEEPCNT;     /* Sleep Count Register */
+    volatile uint32_t LSUCNT;       /* LSU Count Register */
+    volatile uint32_t FOLDCNT;      /* Folded-instruction Count Register */
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DHCSR;        /* Debug Halting Control and Status */
+    volatile uint32_t DCRSR;        /* Debug Core Register Selector */
+    volatile uint32_t DCRDR;        /* Debug Core Register Data */
+    volatile uint32_t DEMCR;        /* Debug Exception and Monitor Control */
+} CoreDebug_Type;
+
+#define DWT                     ((DWT_Type *)DWT_BASE)
+#define CoreDebug               ((CoreDebug_Type *)COREDEBUG_BASE)
+
+#define DWT_CTRL_CYCCNTENA      (1UL << 0)  /* Enable cycle counter */
+#define CoreDebug_DEMCR_TRCENA  (1UL << 24) /* Enable DWT and ITM */
+
 /*---------------------------------------------------------------------------*/
 /* GPIO */
 /*---------------------------------------------------------------------------*/
@@ -145,6 +234,29 @@ typedef struct {
 #define GPIO_PUPD_UP            0x01
 #define GPIO_PUPD_DOWN          0x02
 
+/*---------------------------------------------------------------------------*/
+/* SYSCFG and EXTI */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t MEMRMP;       /* Memory Remap Register */
+    volatile uint32_t PMC;          /* Peripheral Mode Configuration Register */
+    volatile uint32_t EXTICR[4];    /* External Interrupt Configuration (4 bits per line) */
+    volatile uint32_t RESERVED[2];
+    volatile uint32_t CMPCR;        /* Compensation Cell Control Register */
+} SYSCFG_TypeDef;
+
+typedef struct {
+    volatile uint32_t IMR;          /* Interrupt Mask Register */
+    volatile uint32_t EMR;          /* Event Mask Register */
+    volatile uint32_t RTSR;         /* Rising Trigger Selection Register */
+    volatile uint32_t FTSR;         /* Falling Trigger Selection Register */
+    volatile uint32_t SWIER;        /* Software Interrupt Event Register */
+    volatile uint32_t PR;           /* Pending Register (write 1 to clear) */
+} EXTI_TypeDef;
+
+#define SYSCFG                  ((SYSCFG_TypeDef *)SYSCFG_BASE)
+#define EXTI                    ((EXTI_TypeDef *)EXTI_BASE)
+
 /*---------------------------------------------------------------------------*/
 /* USART */
 /*---------------------------------------------------------------------------*/
@@ -190,6 +302,170 @@ typedef struct {
 #define USART_CR1_UE            (1 << 13)   /* USART Enable */
 #define USART_CR1_OVER8         (1 << 15)   /* Oversampling Mode */
 
+/* USART CR3 bit definitions */
+#define USART_CR3_EIE           (1 << 0)    /* Error Interrupt Enable */
+#define USART_CR3_DMAR          (1 << 6)    /* DMA Enable Receiver */
+#define USART_CR3_DMAT          (1 << 7)    /* DMA Enable Transmitter */
+
+/*---------------------------------------------------------------------------*/
+/* DMA */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t CR;           /* Stream Configuration Register */
+    volatile uint32_t NDTR;         /* Number of Data Register */
+    volatile uint32_t PAR;          /* Peripheral Address Register */
+    volatile uint32_t M0AR;         /* Memory 0 Address Register */
+    volatile uint32_t M1AR;         /* Memory 1 Address Register */
+    volatile uint32_t FCR;          /* FIFO Control Register */
+} DMA_Stream_TypeDef;
+
+typedef struct {
+    volatile uint32_t LISR;         /* Low Interrupt Status Register (streams 0-3) */
+    volatile uint32_t HISR;         /* High Interrupt Status Register (streams 4-7) */
+    volatile uint32_t LIFCR;        /* Low Interrupt Flag Clear Register */
+    volatile uint32_t HIFCR;        /* High Interrupt Flag Clear Register */
+    DMA_Stream_TypeDef STREAM[8];   /* Streams 0-7 */
+} DMA_TypeDef;
+
+#define DMA1                    ((DMA_TypeDef *)DMA1_BASE)
+#define DMA2                    ((DMA_TypeDef *)DMA2_BASE)
+
+/* DMA stream CR bit definitions */
+#define DMA_SxCR_EN             (1UL << 0)  /* Stream Enable */
+#define DMA_SxCR_DMEIE          (1UL << 1)  /* Direct Mode Error Interrupt Enable */
+#define DMA_SxCR_TEIE           (1UL << 2)  /* Transfer Error Interrupt Enable */
+#define DMA_SxCR_HTIE           (1UL << 3)  /* Half Transfer Interrupt Enable */
+#define DMA_SxCR_TCIE           (1UL << 4)  /* Transfer Complete Interrupt Enable */
+#define DMA_SxCR_DIR_P2M        (0UL << 6)  /* Peripheral to memory */
+#define DMA_SxCR_DIR_M2P        (1UL << 6)  /* Memory to peripheral */
+#define DMA_SxCR_DIR_M2M        (2UL << 6)  /* Memory to memory (DMA2 only) */
+#define DMA_SxCR_CIRC           (1UL << 8)  /* Circular Mode */
+#define DMA_SxCR_PINC           (1UL << 9)  /* Peripheral Increment */
+#define DMA_SxCR_MINC           (1UL << 10) /* Memory Increment */
+#define DMA_SxCR_PSIZE_Pos      11          /* Peripheral data size (0=8, 1=16, 2=32 bit) */
+#define DMA_SxCR_MSIZE_Pos      13          /* Memory data size (0=8, 1=16, 2=32 bit) */
+#define DMA_SxCR_PL_Pos         16          /* Priority level (0=low .. 3=very high) */
+#define DMA_SxCR_DBM            (1UL << 18) /* Double Buffer Mode */
+#define DMA_SxCR_CT             (1UL << 19) /* Current Target (0=M0AR, 1=M1AR) */
+#define DMA_SxCR_PBURST_Pos     21          /* Peripheral burst (0=single, 1=INCR4 ..) */
+#define DMA_SxCR_MBURST_Pos     23          /* Memory burst (0=single, 1=INCR4 ..) */
+#define DMA_SxCR_CHSEL_Pos      25          /* Channel selection (0-7) */
+
+/* DMA stream FCR bit definitions */
+#define DMA_SxFCR_FTH_FULL      (3UL << 0)  /* FIFO threshold: full */
+#define DMA_SxFCR_DMDIS         (1UL << 2)  /* Direct mode disable (use FIFO) */
+
+/* DMA per-stream interrupt flags (before shifting into LISR/HISR) */
+#define DMA_FLAG_FE             (1UL << 0)  /* FIFO Error */
+#define DMA_FLAG_DME            (1UL << 2)  /* Direct Mode Error */
+#define DMA_FLAG_TE             (1UL << 3)  /* Transfer Error */
+#define DMA_FLAG_HT             (1UL << 4)  /* Half Transfer */
+#define DMA_FLAG_TC             (1UL << 5)  /* Transfer Complete */
+#define DMA_FLAG_ALL            (0x3DUL)
+
+/*---------------------------------------------------------------------------*/
+/* ADC */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t SR;           /* Status Register */
+    volatile uint32_t CR1;          /* Control Register 1 */
+    volatile uint32_t CR2;          /* Control Register 2 */
+    volatile uint32_t SMPR1;        /* Sample Time Register 1 (channels 10-18) */
+    volatile uint32_t SMPR2;        /* Sample Time Register 2 (channels 0-9) */
+    volatile uint32_t JOFR[4];      /* Injected Channel Data Offset Registers */
+    volatile uint32_t HTR;          /* Watchdog Higher Threshold Register */
+    volatile uint32_t LTR;          /* Watchdog Lower Threshold Register */
+    volatile uint32_t SQR1;         /* Regular Sequence Register 1 (length, SQ13-16) */
+    volatile uint32_t SQR2;         /* Regular Sequence Register 2 (SQ7-12) */
+    volatile uint32_t SQR3;         /* Regular Sequence Register 3 (SQ1-6) */
+    volatile uint32_t JSQR;         /* Injected Sequence Register */
+    volatile uint32_t JDR[4];       /* Injected Data Registers */
+    volatile uint32_t DR;           /* Regular Data Register */
+} ADC_TypeDef;
+
+typedef struct {
+    volatile uint32_t CSR;          /* Common Status Register */
+    volatile uint32_t CCR;          /* Common Control Register */
+    volatile uint32_t CDR;          /* Common Regular Data Register (dual/triple) */
+} ADC_Common_TypeDef;
+
+#define ADC1                    ((ADC_TypeDef *)ADC1_BASE)
+#define ADC_COMMON              ((ADC_Common_TypeDef *)ADC_COMMON_BASE)
+
+/* ADC SR bit definitions */
+#define ADC_SR_EOC              (1 << 1)    /* End of Conversion */
+#define ADC_SR_STRT             (1 << 4)    /* Regular Channel Start */
+#define ADC_SR_OVR              (1 << 5)    /* Overrun */
+
+/* ADC CR1 bit definitions */
+#define ADC_CR1_SCAN            (1 << 8)    /* Scan Mode */
+#define ADC_CR1_RES_Pos         24          /* Resolution (0=12, 1=10, 2=8, 3=6 bit) */
+#define ADC_CR1_OVRIE           (1 << 26)   /* Overrun Interrupt Enable */
+
+/* ADC CR2 bit definitions */
+#define ADC_CR2_ADON            (1 << 0)    /* A/D Converter ON */
+#define ADC_CR2_CONT            (1 << 1)    /* Continuous Conversion */
+#define ADC_CR2_DMA             (1 << 8)    /* DMA Access Mode */
+#define ADC_CR2_DDS             (1 << 9)    /* DMA Requests Continue After Last Transfer */
+#define ADC_CR2_EOCS            (1 << 10)   /* EOC After Each Conversion */
+#define ADC_CR2_ALIGN           (1 << 11)   /* Left Alignment */
+#define ADC_CR2_EXTSEL_Pos      24          /* Regular External Event Select */
+#define ADC_CR2_EXTEN_Pos       28          /* Regular Trigger Edge (1=rising) */
+#define ADC_CR2_SWSTART         (1 << 30)   /* Start Regular Conversion */
+
+/* ADC regular external trigger sources (EXTSEL) */
+#define ADC_EXTSEL_TIM2_TRGO    0x6
+
+/* ADC CCR bit definitions */
+#define ADC_CCR_ADCPRE_Pos      16          /* ADC Prescaler (0=/2, 1=/4, 2=/6, 3=/8) */
+
+/*---------------------------------------------------------------------------*/
+/* General-Purpose Timers (TIM2-TIM5) */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t CR1;          /* Control Register 1 */
+    volatile uint32_t CR2;          /* Control Register 2 */
+    volatile uint32_t SMCR;         /* Slave Mode Control Register */
+    volatile uint32_t DIER;         /* DMA/Interrupt Enable Register */
+    volatile uint32_t SR;           /* Status Register */
+    volatile uint32_t EGR;          /* Event Generation Register */
+    volatile uint32_t CCMR1;        /* Capture/Compare Mode Register 1 */
+    volatile uint32_t CCMR2;        /* Capture/Compare Mode Register 2 */
+    volatile uint32_t CCER;         /* Capture/Compare Enable Register */
+    volatile uint32_t CNT;          /* Counter */
+    volatile uint32_t PSC;          /* Prescaler */
+    volatile uint32_t ARR;          /* Auto-Reload Register */
+    volatile uint32_t RESERVED0;
+    volatile uint32_t CCR[4];       /* Capture/Compare Registers 1-4 */
+    volatile uint32_t RESERVED1;
+    volatile uint32_t DCR;          /* DMA Control Register */
+    volatile uint32_t DMAR;         /* DMA Address for Full Transfer */
+    volatile uint32_t OR;           /* Option Register */
+} TIM_TypeDef;
+
+#define TIM2                    ((TIM_TypeDef *)TIM2_BASE)
+#define TIM3                    ((TIM_TypeDef *)TIM3_BASE)   /* 16-bit */
+#define TIM4                    ((TIM_TypeDef *)TIM4_BASE)   /* 16-bit */
+#define TIM5                    ((TIM_TypeDef *)TIM5_BASE)
+
+/* TIM CR1 bit definitions */
+#define TIM_CR1_CEN             (1 << 0)    /* Counter Enable */
+#define TIM_CR1_URS             (1 << 2)    /* Update Request Source */
+#define TIM_CR1_ARPE            (1 << 7)    /* Auto-Reload Preload Enable */
+
+/* TIM CR2 bit definitions */
+#define TIM_CR2_MMS_Pos         4           /* Master Mode Selection */
+#define TIM_CR2_MMS_UPDATE      (2 << 4)    /* Update event drives TRGO */
+
+/* TIM DIER bit definitions */
+#define TIM_DIER_UIE            (1 << 0)    /* Update Interrupt Enable */
+
+/* TIM SR bit definitions */
+#define TIM_SR_UIF              (1 << 0)    /* Update Interrupt Flag (rc_w0) */
+
+/* TIM EGR bit definitions */
+#define TIM_EGR_UG              (1 << 0)    /* Update Generation */
+
 /*---------------------------------------------------------------------------*/
 /* RCC (Reset and Clock Control) */
 /*---------------------------------------------------------------------------*/
@@ -228,17 +504,87 @@ typedef struct {
 
 #define RCC                     ((RCC_TypeDef *)RCC_BASE)
 
+/* RCC CR bit definitions */
+#define RCC_CR_HSION            (1UL << 0)  /* HSI Enable */
+#define RCC_CR_HSIRDY           (1UL << 1)  /* HSI Ready */
+#define RCC_CR_HSEON            (1UL << 16) /* HSE Enable */
+#define RCC_CR_HSERDY           (1UL << 17) /* HSE Ready */
+#define RCC_CR_HSEBYP           (1UL << 18) /* HSE Bypass (external clock) */
+#define RCC_CR_PLLON            (1UL << 24) /* Main PLL Enable */
+#define RCC_CR_PLLRDY           (1UL << 25) /* Main PLL Ready */
+
+/* RCC PLLCFGR field positions */
+#define RCC_PLLCFGR_PLLM_Pos    0           /* Input divider (2-63) */
+#define RCC_PLLCFGR_PLLN_Pos    6           /* VCO multiplier (50-432) */
+#define RCC_PLLCFGR_PLLP_Pos    16          /* SYSCLK divider (0=/2, 1=/4, 2=/6, 3=/8) */
+#define RCC_PLLCFGR_PLLSRC_HSE  (1UL << 22) /* PLL input: HSE (else HSI) */
+#define RCC_PLLCFGR_PLLQ_Pos    24          /* 48 MHz domain divider (2-15) */
+
+/* RCC CFGR fields */
+#define RCC_CFGR_SW_Msk         (3UL << 0)  /* System clock switch */
+#define RCC_CFGR_SW_HSI         (0UL << 0)
+#define RCC_CFGR_SW_HSE         (1UL << 0)
+#define RCC_CFGR_SW_PLL         (2UL << 0)
+#define RCC_CFGR_SWS_Pos        2           /* System clock switch status */
+#define RCC_CFGR_HPRE_Pos       4           /* AHB prescaler (0xxx=/1, 1000=/2 .. 1111=/512) */
+#define RCC_CFGR_PPRE1_Pos      10          /* APB1 prescaler (0xx=/1, 100=/2 .. 111=/16) */
+#define RCC_CFGR_PPRE2_Pos      13          /* APB2 prescaler (0xx=/1, 100=/2 .. 111=/16) */
+
 /* RCC AHB1ENR bit definitions */
 #define RCC_AHB1ENR_GPIOAEN     (1 << 0)
 #define RCC_AHB1ENR_GPIOBEN     (1 << 1)
 #define RCC_AHB1ENR_GPIOCEN     (1 << 2)
 #define RCC_AHB1ENR_GPIODEN     (1 << 3)
+#define RCC_AHB1ENR_DMA1EN      (1 << 21)
+#define RCC_AHB1ENR_DMA2EN      (1 << 22)
 
 /* RCC APB1ENR bit definitions */
+#define RCC_APB1ENR_TIM2EN      (1 << 0)
+#define RCC_APB1ENR_TIM3EN      (1 << 1)
+#define RCC_APB1ENR_TIM4EN      (1 << 2)
+#define RCC_APB1ENR_TIM5EN      (1 << 3)
 #define RCC_APB1ENR_USART2EN    (1 << 17)
+#define RCC_APB1ENR_PWREN       (1 << 28)
 
 /* RCC APB2ENR bit definitions */
 #define RCC_APB2ENR_USART1EN    (1 << 4)
+#define RCC_APB2ENR_ADC1EN      (1 << 8)
+#define RCC_APB2ENR_SYSCFGEN    (1 << 14)
+
+/*---------------------------------------------------------------------------*/
+/* FLASH Interface */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t ACR;          /* Access Control Register */
+    volatile uint32_t KEYR;         /* Key Register */
+    volatile uint32_t OPTKEYR;      /* Option Key Register */
+    volatile uint32_t SR;           /* Status Register */
+    volatile uint32_t CR;           /* Control Register */
+    volatile uint32_t OPTCR;        /* Option Control Register */
+} FLASH_TypeDef;
+
+#define FLASH                   ((FLASH_TypeDef *)FLASH_R_BASE)
+
+/* FLASH ACR bit definitions */
+#define FLASH_ACR_LATENCY_Msk   (0x7UL << 0) /* Wait states */
+#define FLASH_ACR_PRFTEN        (1UL << 8)  /* Prefetch Enable */
+#define FLASH_ACR_ICEN          (1UL << 9)  /* Instruction Cache Enable */
+#define FLASH_ACR_DCEN          (1UL << 10) /* Data Cache Enable */
+#define FLASH_ACR_ICRST         (1UL << 11) /* Instruction Cache Reset */
+#define FLASH_ACR_DCRST         (1UL << 12) /* Data Cache Reset */
+
+/*---------------------------------------------------------------------------*/
+/* PWR (Power Control) */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t CR;           /* Power Control Register */
+    volatile uint32_t CSR;          /* Power Control/Status Register */
+} PWR_TypeDef;
+
+#define PWR                     ((PWR_TypeDef *)PWR_BASE)
+
+/* PWR CR bit definitions */
+#define PWR_CR_VOS              (1UL << 14) /* Regulator Scale 1 (needed above 144 MHz) */
 
 /*---------------------------------------------------------------------------*/
 /* Interrupt Numbers */
@@ -262,9 +608,32 @@ typedef enum {
     EXTI2_IRQn              = 8,
     EXTI3_IRQn              = 9,
     EXTI4_IRQn              = 10,
+    DMA1_Stream0_IRQn       = 11,
+    DMA1_Stream1_IRQn       = 12,
+    DMA1_Stream2_IRQn       = 13,
+    DMA1_Stream3_IRQn       = 14,
+    DMA1_Stream4_IRQn       = 15,
+    DMA1_Stream5_IRQn       = 16,
+    DMA1_Stream6_IRQn       = 17,
+    ADC_IRQn                = 18,
+    EXTI9_5_IRQn            = 23,
+    TIM2_IRQn               = 28,
+    TIM3_IRQn               = 29,
+    TIM4_IRQn               = 30,
     USART1_IRQn             = 37,
     USART2_IRQn             = 38,
     USART3_IRQn             = 39,
+    EXTI15_10_IRQn          = 40,
+    DMA1_Stream7_IRQn       = 47,
+    TIM5_IRQn               = 50,
+    DMA2_Stream0_IRQn       = 56,
+    DMA2_Stream1_IRQn       = 57,
+    DMA2_Stream2_IRQn       = 58,
+    DMA2_Stream3_IRQn       = 59,
+    DMA2_Stream4_IRQn       = 60,
+    DMA2_Stream5_IRQn       = 68,
+    DMA2_Stream6_IRQn       = 69,
+    DMA2_Stream7_IRQn       = 70,
 } IRQn_Type;
 
 /*---------------------------------------------------------------------------*/
@@ -286,6 +655,10 @@ static inline void __ISB(void) {
     __asm volatile ("isb 0xF" ::: "memory");
 }
 
+static inline void __DMB(void) {
+    __asm volatile ("dmb 0xF" ::: "memory");
+}
+
 static inline void __WFI(void) {
     __asm volatile ("wfi");
 }
@@ -331,6 +704,29 @@ static inline void __set_CONTROL(uint32_t control) {
     __ISB();
 }
 
+/*---------------------------------------------------------------------------*/
+/* NVIC Helpers */
+/*---------------------------------------------------------------------------*/
+#define __NVIC_PRIO_BITS        4       /* STM32F4 implements 4 priority bits */
+
+static inline void NVIC_EnableIRQ(IRQn_Type irqn) {
+    NVIC->ISER[(uint32_t)irqn >> 5] = 1UL << ((uint32_t)irqn & 0x1F);
+}
+
+static inline void NVIC_DisableIRQ(IRQn_Type irqn) {
+    NVIC->ICER[(uint32_t)irqn >> 5] = 1UL << ((uint32_t)irqn & 0x1F);
+    __DSB();
+    __ISB();
+}
+
+static inline void NVIC_ClearPendingIRQ(IRQn_Type irqn) {
+    NVIC->ICPR[(uint32_t)irqn >> 5] = 1UL << ((uint32_t)irqn & 0x1F);
+}
+
+static inline void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority) {
+    NVIC->IP[(uint32_t)irqn] = (uint8_t)(priority << (8 - __NVIC_PRIO_BITS));
+}
+
 /* Count Leading Zeros - used for O(1) priority lookup */
 static inline uint32_t __CLZ(uint32_t value) {
     uint32_t result;
@@ -338,4 +734,21 @@ static inline uint32_t __CLZ(uint32_t value) {
     return result;
 }
 
+/* Exclusive access - used for lock-free producers */
+static inline uint32_t __LDREXW(volatile uint32_t *addr) {
+    uint32_t result;
+    __asm volatile ("ldrex %0, %1" : "=r" (result) : "Q" (*addr));
+    return result;
+}
+
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr) {
+    uint32_t result;
+    __asm volatile ("strex %0, %2, %1" : "=&r" (result), "=Q" (*addr) : "r" (value));
+    return result;
+}
+
+static inline void __CLREX(void) {
+    __asm volatile ("clrex" ::: "memory");
+}
+
 #endif /* STM32F4XX_H */
@@ -7,14 +7,19 @@
 #define RTOS_CONFIG_H
 
 /* System clock configuration */
-#define RTOS_CPU_CLOCK_HZ       16000000    /* 16 MHz (default for STM32F4 on QEMU) */
+#define RTOS_CPU_CLOCK_HZ       16000000    /* Reset clock (HSI), used until the PLL is up */
+#define RTOS_SYSCLK_HZ          168000000   /* Target SYSCLK from the PLL (max 168 MHz) */
+#define RTOS_HSE_HZ             25000000    /* HSE crystal, 0 to run the PLL from HSI */
+#define RTOS_CLOCK_TIMEOUT      100000      /* Ready-flag polls before falling back */
 #define RTOS_TICK_RATE_HZ       1000        /* 1kHz tick rate (1ms period) */
 
 /* Task configuration */
 #define RTOS_MAX_TASKS          8           /* Maximum concurrent tasks */
 #define RTOS_MAX_PRIORITIES     4           /* Priority levels (0-3, 0 = highest) */
 #define RTOS_DEFAULT_STACK_SIZE 256         /* Default stack size in words (1KB) */
+#ifndef RTOS_IDLE_STACK_SIZE
 #define RTOS_IDLE_STACK_SIZE    128         /* Idle task stack in words (512B) */
+#endif
 
 /* Timer configuration */
 #define RTOS_MAX_TIMERS         8           /* Maximum soft timers */
@@ -24,20 +29,74 @@
 #define RTOS_MAX_MUTEXES        8           /* Maximum mutexes */
 #define RTOS_MAX_QUEUES         4           /* Maximum message queues */
 
+/* Memory placement */
+#ifndef RTOS_KERNEL_IN_CCM
+#define RTOS_KERNEL_IN_CCM      0           /* Put g_kernel, TCBs and task stacks in CCM */
+#endif
+
+/* Execute the scheduler, tick and queue paths from SRAM (.ramfunc) */
+#ifndef RTOS_ENABLE_RAMFUNC
+#define RTOS_ENABLE_RAMFUNC     1
+#endif
+
+/* Copy the vector table to SRAM at reset and allow rtos_irq_register */
+#ifndef RTOS_ENABLE_RAM_VECTORS
+#define RTOS_ENABLE_RAM_VECTORS 1
+#endif
+
+/* Tasks, objects and g_kernel come initialized from rtos_system.c (gen_system.py) */
+#ifndef RTOS_STATIC_SYSTEM
+#define RTOS_STATIC_SYSTEM      0
+#endif
+
 /* Feature flags */
 #define RTOS_ENABLE_STATS       1           /* Enable timing statistics */
 #define RTOS_ENABLE_STACK_CHECK 1           /* Enable stack overflow detection */
 #define RTOS_ENABLE_PRIORITY_INHERITANCE 1  /* Enable priority inheritance for mutexes */
+#define RTOS_ENABLE_BOOT_PROFILE 1          /* Cycle count reset-to-first-task (DWT) */
+#ifndef RTOS_ENABLE_TASK_NAMES
+#define RTOS_ENABLE_TASK_NAMES  1           /* Keep task names in the TCB */
+#endif
+#define RTOS_TASK_NAME_LEN      12          /* Including the terminator */
+#define RTOS_ISR_NEST_LEVELS    4           /* ISR nesting depths counted separately (stats) */
+
+/* Stack painting (RTOS_ENABLE_STACK_CHECK) */
+#ifndef RTOS_STACK_PAINT_DEFERRED
+#define RTOS_STACK_PAINT_DEFERRED 0         /* 1 = idle task paints stacks (must start zeroed) */
+#endif
+#define RTOS_STACK_GUARD_WORDS  8           /* Painted at creation in deferred mode */
+#define RTOS_STACK_PAINT_CHUNK  32          /* Words painted per idle loop iteration */
+#define RTOS_STACK_MONITOR_CHUNK 64         /* Words checked per idle loop iteration */
+#define RTOS_STACK_REPORT_MARGIN 25         /* % added to peak use by rtos_stack_report */
+
+/* MPU stack guard: no-access region at the bottom of the running task's stack */
+#ifndef RTOS_ENABLE_MPU_GUARD
+#define RTOS_ENABLE_MPU_GUARD   1
+#endif
+#define RTOS_MPU_GUARD_SIZE     32          /* Bytes, power of two >= 32 */
+#define RTOS_MPU_GUARD_REGION   7           /* Highest region wins on overlap */
 
 /* HAL configuration */
 #define RTOS_UART_BAUD          115200      /* UART baud rate */
+#define RTOS_UART_IRQ_PRIORITY  6           /* NVIC priority for USART IRQs (0-15) */
+#define RTOS_DMA_IRQ_PRIORITY   6           /* NVIC priority for DMA stream IRQs (0-15) */
+#define RTOS_EXTI_IRQ_PRIORITY  5           /* NVIC priority for EXTI line IRQs (0-15) */
+
+/* DMA memcpy offload (memory-to-memory needs DMA2) */
+#define RTOS_DMA_MEMCPY_STREAM  1           /* DMA2 stream reserved for copies */
+#define RTOS_DMA_MEMCPY_THRESHOLD 256       /* Smaller copies use the CPU */
 
 /* Debug configuration */
 #define RTOS_DEBUG_PRINT        1           /* Enable debug printing */
+#define RTOS_CONSOLE_BUFFER_SIZE 128        /* hal_printf buffer per call (bytes) */
+
+/* Deferred binary log configuration */
+#define RTOS_ENABLE_LOG         1           /* Enable HAL_LOG deferred logger */
+#define RTOS_LOG_BUFFER_WORDS   256         /* Log ring size in words (power of 2) */
+#define RTOS_LOG_DRAIN_PERIOD_MS 10         /* Drain task polling period */
 
 /* Calculated values - do not modify */
 #define RTOS_TICK_PERIOD_MS     (1000 / RTOS_TICK_RATE_HZ)
-#define RTOS_SYSTICK_RELOAD     ((RTOS_CPU_CLOCK_HZ / RTOS_TICK_RATE_HZ) - 1)
 
 /* Priority bitmap width (must be >= RTOS_MAX_PRIORITIES) */
 #define RTOS_PRIORITY_BITMAP_WIDTH  32
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+#
+# compare_disasm.py - Check that C++ wrappers compile to the same code as C
+#
+# Usage: ./scripts/compare_disasm.py [--objdump arm-none-eabi-objdump] obj...
+#
+# Disassembles the objects and pairs every function wrap_<name> with
+# ref_<name>. Each pair must match instruction for instruction. Addresses
+# are ignored. Relocations must have the same type and addend. They must
+# also name the same rtos_* function; other symbols differ between C and
+# C++ (mangled names, anonymous namespaces, string literals) and are
+# compared by kind only. Exits 1 and prints both listings on a mismatch.
+# Build the objects with -ffunction-sections -fdata-sections so functions
+# start at 0 and relocation addends are offsets within one object.
+#
+
+import argparse
+import re
+import subprocess
+import sys
+
+FUNC = re.compile(r"^[0-9a-f]+ <([^>]+)>:$")
+INSN = re.compile(r"^\s*[0-9a-f]+:\t")
+RELOC = re.compile(r"^\s*[0-9a-f]+: (R_\S+)\s+(\S+?)([+-]0x[0-9a-f]+)?$")
+ANNOTATION = re.compile(r"\s*<[^>]*>|\s*[#;].*$")
+
+
+def symbol_kind(name):
+    """Keep kernel API names, reduce everything else to a placeholder."""
+    if name.startswith("rtos_") and "." not in name:
+        return name
+    return "<sym>"
+
+
+def load(objdump, path):
+    """Return {function: [normalized line]} for the wrap_/ref_ functions."""
+    out = subprocess.run([objdump, "-dr", "--no-show-raw-insn", path],
+                         check=True, capture_output=True, text=True).stdout
+
+    funcs = {}
+    current = None
+    for line in out.splitlines():
+        m = FUNC.match(line)
+        if m:
+            name = m.group(1)
+            current = funcs.setdefault(name, []) if name.startswith(("wrap_", "ref_")) else None
+            continue
+        if current is None:
+            continue
+
+        m = RELOC.match(line)
+        if m:
+            current.append("reloc %s %s%s" % (m.group(1), symbol_kind(m.group(2)),
+                                              m.group(3) or ""))
+        elif INSN.match(line):
+            insn = line.split("\t", 1)[1]
+            current.append(" ".join(ANNOTATION.sub("", insn).split()))
+
+    return funcs
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare wrap_* and ref_* disassembly")
+    parser.add_argument("objects", nargs="+")
+    parser.add_argument("--objdump", default="objdump")
+    args = parser.parse_args()
+
+    funcs = {}
+    for path in args.objects:
+        funcs.update(load(args.objdump, path))
+
+    names = sorted(name[len("wrap_"):] for name in funcs if name.startswith("wrap_"))
+    if not names:
+        sys.exit("error: no wrap_* functions in %s" % " ".join(args.objects))
+
+    failed = 0
+    for name in names:
+        wrap = funcs["wrap_" + name]
+        ref = funcs.get("ref_" + name)
+        if ref is None:
+            print("%-20s no ref_%s" % (name, name))
+            failed += 1
+        elif wrap != ref:
+            print("%-20s DIFFERS (%d vs %d instructions)" % (name, len(wrap), len(ref)))
+            for w, r in zip(wrap + [""] * len(ref), ref + [""] * len(wrap)):
+                if not w and not r:
+                    break
+                print("  %s %-40s | %s" % (" " if w == r else "!", w, r))
+            failed += 1
+        else:
+            print("%-20s identical (%d instructions)" % (name, len(wrap)))
+
+    if failed:
+        sys.exit("error: %d of %d wrapper functions differ from the C reference"
+                 % (failed, len(names)))
+
+
+if __name__ == "__main__":
+    main()
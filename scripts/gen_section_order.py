@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+#
+# gen_section_order.py - Order .text input sections from an execution profile
+#
+# Usage: ./scripts/gen_section_order.py build/rtos.elf profile.txt [-o text_order.ld]
+#
+# The profile is either a QEMU execution trace (qemu -d exec,nochain -D file)
+# or any list of program counter samples, one hex address per line, e.g.
+# from a debugger's PC sampling. Lines of the form "<count> <function>" are
+# also accepted for hand-written or pre-aggregated profiles.
+#
+# Each sample is attributed to the function containing it. The functions
+# that account for --coverage of all samples are written out, hottest first,
+# as linker input-section rules. linker.ld INCLUDEs the result at the top
+# of .text, so the hot code is packed together and the flash accelerator
+# keeps it cached while the cold code follows. Needs -ffunction-sections.
+#
+
+import argparse
+import bisect
+import re
+import struct
+import sys
+
+STT_FUNC = 2
+QEMU_TRACE = re.compile(r"\[[0-9a-fA-F]+/([0-9a-fA-F]+)/")
+HEX_PC = re.compile(r"^\s*(?:0x)?([0-9a-fA-F]{6,8})\s*$")
+COUNTED = re.compile(r"^\s*(\d+)\s+([A-Za-z_][A-Za-z0-9_]*)\s*$")
+
+
+def load_functions(elf_path):
+    """Return sorted [(start, end, name)] for the FUNC symbols in the ELF."""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF" or elf[4] != 1:
+        sys.exit("error: %s is not a 32-bit ELF file" % elf_path)
+
+    e_shoff, = struct.unpack_from("<I", elf, 0x20)
+    e_shentsize, e_shnum, _ = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(idx):
+        return struct.unpack_from("<IIIIIIIIII", elf, e_shoff + idx * e_shentsize)
+
+    funcs = []
+    for i in range(e_shnum):
+        _, sh_type, _, _, offset, size, link, _, _, entsize = section(i)
+        if sh_type != 2:            # SHT_SYMTAB
+            continue
+        strtab = section(link)[4]
+        for off in range(offset, offset + size, entsize):
+            st_name, st_value, st_size, st_info = struct.unpack_from("<IIIB", elf, off)
+            if (st_info & 0xF) != STT_FUNC or st_size == 0:
+                continue
+            end = elf.index(b"\0", strtab + st_name)
+            name = elf[strtab + st_name:end].decode()
+            start = st_value & ~1   # Drop the Thumb bit
+            funcs.append((start, start + st_size, name))
+
+    if not funcs:
+        sys.exit("error: no function symbols in %s (stripped?)" % elf_path)
+
+    funcs.sort()
+    return funcs
+
+
+def count_samples(profile_path, funcs):
+    starts = [f[0] for f in funcs]
+    counts = {}
+
+    with open(profile_path) as f:
+        for line in f:
+            m = COUNTED.match(line)
+            if m:
+                counts[m.group(2)] = counts.get(m.group(2), 0) + int(m.group(1))
+                continue
+
+            m = QEMU_TRACE.search(line) or HEX_PC.match(line)
+            if not m:
+                continue
+
+            pc = int(m.group(1), 16)
+            idx = bisect.bisect_right(starts, pc) - 1
+            if idx >= 0 and pc < funcs[idx][1]:
+                name = funcs[idx][2]
+                counts[name] = counts.get(name, 0) + 1
+
+    return counts
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Order .text sections from a profile")
+    parser.add_argument("elf")
+    parser.add_argument("profile")
+    parser.add_argument("-o", "--output", default="text_order.ld")
+    parser.add_argument("--coverage", type=float, default=0.95,
+                        help="fraction of samples the hot list must cover")
+    args = parser.parse_args()
+
+    funcs = load_functions(args.elf)
+    counts = count_samples(args.profile, funcs)
+    total = sum(counts.values())
+    if total == 0:
+        sys.exit("error: no samples in %s matched %s" % (args.profile, args.elf))
+
+    hot = []
+    covered = 0
+    for name, count in sorted(counts.items(), key=lambda kv: (-kv[1], kv[0])):
+        if covered >= total * args.coverage:
+            break
+        hot.append((name, count))
+        covered += count
+
+    with open(args.output, "w") as out:
+        out.write("/* Generated by scripts/gen_section_order.py - do not edit */\n")
+        out.write("/* %d functions, %.1f%% of %d samples */\n"
+                  % (len(hot), 100.0 * covered / total, total))
+        for name, count in hot:
+            out.write("*(.text.%s)%s/* %d */\n" % (name, " " * max(1, 40 - len(name)), count))
+
+    print("%s: %d hot functions cover %.1f%% of %d samples"
+          % (args.output, len(hot), 100.0 * covered / total, total))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,337 @@
+#!/usr/bin/env python3
+#
+# gen_system.py - Generate a statically initialized system from a description
+#
+# Usage: ./scripts/gen_system.py system.cfg --config rtos_config.h -o build/
+#
+# Writes rtos_system.c and rtos_system.h. Every TCB, stack, ready list,
+# queue, semaphore, mutex and timer in the description (plus the idle task)
+# becomes initialized data in the state rtos_init and the create/init calls
+# would have left it in, so with RTOS_STATIC_SYSTEM=1 rtos_init only sets
+# up the port and rtos_start picks the first task.
+#
+# One entry per line, '#' starts a comment. Stack and message sizes and
+# arguments are C expressions (no spaces); priorities, queue depths and
+# periods are numbers.
+#
+#   include <header> [optional]         #include it (optional: if present)
+#   default <MACRO> <value>             #define MACRO unless already defined
+#   require <expr>                      #error unless expr is true
+#   task <id> <fn> <prio> <words> [name=<str>] [arg=<expr>]
+#                                       <id>_tcb, created in line order
+#   mutex <id>
+#   sem <id> <0|1>                      binary semaphore, initial count
+#   queue <id> <msg_size> <depth>       <id> plus <id>_buffer
+#   timer <id> <callback> <period_ms> [once] [stopped] [arg=<expr>]
+#
+# Anything the kernel would reject at runtime (stack too small, priority
+# out of range, name too long) is a _Static_assert naming the line.
+#
+
+import argparse
+import os
+import re
+import sys
+
+DEFINE = re.compile(r"^\s*#\s*define\s+(\w+)\s+(\d+)")
+IDENT = re.compile(r"^[A-Za-z_][A-Za-z0-9_]*$")
+
+
+class Entry:
+    def __init__(self, kind, line, args, opts):
+        self.kind = kind
+        self.line = line
+        self.args = args
+        self.opts = opts
+
+
+def read_config(path):
+    """Return {name: int} for the numeric #defines in rtos_config.h."""
+    values = {}
+    with open(path) as f:
+        for line in f:
+            m = DEFINE.match(line)
+            if m and m.group(1) not in values:
+                values[m.group(1)] = int(m.group(2))
+    return values
+
+
+def parse(path):
+    arity = {"include": (1, 2), "default": (2, 2), "require": (1, 1),
+             "task": (4, 4), "mutex": (1, 1), "sem": (2, 2),
+             "queue": (3, 3), "timer": (3, 3)}
+    flags = {"include": {"optional"}, "timer": {"once", "stopped"}}
+    options = {"task": {"name", "arg"}, "timer": {"arg"}}
+
+    entries = []
+    names = set()
+    with open(path) as f:
+        for lineno, text in enumerate(f, 1):
+            where = "%s:%d" % (os.path.basename(path), lineno)
+            words = text.split("#", 1)[0].split()
+            if not words:
+                continue
+
+            kind = words[0]
+            if kind not in arity:
+                sys.exit("error: %s: unknown entry '%s'" % (where, kind))
+
+            args, opts = [], {}
+            for word in words[1:]:
+                key, eq, value = word.partition("=")
+                if eq and key in options.get(kind, ()):
+                    opts[key] = value
+                elif word in flags.get(kind, ()):
+                    opts[word] = True
+                else:
+                    args.append(word)
+
+            lo, hi = arity[kind]
+            if not lo <= len(args) <= hi:
+                sys.exit("error: %s: '%s' takes %d argument%s"
+                         % (where, kind, lo, "" if lo == 1 else "s"))
+
+            if kind in ("task", "mutex", "sem", "queue", "timer"):
+                if not IDENT.match(args[0]):
+                    sys.exit("error: %s: '%s' is not a C identifier" % (where, args[0]))
+                if args[0] in names:
+                    sys.exit("error: %s: '%s' declared twice" % (where, args[0]))
+                names.add(args[0])
+
+            entries.append(Entry(kind, where, args, opts))
+
+    return entries
+
+
+def number(entry, text, what):
+    try:
+        return int(text, 0)
+    except ValueError:
+        sys.exit("error: %s: %s must be a number, not '%s'" % (entry.line, what, text))
+
+
+def generate(entries, config, desc_name):
+    max_prio = config.get("RTOS_MAX_PRIORITIES")
+    tick_hz = config.get("RTOS_TICK_RATE_HZ")
+    if max_prio is None or tick_hz is None:
+        sys.exit("error: RTOS_MAX_PRIORITIES and RTOS_TICK_RATE_HZ must be numeric in the config")
+
+    tasks = [e for e in entries if e.kind == "task"]
+    timers = [e for e in entries if e.kind == "timer"]
+
+    # The idle task is created first by rtos_init, so it leads its lists
+    idle = Entry("task", "idle task", ["idle", "rtos_idle_task", str(max_prio - 1),
+                                       "RTOS_IDLE_STACK_SIZE"], {"name": "Idle"})
+    all_tasks = [idle] + tasks
+
+    for t in tasks:
+        prio = number(t, t.args[2], "priority")
+        if not 0 <= prio < max_prio:
+            sys.exit("error: %s: priority %d outside 0..%d" % (t.line, prio, max_prio - 1))
+    for t in timers:
+        if number(t, t.args[2], "period") <= 0:
+            sys.exit("error: %s: timer period must be > 0 ms" % t.line)
+    for q in (e for e in entries if e.kind == "queue"):
+        if number(q, q.args[2], "depth") <= 0:
+            sys.exit("error: %s: queue depth must be > 0" % q.line)
+    for s in (e for e in entries if e.kind == "sem"):
+        if s.args[1] not in ("0", "1"):
+            sys.exit("error: %s: semaphores are binary, initial count 0 or 1" % s.line)
+
+    by_prio = {}
+    for t in all_tasks:
+        by_prio.setdefault(int(t.args[2], 0), []).append(t)
+
+    def tcb(t):
+        return "%s_tcb" % t.args[0]
+
+    def ref(t):
+        return "&" + tcb(t) if t is not None else "NULL"
+
+    # Timers tick in expiry order; equal expiries keep declaration order
+    def ticks(t):
+        return max(1, number(t, t.args[2], "period") * tick_hz // 1000)
+
+    running = sorted((t for t in timers if "stopped" not in t.opts), key=ticks)
+
+    guard = "RTOS_SYSTEM_H"
+    hdr = []
+    hdr.append("/* Generated by scripts/gen_system.py from %s - do not edit */\n" % desc_name)
+    hdr.append("\n#ifndef %s\n#define %s\n\n#include \"rtos.h\"\n\n" % (guard, guard))
+    for e in entries:
+        if e.kind == "task":
+            hdr.append("extern rtos_tcb_t %s;\n" % tcb(e))
+        elif e.kind == "mutex":
+            hdr.append("extern rtos_mutex_t %s;\n" % e.args[0])
+        elif e.kind == "sem":
+            hdr.append("extern rtos_sem_t %s;\n" % e.args[0])
+        elif e.kind == "queue":
+            hdr.append("extern rtos_queue_t %s;\n" % e.args[0])
+        elif e.kind == "timer":
+            hdr.append("extern rtos_timer_t %s;\n" % e.args[0])
+    hdr.append("\n#endif /* %s */\n" % guard)
+
+    out = []
+    w = out.append
+    w("/* Generated by scripts/gen_system.py from %s - do not edit */\n\n" % desc_name)
+    w("#include \"rtos.h\"\n#include \"rtos_internal.h\"\n#include \"stm32f4xx.h\"\n")
+    w("#include \"rtos_system.h\"\n")
+
+    for e in entries:
+        if e.kind == "include":
+            if "optional" in e.opts:
+                w("\n#if defined(__has_include)\n#if __has_include(\"%s\")\n"
+                  "#include \"%s\"\n#endif\n#endif\n" % (e.args[0], e.args[0]))
+            else:
+                w("#include \"%s\"\n" % e.args[0])
+        elif e.kind == "default":
+            w("\n#ifndef %s\n#define %s %s\n#endif\n" % (e.args[0], e.args[0], e.args[1]))
+
+    w("\n#if !RTOS_STATIC_SYSTEM\n#error \"rtos_system.c needs RTOS_STATIC_SYSTEM=1\"\n#endif\n")
+    for e in entries:
+        if e.kind == "require":
+            w("#if !(%s)\n#error \"%s: requires %s\"\n#endif\n" % (e.args[0], e.line, e.args[0]))
+
+    w("\n_Static_assert(RTOS_MAX_PRIORITIES == %d, \"%s was generated for %d priorities\");\n"
+      % (max_prio, desc_name, max_prio))
+    w("_Static_assert(RTOS_TICK_RATE_HZ == %d, \"%s was generated for a %d Hz tick\");\n"
+      % (tick_hz, desc_name, tick_hz))
+
+    w("\n/* Initialized kernel data follows RTOS_KERNEL_IN_CCM like RTOS_KERNEL_DATA */\n"
+      "#if RTOS_KERNEL_IN_CCM\n#define SYSTEM_DATA             RTOS_CCM_DATA\n"
+      "#else\n#define SYSTEM_DATA\n#endif\n")
+    w("\n/* The MPU guard is the bottom block of an aligned stack */\n"
+      "#if RTOS_ENABLE_MPU_GUARD\n#define SYSTEM_STACK_ALIGN      RTOS_MPU_GUARD_SIZE\n"
+      "#else\n#define SYSTEM_STACK_ALIGN      8\n#endif\n")
+
+    # Entry points and callbacks; repeating a prototype from a header is harmless
+    protos = []
+    for e in tasks:
+        protos.append(e.args[1])
+    for e in timers:
+        protos.append(e.args[1])
+    if protos:
+        w("\n")
+        for fn in dict.fromkeys(protos):
+            w("void %s(void *arg);\n" % fn)
+
+    w("\n/*---------------------------------------------------------------------------*/\n"
+      "/* Tasks */\n"
+      "/*---------------------------------------------------------------------------*/\n")
+    for t in all_tasks:
+        ident, fn, prio, words = t.args
+        words = "(%s)" % words
+        name = t.opts.get("name", ident)
+        arg = t.opts.get("arg", "NULL")
+        link = "static " if t is idle else ""
+        peers = by_prio[int(prio, 0)]
+        i = peers.index(t)
+        prev = peers[i - 1] if i > 0 else None
+        nxt = peers[i + 1] if i + 1 < len(peers) else None
+        after = all_tasks[all_tasks.index(t) + 1] if t is not all_tasks[-1] else None
+
+        w("\n/* %s */\n" % t.line)
+        w("_Static_assert(%s >= RTOS_MIN_STACK_WORDS && %s <= UINT16_MAX,\n"
+          "               \"%s: stack of %s must be RTOS_MIN_STACK_WORDS..65535 words\");\n"
+          % (words, words, t.line, ident))
+        w("#if RTOS_ENABLE_TASK_NAMES\n"
+          "_Static_assert(sizeof(\"%s\") <= RTOS_TASK_NAME_LEN, \"%s: name '%s' too long\");\n"
+          "#endif\n" % (name, t.line, name))
+
+        w("static SYSTEM_DATA uint32_t %s_stack[%s]\n" % (ident, words))
+        w("    __attribute__((aligned(SYSTEM_STACK_ALIGN))) = {\n")
+        w("#if RTOS_ENABLE_STACK_CHECK\n")
+        w("    [0 ... %s - RTOS_INITIAL_FRAME_WORDS - 1] = STACK_MARKER,\n" % words)
+        w("#endif\n")
+        w("    [%s - RTOS_INITIAL_FRAME_WORDS] = RTOS_INITIAL_FRAME(%s, %s),\n" % (words, fn, arg))
+        w("};\n\n")
+
+        w("%sSYSTEM_DATA rtos_tcb_t %s = {\n" % (link, tcb(t)))
+        w("    .stack_ptr = &%s_stack[%s - RTOS_INITIAL_FRAME_WORDS],\n" % (ident, words))
+        w("    .next = %s,\n    .prev = %s,\n" % (ref(nxt), ref(prev)))
+        w("    .priority = %s,\n    .base_priority = %s,\n" % (prio, prio))
+        w("    .state = RTOS_TASK_READY,\n")
+        w("#if RTOS_ENABLE_MPU_GUARD\n")
+        w("    .mpu_rbar = (uint32_t)(%s * 4 >= 2 * RTOS_MPU_GUARD_SIZE ? %s_stack : rtos_port_spare_guard) +\n"
+          "                (MPU_RBAR_VALID | RTOS_MPU_GUARD_REGION),\n" % (words, ident))
+        w("#endif\n")
+        w("    .stack_base = %s_stack,\n    .stack_size = %s,\n" % (ident, words))
+        w("#if RTOS_ENABLE_STACK_CHECK\n    .stack_hwm = %s,\n" % words)
+        w("#if RTOS_STACK_PAINT_DEFERRED\n    .stack_painted = %s,\n#endif\n#endif\n" % words)
+        w("    .task_next = %s,\n" % ref(after))
+        w("#if RTOS_ENABLE_TASK_NAMES\n    .name = \"%s\",\n#endif\n" % name)
+        w("};\n")
+
+    objects = [e for e in entries if e.kind in ("mutex", "sem", "queue", "timer")]
+    if objects:
+        w("\n/*---------------------------------------------------------------------------*/\n"
+          "/* Synchronization Objects and Timers */\n"
+          "/*---------------------------------------------------------------------------*/\n")
+    for e in objects:
+        ident = e.args[0]
+        w("\n/* %s */\n" % e.line)
+        if e.kind == "mutex":
+            w("SYSTEM_DATA rtos_mutex_t %s;\n" % ident)
+        elif e.kind == "sem":
+            w("SYSTEM_DATA rtos_sem_t %s = { .count = %s };\n" % (ident, e.args[1]))
+        elif e.kind == "queue":
+            size, depth = "(%s)" % e.args[1], e.args[2]
+            w("_Static_assert(%s > 0, \"%s: message size must be > 0\");\n" % (size, e.line))
+            w("static uint8_t %s_buffer[%s * %s] __attribute__((aligned(4)));\n"
+              % (ident, size, depth))
+            w("SYSTEM_DATA rtos_queue_t %s = {\n" % ident)
+            w("    .buffer = %s_buffer,\n    .msg_size = %s,\n    .capacity = %s,\n};\n"
+              % (ident, size, depth))
+        elif e.kind == "timer":
+            active = "stopped" not in e.opts
+            i = running.index(e) if active else -1
+            nxt = "&" + running[i + 1].args[0] if active and i + 1 < len(running) else "NULL"
+            w("SYSTEM_DATA rtos_timer_t %s = {\n" % ident)
+            w("    .period_ticks = %d,\n    .next_expiry = %d,\n" % (ticks(e), ticks(e) if active else 0))
+            w("    .callback = %s,\n    .arg = %s,\n" % (e.args[1], e.opts.get("arg", "NULL")))
+            w("    .active = %d,\n    .one_shot = %d,\n    .next = %s,\n};\n"
+              % (active, "once" in e.opts, nxt))
+
+    w("\n/*---------------------------------------------------------------------------*/\n"
+      "/* Kernel State */\n"
+      "/*---------------------------------------------------------------------------*/\n\n")
+    bitmap = " | ".join("(1UL << %d)" % (31 - p) for p in sorted(by_prio))
+    w("SYSTEM_DATA rtos_kernel_t g_kernel = {\n")
+    w("    .priority_bitmap = %s,\n" % bitmap)
+    w("    .ready_list = {\n")
+    for p in sorted(by_prio):
+        peers = by_prio[p]
+        w("        [%d] = { %s, %s },\n" % (p, ref(peers[0]), ref(peers[-1])))
+    w("    },\n")
+    w("    .task_list = %s,\n" % ref(all_tasks[0]))
+    w("    .timer_list = %s,\n" % ("&" + running[0].args[0] if running else "NULL"))
+    w("};\n")
+
+    return "".join(hdr), "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a static RTOS system")
+    parser.add_argument("description")
+    parser.add_argument("--config", default="rtos_config.h",
+                        help="rtos_config.h to read priorities and tick rate from")
+    parser.add_argument("-o", "--output-dir", default=".")
+    args = parser.parse_args()
+
+    config = read_config(args.config)
+    entries = parse(args.description)
+    header, source = generate(entries, config, os.path.basename(args.description))
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    for name, text in (("rtos_system.h", header), ("rtos_system.c", source)):
+        with open(os.path.join(args.output_dir, name), "w") as out:
+            out.write(text)
+
+    ntasks = sum(1 for e in entries if e.kind == "task")
+    print("%s: %d tasks (+ idle), %d objects"
+          % (args.output_dir, ntasks, sum(1 for e in entries if e.kind in
+                                          ("mutex", "sem", "queue", "timer"))))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+#
+# log_decode.py - Decode HAL_LOG deferred log frames
+#
+# Usage: ./scripts/log_decode.py build/rtos.elf [capture.bin]
+#
+# Reads the raw byte stream written by hal_log_drain (from a file or stdin)
+# and formats each frame using the strings stored in the .hal_log_fmt
+# section of the ELF.
+#
+
+import struct
+import sys
+
+FRAME_VALID = 0x80000000
+
+
+def load_format_section(elf_path):
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF" or elf[4] != 1:
+        sys.exit("error: %s is not a 32-bit ELF file" % elf_path)
+
+    e_shoff, = struct.unpack_from("<I", elf, 0x20)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(idx):
+        return struct.unpack_from("<IIIIIIIIII", elf, e_shoff + idx * e_shentsize)
+
+    shstr = section(e_shstrndx)
+    for i in range(e_shnum):
+        name, _, _, addr, offset, size = section(i)[:6]
+        end = elf.index(b"\0", shstr[4] + name)
+        if elf[shstr[4] + name:end] == b".hal_log_fmt":
+            return addr, elf[offset:offset + size]
+
+    sys.exit("error: no .hal_log_fmt section in %s" % elf_path)
+
+
+def c_format(fmt, args):
+    """Format a hal_printf-style string (%d %i %u %x %X %c %p %%)."""
+    out = []
+    args = list(args)
+    i = 0
+    while i < len(fmt):
+        ch = fmt[i]
+        if ch != "%":
+            out.append(ch)
+            i += 1
+            continue
+
+        i += 1
+        pad = " "
+        if i < len(fmt) and fmt[i] == "0":
+            pad = "0"
+            i += 1
+        width = 0
+        while i < len(fmt) and fmt[i].isdigit():
+            width = width * 10 + int(fmt[i])
+            i += 1
+        conv = fmt[i] if i < len(fmt) else ""
+        i += 1
+
+        if conv == "%":
+            out.append("%")
+            continue
+
+        val = args.pop(0) if args else 0
+        if conv in "di":
+            text = str(val - (1 << 32) if val & 0x80000000 else val)
+        elif conv == "u":
+            text = str(val)
+        elif conv in "xX":
+            text = "%X" % val
+        elif conv == "p":
+            text = "0x%08X" % val
+        elif conv == "c":
+            text = chr(val & 0xFF)
+        else:
+            text = "<%%%s:0x%X>" % (conv, val)
+        out.append(text.rjust(width, pad))
+
+    return "".join(out)
+
+
+def decode(stream, base, strings):
+    data = stream.read()
+    pos = 0
+    while pos + 8 <= len(data):
+        header, tick = struct.unpack_from("<II", data, pos)
+        if not header & FRAME_VALID:
+            pos += 1                    # Resynchronize on garbage
+            continue
+
+        nargs = (header >> 24) & 0x0F
+        offset = (header & 0x00FFFFFF) - base
+        if pos + 8 + nargs * 4 > len(data) or not 0 <= offset < len(strings):
+            pos += 1
+            continue
+
+        args = struct.unpack_from("<%dI" % nargs, data, pos + 8)
+        end = strings.index(b"\0", offset)
+        fmt = strings[offset:end].decode("ascii", "replace")
+        sys.stdout.write("[%10u] %s" % (tick, c_format(fmt, args)))
+        if not fmt.endswith("\n"):
+            sys.stdout.write("\n")
+        pos += 8 + nargs * 4
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: %s <rtos.elf> [capture.bin]" % sys.argv[0])
+
+    base, strings = load_format_section(sys.argv[1])
+
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], "rb") as f:
+            decode(f, base, strings)
+    else:
+        decode(sys.stdin.buffer, base, strings)
+
+
+if __name__ == "__main__":
+    main()
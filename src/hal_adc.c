@@ -0,0 +1,306 @@
+/**
+ * @file hal_adc.c
+ * @brief ADC HAL Implementation
+ *
+ * Timer-triggered continuous sampling on ADC1. TIM2's update event
+ * starts each scan, DMA2 Stream 0 moves the results into two ping-pong
+ * buffers, and the only interrupt is one per completed block.
+ */
+
+#include "hal.h"
+#include "rtos.h"
+#include "stm32f4xx.h"
+
+/*---------------------------------------------------------------------------*/
+/* Sampler State */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Buffer ownership: the stream fills one buffer while the other is either
+ * ready (completed, not yet taken), held by a task, or free. When a buffer
+ * completes, the stream has already switched to the other one; if that one
+ * was still ready or held, its contents are being overwritten and the new
+ * block is flagged as following an overrun.
+ */
+typedef struct {
+    hal_dma_handle_t dma;
+    uint16_t *buf[2];
+    uint32_t block_samples;
+    volatile uint8_t ready;         /* Bit per buffer: completed, not taken */
+    volatile uint8_t held;          /* Bit per buffer: taken, not released */
+    volatile uint8_t overrun;       /* Overrun pending for the next block */
+    uint8_t running;
+    uint32_t sequence[2];           /* Block number of each buffer's data */
+    uint32_t timestamp[2];          /* Tick at which each buffer completed */
+    volatile uint32_t blocks;       /* Blocks completed since start */
+    volatile uint32_t overruns;     /* Blocks lost to a slow reader */
+    volatile uint32_t adc_overruns; /* ADC OVR events (DMA fell behind) */
+    rtos_sem_t block_sem;           /* Posted on every completed block */
+} adc_sampler_t;
+
+static adc_sampler_t adc_sampler;
+
+/*---------------------------------------------------------------------------*/
+/* Interrupt Handlers */
+/*---------------------------------------------------------------------------*/
+
+static void adc_dma_irq(uint32_t flags, void *arg) {
+    adc_sampler_t *a = (adc_sampler_t *)arg;
+
+    if (!(flags & DMA_FLAG_TC)) {
+        return;
+    }
+
+    /* CT already points at the buffer now being filled */
+    uint8_t done = hal_dma_current_target(&a->dma) ^ 1;
+    uint8_t done_bit = (uint8_t)(1U << done);
+    uint8_t next_bit = (uint8_t)(1U << (done ^ 1));
+
+    if ((a->ready | a->held) & next_bit) {
+        a->overrun = 1;
+        a->overruns++;
+        a->ready &= (uint8_t)~next_bit;
+    }
+
+    a->sequence[done] = a->blocks++;
+    a->timestamp[done] = rtos_now();
+    a->ready |= done_bit;
+
+    rtos_sem_post(&a->block_sem);
+}
+
+/*
+ * After an overrun the next trigger starts the scan again at SQ1 while the
+ * stream is part-way into a block, which would shift every later sample to
+ * the wrong channel. Recover as RM0090 describes: stop the trigger, reload
+ * the stream from the start of buffer 0, clear OVR, re-arm the DMA
+ * requests and restart the timer. The partial block is dropped; a block
+ * that was waiting in buffer 0 is lost as well and counted as an overrun.
+ * Buffer 1 keeps its state, so a task still holding it is detected as
+ * before. Runs at the DMA interrupt priority, so the stream's own
+ * interrupt cannot interleave.
+ */
+void ADC_IRQHandler(void) {
+    adc_sampler_t *a = &adc_sampler;
+
+    if (!(ADC1->SR & ADC_SR_OVR)) {
+        return;
+    }
+
+    TIM2->CR1 &= ~TIM_CR1_CEN;
+    hal_dma_stop(&a->dma);
+
+    if ((a->ready | a->held) & 0x1) {
+        a->overruns++;
+    }
+    a->ready &= (uint8_t)~0x1U;
+    a->held &= (uint8_t)~0x1U;
+    hal_dma_start(&a->dma, (uint32_t)&ADC1->DR, a->buf[0], a->buf[1],
+                  a->block_samples);
+
+    ADC1->SR = ~ADC_SR_OVR;             /* rc_w0: leave EOC and STRT alone */
+    ADC1->CR2 &= ~ADC_CR2_DMA;
+    ADC1->CR2 |= ADC_CR2_DMA;
+    a->adc_overruns++;
+    a->overrun = 1;
+
+    TIM2->CR1 |= TIM_CR1_CEN;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Configuration */
+/*---------------------------------------------------------------------------*/
+
+static void adc_set_sample_time(uint8_t channel, uint8_t smp) {
+    if (channel < 10) {
+        uint32_t pos = channel * 3;
+        ADC1->SMPR2 = (ADC1->SMPR2 & ~(0x7UL << pos)) | ((uint32_t)smp << pos);
+    } else {
+        uint32_t pos = (channel - 10) * 3;
+        ADC1->SMPR1 = (ADC1->SMPR1 & ~(0x7UL << pos)) | ((uint32_t)smp << pos);
+    }
+}
+
+static void adc_set_sequence(const uint8_t *channels, uint8_t count) {
+    uint32_t sqr[3] = { 0, 0, 0 };     /* SQR3, SQR2, SQR1 */
+
+    for (uint8_t i = 0; i < count; i++) {
+        sqr[i / 6] |= (uint32_t)channels[i] << ((i % 6) * 5);
+    }
+
+    ADC1->SQR3 = sqr[0];
+    ADC1->SQR2 = sqr[1];
+    ADC1->SQR1 = sqr[2] | ((uint32_t)(count - 1) << 20);
+}
+
+rtos_status_t hal_adc_start(const hal_adc_config_t *config) {
+    adc_sampler_t *a = &adc_sampler;
+
+    if (config == NULL || config->channels == NULL ||
+        config->num_channels == 0 || config->num_channels > 16 ||
+        config->buf0 == NULL || config->buf1 == NULL ||
+        config->block_samples == 0 || config->block_samples > 0xFFFF ||
+        (config->block_samples % config->num_channels) != 0 ||
+        config->sample_rate_hz == 0 || config->sample_time > 7) {
+        return RTOS_ERR_PARAM;
+    }
+
+    for (uint8_t i = 0; i < config->num_channels; i++) {
+        if (config->channels[i] > 18) {
+            return RTOS_ERR_PARAM;
+        }
+    }
+
+    if (a->running) {
+        return RTOS_ERR_STATE;
+    }
+
+    if (hal_dma_alloc(&a->dma, DMA2, 0) != RTOS_OK) {
+        return RTOS_ERR_RESOURCE;
+    }
+
+    a->buf[0] = config->buf0;
+    a->buf[1] = config->buf1;
+    a->block_samples = config->block_samples;
+    a->ready = 0;
+    a->held = 0;
+    a->overrun = 0;
+    a->blocks = 0;
+    a->overruns = 0;
+    a->adc_overruns = 0;
+    rtos_sem_init(&a->block_sem, 0);
+
+    /* ADC1: scan the sequence once per trigger, one DMA request per result */
+    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;
+    ADC_COMMON->CCR = (ADC_COMMON->CCR & ~(0x3UL << ADC_CCR_ADCPRE_Pos)) |
+                      (1UL << ADC_CCR_ADCPRE_Pos);      /* PCLK2 / 4 */
+    ADC1->CR2 = 0;
+    ADC1->CR1 = ADC_CR1_SCAN | ADC_CR1_OVRIE;
+    for (uint8_t i = 0; i < config->num_channels; i++) {
+        adc_set_sample_time(config->channels[i], config->sample_time);
+    }
+    adc_set_sequence(config->channels, config->num_channels);
+    ADC1->SR = 0;
+    ADC1->CR2 = ADC_CR2_DMA | ADC_CR2_DDS |
+                ((uint32_t)ADC_EXTSEL_TIM2_TRGO << ADC_CR2_EXTSEL_Pos) |
+                (1UL << ADC_CR2_EXTEN_Pos) | ADC_CR2_ADON;
+
+    /* DMA2 Stream 0 Channel 0: ADC1 data into the ping-pong buffers */
+    hal_dma_config_t dma_cfg = {
+        .channel = 0,
+        .direction = HAL_DMA_PERIPH_TO_MEM,
+        .periph_size = HAL_DMA_SIZE_HALFWORD,
+        .mem_size = HAL_DMA_SIZE_HALFWORD,
+        .mem_inc = 1,
+        .double_buffer = 1,
+        .priority = 3,
+    };
+    hal_dma_configure(&a->dma, &dma_cfg);
+    hal_dma_set_callback(&a->dma, adc_dma_irq, a);
+    hal_dma_start(&a->dma, (uint32_t)&ADC1->DR, a->buf[0], a->buf[1],
+                  a->block_samples);
+
+    NVIC_SetPriority(ADC_IRQn, RTOS_DMA_IRQ_PRIORITY);
+    NVIC_ClearPendingIRQ(ADC_IRQn);
+    NVIC_EnableIRQ(ADC_IRQn);
+
+    /* TIM2 update event at the scan rate drives TRGO */
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+    TIM2->CR1 = 0;
+    TIM2->PSC = 0;
+    TIM2->ARR = (hal_clock_timer(1) / config->sample_rate_hz) - 1;
+    TIM2->CR2 = TIM_CR2_MMS_UPDATE;
+    TIM2->EGR = TIM_EGR_UG;
+    TIM2->SR = 0;
+
+    a->running = 1;
+    TIM2->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+    return RTOS_OK;
+}
+
+void hal_adc_stop(void) {
+    adc_sampler_t *a = &adc_sampler;
+
+    if (!a->running) {
+        return;
+    }
+
+    TIM2->CR1 &= ~TIM_CR1_CEN;
+    NVIC_DisableIRQ(ADC_IRQn);
+    ADC1->CR2 = 0;
+    hal_dma_free(&a->dma);
+    a->running = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Block Hand-off */
+/*---------------------------------------------------------------------------*/
+
+rtos_status_t hal_adc_wait_block(hal_adc_block_t *block, uint32_t timeout_ms) {
+    adc_sampler_t *a = &adc_sampler;
+
+    if (block == NULL) {
+        return RTOS_ERR_PARAM;
+    }
+
+    while (1) {
+        uint32_t state = rtos_enter_critical();
+
+        if (a->ready) {
+            /* With two buffers at most one can be ready and not overwritten */
+            uint8_t idx = (a->ready & 0x1) ? 0 : 1;
+
+            a->ready &= (uint8_t)~(1U << idx);
+            a->held |= (uint8_t)(1U << idx);
+
+            block->samples = a->buf[idx];
+            block->count = a->block_samples;
+            block->sequence = a->sequence[idx];
+            block->timestamp = a->timestamp[idx];
+            block->overrun = a->overrun;
+            a->overrun = 0;
+
+            rtos_exit_critical(state);
+            return RTOS_OK;
+        }
+
+        rtos_exit_critical(state);
+
+        rtos_status_t result = rtos_sem_wait(&a->block_sem, timeout_ms);
+        if (result != RTOS_OK) {
+            return result;
+        }
+    }
+}
+
+void hal_adc_release_block(const hal_adc_block_t *block) {
+    adc_sampler_t *a = &adc_sampler;
+
+    if (block == NULL) {
+        return;
+    }
+
+    uint32_t state = rtos_enter_critical();
+    for (uint8_t i = 0; i < 2; i++) {
+        if (block->samples == a->buf[i]) {
+            a->held &= (uint8_t)~(1U << i);
+        }
+    }
+    rtos_exit_critical(state);
+}
+
+void hal_adc_get_stats(hal_adc_stats_t *stats) {
+    adc_sampler_t *a = &adc_sampler;
+
+    if (stats == NULL) {
+        return;
+    }
+
+    uint32_t state = rtos_enter_critical();
+    stats->blocks = a->blocks;
+    stats->overruns = a->overruns;
+    stats->adc_overruns = a->adc_overruns;
+    stats->dma_errors = a->dma.errors;
+    rtos_exit_critical(state);
+}
@@ -0,0 +1,225 @@
+/**
+ * @file hal_clock.c
+ * @brief Clock Tree HAL Implementation
+ *
+ * Brings SYSCLK up from the 16 MHz HSI to the PLL, sets FLASH wait states
+ * and the ART accelerator, and derives the AHB/APB prescalers. Every ready
+ * flag is polled with a timeout; on failure the system stays on HSI
+ * (which is also what happens on QEMU, where RCC is not modelled).
+ */
+
+#include "hal.h"
+#include "stm32f4xx.h"
+
+/*---------------------------------------------------------------------------*/
+/* Clock Limits */
+/*---------------------------------------------------------------------------*/
+
+#define HSI_HZ              16000000UL
+#define PLL_VCO_IN_HZ       2000000UL       /* PLLM output, lowest PLL jitter */
+#define PLL_VCO_IN_MIN_HZ   1000000UL
+#define PLL_VCO_MIN_HZ      100000000UL
+#define PLL_VCO_MAX_HZ      432000000UL
+#define PLL_48M_HZ          48000000UL
+#define SYSCLK_MAX_HZ       168000000UL
+#define APB1_MAX_HZ         42000000UL
+#define APB2_MAX_HZ         84000000UL
+#define FLASH_WS_STEP_HZ    30000000UL      /* Per wait state at 2.7-3.6 V */
+#define VOS_SCALE2_MAX_HZ   144000000UL
+
+/* Bus clocks, recomputed from RCC by hal_clock_update */
+static uint32_t clock_sysclk = RTOS_CPU_CLOCK_HZ;
+static uint32_t clock_hclk = RTOS_CPU_CLOCK_HZ;
+static uint32_t clock_pclk1 = RTOS_CPU_CLOCK_HZ;
+static uint32_t clock_pclk2 = RTOS_CPU_CLOCK_HZ;
+
+/*---------------------------------------------------------------------------*/
+/* Helpers */
+/*---------------------------------------------------------------------------*/
+
+static uint8_t clock_wait(volatile uint32_t *reg, uint32_t mask, uint32_t value) {
+    for (uint32_t i = 0; i < RTOS_CLOCK_TIMEOUT; i++) {
+        if ((*reg & mask) == value) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void clock_set_flash(uint32_t hclk) {
+    uint32_t latency = (hclk - 1) / FLASH_WS_STEP_HZ;
+
+    /* Caches may only be reset while disabled */
+    FLASH->ACR = latency;
+    FLASH->ACR = latency | FLASH_ACR_ICRST | FLASH_ACR_DCRST;
+    FLASH->ACR = latency | FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN;
+}
+
+/* Smallest APB divider (as a PPRE code) keeping the bus under its limit */
+static uint32_t clock_apb_code(uint32_t hclk, uint32_t max_hz) {
+    uint32_t div = 1;
+    uint32_t code = 0;
+
+    while ((hclk / div) > max_hz && div < 16) {
+        div <<= 1;
+        code = (code == 0) ? 0x4 : code + 1;
+    }
+    return code;
+}
+
+static uint32_t clock_apb_div(uint32_t code) {
+    return (code & 0x4) ? (2UL << (code & 0x3)) : 1;
+}
+
+static uint32_t clock_ahb_div(uint32_t code) {
+    static const uint16_t ahb_div[8] = { 2, 4, 8, 16, 64, 128, 256, 512 };
+    return (code & 0x8) ? ahb_div[code & 0x7] : 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Clock Query */
+/*---------------------------------------------------------------------------*/
+
+void hal_clock_update(void) {
+    uint32_t cfgr = RCC->CFGR;
+    uint32_t sysclk;
+
+    switch ((cfgr >> RCC_CFGR_SWS_Pos) & 0x3) {
+    case 1:
+        sysclk = RTOS_HSE_HZ;
+        break;
+    case 2: {
+        uint32_t pll = RCC->PLLCFGR;
+        uint32_t in = (pll & RCC_PLLCFGR_PLLSRC_HSE) ? RTOS_HSE_HZ : HSI_HZ;
+        uint32_t m = (pll >> RCC_PLLCFGR_PLLM_Pos) & 0x3F;
+        uint32_t n = (pll >> RCC_PLLCFGR_PLLN_Pos) & 0x1FF;
+        uint32_t p = (((pll >> RCC_PLLCFGR_PLLP_Pos) & 0x3) + 1) * 2;
+        sysclk = (m != 0) ? ((in / m) * n) / p : HSI_HZ;
+        break;
+    }
+    default:
+        sysclk = HSI_HZ;
+        break;
+    }
+
+    clock_sysclk = sysclk;
+    clock_hclk = sysclk / clock_ahb_div((cfgr >> RCC_CFGR_HPRE_Pos) & 0xF);
+    clock_pclk1 = clock_hclk / clock_apb_div((cfgr >> RCC_CFGR_PPRE1_Pos) & 0x7);
+    clock_pclk2 = clock_hclk / clock_apb_div((cfgr >> RCC_CFGR_PPRE2_Pos) & 0x7);
+}
+
+uint32_t hal_clock_sysclk(void) {
+    return clock_sysclk;
+}
+
+uint32_t hal_clock_hclk(void) {
+    return clock_hclk;
+}
+
+uint32_t hal_clock_pclk1(void) {
+    return clock_pclk1;
+}
+
+uint32_t hal_clock_pclk2(void) {
+    return clock_pclk2;
+}
+
+uint32_t hal_clock_timer(uint8_t apb) {
+    uint32_t pclk = (apb == 2) ? clock_pclk2 : clock_pclk1;
+
+    /* Timers run at twice PCLK whenever the APB is divided */
+    return (pclk != clock_hclk) ? pclk * 2 : pclk;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Clock Initialization */
+/*---------------------------------------------------------------------------*/
+
+rtos_status_t hal_clock_init(uint32_t sysclk_hz) {
+    if (sysclk_hz == 0 || sysclk_hz > SYSCLK_MAX_HZ ||
+        (sysclk_hz % PLL_VCO_IN_MIN_HZ) != 0) {
+        return RTOS_ERR_PARAM;
+    }
+
+    /* Pick the smallest P that puts the VCO in range */
+    uint32_t p;
+    uint32_t vco = 0;
+    for (p = 2; p <= 8; p += 2) {
+        vco = sysclk_hz * p;
+        if (vco >= PLL_VCO_MIN_HZ && vco <= PLL_VCO_MAX_HZ) {
+            break;
+        }
+    }
+    if (p > 8) {
+        return RTOS_ERR_PARAM;
+    }
+
+    uint32_t q = (vco + PLL_48M_HZ - 1) / PLL_48M_HZ;
+    if (q < 2) {
+        q = 2;
+    } else if (q > 15) {
+        q = 15;
+    }
+
+    /* PLL input: HSE if fitted and it starts, else HSI */
+    uint32_t pll_in = HSI_HZ;
+    uint32_t pll_src = 0;
+    if (RTOS_HSE_HZ != 0) {
+        RCC->CR |= RCC_CR_HSEON;
+        if (clock_wait(&RCC->CR, RCC_CR_HSERDY, RCC_CR_HSERDY)) {
+            pll_in = RTOS_HSE_HZ;
+            pll_src = RCC_PLLCFGR_PLLSRC_HSE;
+        } else {
+            RCC->CR &= ~RCC_CR_HSEON;
+        }
+    }
+
+    /* Regulator scale 1 is required above 144 MHz */
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+    if (sysclk_hz > VOS_SCALE2_MAX_HZ) {
+        PWR->CR |= PWR_CR_VOS;
+    }
+
+    /* Run from HSI while the PLL is reprogrammed */
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW_Msk) | RCC_CFGR_SW_HSI;
+    clock_wait(&RCC->CFGR, 0x3UL << RCC_CFGR_SWS_Pos, 0);
+    RCC->CR &= ~RCC_CR_PLLON;
+
+    /* 2 MHz into the VCO where M and N divide evenly (HSI, 8 MHz HSE),
+     * else 1 MHz, e.g. for a 25 MHz HSE */
+    uint32_t vco_in = PLL_VCO_IN_HZ;
+    if ((pll_in % vco_in) != 0 || (vco % vco_in) != 0) {
+        vco_in = PLL_VCO_IN_MIN_HZ;
+    }
+
+    RCC->PLLCFGR = ((pll_in / vco_in) << RCC_PLLCFGR_PLLM_Pos) |
+                   ((vco / vco_in) << RCC_PLLCFGR_PLLN_Pos) |
+                   (((p / 2) - 1) << RCC_PLLCFGR_PLLP_Pos) |
+                   pll_src |
+                   (q << RCC_PLLCFGR_PLLQ_Pos);
+
+    RCC->CR |= RCC_CR_PLLON;
+    if (!clock_wait(&RCC->CR, RCC_CR_PLLRDY, RCC_CR_PLLRDY)) {
+        RCC->CR &= ~RCC_CR_PLLON;
+        clock_set_flash(HSI_HZ);
+        hal_clock_update();
+        return RTOS_ERR_TIMEOUT;
+    }
+
+    /* Wait states must be in place before HCLK goes up */
+    clock_set_flash(sysclk_hz);
+
+    RCC->CFGR = (RCC->CFGR & ~((0xFUL << RCC_CFGR_HPRE_Pos) |
+                               (0x7UL << RCC_CFGR_PPRE1_Pos) |
+                               (0x7UL << RCC_CFGR_PPRE2_Pos) |
+                               RCC_CFGR_SW_Msk)) |
+                (clock_apb_code(sysclk_hz, APB1_MAX_HZ) << RCC_CFGR_PPRE1_Pos) |
+                (clock_apb_code(sysclk_hz, APB2_MAX_HZ) << RCC_CFGR_PPRE2_Pos) |
+                RCC_CFGR_SW_PLL;
+
+    uint8_t switched = clock_wait(&RCC->CFGR, 0x3UL << RCC_CFGR_SWS_Pos,
+                                  2UL << RCC_CFGR_SWS_Pos);
+    hal_clock_update();
+
+    return switched ? RTOS_OK : RTOS_ERR_TIMEOUT;
+}
@@ -0,0 +1,556 @@
+/**
+ * @file hal_dma.c
+ * @brief DMA HAL Implementation
+ *
+ * Provides stream allocation, transfer configuration (peripheral, memory,
+ * circular and double-buffer), completion signaling through kernel
+ * semaphores, and a memory-to-memory copy offload built on top of them.
+ */
+
+#include "hal.h"
+#include "rtos.h"
+#include "stm32f4xx.h"
+
+/*---------------------------------------------------------------------------*/
+/* Stream Handler Table */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    hal_dma_handler_t handler;
+    void *arg;
+} dma_handler_entry_t;
+
+/* Indexed by controller * 8 + stream */
+static dma_handler_entry_t dma_handlers[16];
+
+/* Claimed streams, same indexing */
+static uint16_t dma_claimed;
+
+/* Bit offset of each stream's flags within LISR/HISR */
+static const uint8_t dma_flag_shift[4] = { 0, 6, 16, 22 };
+
+/* Vector numbers, same indexing */
+static const uint8_t dma_irqn[16] = {
+    DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+    DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn,
+    DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+    DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn,
+};
+
+static uint32_t dma_index(DMA_TypeDef *dma, uint8_t stream) {
+    return ((dma == DMA2) ? 8 : 0) + (stream & 0x7);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Stream Access */
+/*---------------------------------------------------------------------------*/
+
+void hal_dma_enable_clock(DMA_TypeDef *dma) {
+    if (dma == DMA1) {
+        RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+    } else if (dma == DMA2) {
+        RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+    }
+}
+
+DMA_Stream_TypeDef *hal_dma_stream(DMA_TypeDef *dma, uint8_t stream) {
+    return &dma->STREAM[stream & 0x7];
+}
+
+IRQn_Type hal_dma_irqn(DMA_TypeDef *dma, uint8_t stream) {
+    return (IRQn_Type)dma_irqn[dma_index(dma, stream)];
+}
+
+void hal_dma_disable(DMA_TypeDef *dma, uint8_t stream) {
+    DMA_Stream_TypeDef *s = hal_dma_stream(dma, stream);
+
+    s->CR &= ~DMA_SxCR_EN;
+    while (s->CR & DMA_SxCR_EN) {
+        /* Wait for the current beat to finish */
+    }
+    hal_dma_clear_flags(dma, stream, DMA_FLAG_ALL);
+}
+
+rtos_status_t hal_dma_claim(DMA_TypeDef *dma, uint8_t stream) {
+    uint16_t bit = (uint16_t)(1U << dma_index(dma, stream));
+    rtos_status_t result = RTOS_OK;
+
+    uint32_t state = rtos_enter_critical();
+    if (dma_claimed & bit) {
+        result = RTOS_ERR_RESOURCE;
+    } else {
+        dma_claimed |= bit;
+    }
+    rtos_exit_critical(state);
+
+    return result;
+}
+
+void hal_dma_release(DMA_TypeDef *dma, uint8_t stream) {
+    uint32_t state = rtos_enter_critical();
+    dma_claimed &= (uint16_t)~(1U << dma_index(dma, stream));
+    rtos_exit_critical(state);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Interrupt Flags */
+/*---------------------------------------------------------------------------*/
+
+uint32_t hal_dma_read_flags(DMA_TypeDef *dma, uint8_t stream) {
+    uint32_t isr = (stream < 4) ? dma->LISR : dma->HISR;
+    return (isr >> dma_flag_shift[stream & 0x3]) & DMA_FLAG_ALL;
+}
+
+void hal_dma_clear_flags(DMA_TypeDef *dma, uint8_t stream, uint32_t flags) {
+    uint32_t mask = (flags & DMA_FLAG_ALL) << dma_flag_shift[stream & 0x3];
+
+    if (stream < 4) {
+        dma->LIFCR = mask;
+    } else {
+        dma->HIFCR = mask;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Interrupt Dispatch */
+/*---------------------------------------------------------------------------*/
+
+void hal_dma_set_handler(DMA_TypeDef *dma, uint8_t stream,
+                         hal_dma_handler_t handler, void *arg) {
+    dma_handler_entry_t *entry = &dma_handlers[dma_index(dma, stream)];
+
+    uint32_t state = rtos_enter_critical();
+    entry->handler = handler;
+    entry->arg = arg;
+    rtos_exit_critical(state);
+}
+
+static void dma_irq(DMA_TypeDef *dma, uint8_t stream) {
+    uint32_t flags = hal_dma_read_flags(dma, stream);
+    dma_handler_entry_t *entry = &dma_handlers[dma_index(dma, stream)];
+
+    hal_dma_clear_flags(dma, stream, flags);
+
+    if (entry->handler != NULL) {
+        rtos_isr_enter();
+        entry->handler(flags, entry->arg);
+        rtos_isr_exit();
+    }
+}
+
+void DMA1_Stream0_IRQHandler(void) { dma_irq(DMA1, 0); }
+void DMA1_Stream1_IRQHandler(void) { dma_irq(DMA1, 1); }
+void DMA1_Stream2_IRQHandler(void) { dma_irq(DMA1, 2); }
+void DMA1_Stream3_IRQHandler(void) { dma_irq(DMA1, 3); }
+void DMA1_Stream4_IRQHandler(void) { dma_irq(DMA1, 4); }
+void DMA1_Stream5_IRQHandler(void) { dma_irq(DMA1, 5); }
+void DMA1_Stream6_IRQHandler(void) { dma_irq(DMA1, 6); }
+void DMA1_Stream7_IRQHandler(void) { dma_irq(DMA1, 7); }
+void DMA2_Stream0_IRQHandler(void) { dma_irq(DMA2, 0); }
+void DMA2_Stream1_IRQHandler(void) { dma_irq(DMA2, 1); }
+void DMA2_Stream2_IRQHandler(void) { dma_irq(DMA2, 2); }
+void DMA2_Stream3_IRQHandler(void) { dma_irq(DMA2, 3); }
+void DMA2_Stream4_IRQHandler(void) { dma_irq(DMA2, 4); }
+void DMA2_Stream5_IRQHandler(void) { dma_irq(DMA2, 5); }
+void DMA2_Stream6_IRQHandler(void) { dma_irq(DMA2, 6); }
+void DMA2_Stream7_IRQHandler(void) { dma_irq(DMA2, 7); }
+
+/*---------------------------------------------------------------------------*/
+/* Stream Handles */
+/*---------------------------------------------------------------------------*/
+
+static void dma_handle_irq(uint32_t flags, void *arg) {
+    hal_dma_handle_t *h = (hal_dma_handle_t *)arg;
+
+    h->flags = flags;
+
+    if (flags & (DMA_FLAG_TE | DMA_FLAG_DME)) {
+        h->errors++;
+    }
+
+    if (flags & (DMA_FLAG_TC | DMA_FLAG_TE)) {
+        if (!(h->cr & DMA_SxCR_CIRC)) {
+            h->busy = 0;
+        }
+        rtos_sem_post(&h->done);
+    }
+
+    if (h->callback != NULL) {
+        h->callback(flags, h->arg);
+    }
+}
+
+rtos_status_t hal_dma_alloc(hal_dma_handle_t *h, DMA_TypeDef *dma,
+                            uint8_t stream) {
+    if (h == NULL || (dma != DMA1 && dma != DMA2)) {
+        return RTOS_ERR_PARAM;
+    }
+
+    if (stream == HAL_DMA_ANY_STREAM) {
+        /* Search from the top: low streams carry most fixed peripheral maps */
+        int8_t s;
+        for (s = 7; s >= 0; s--) {
+            if (hal_dma_claim(dma, (uint8_t)s) == RTOS_OK) {
+                break;
+            }
+        }
+        if (s < 0) {
+            return RTOS_ERR_RESOURCE;
+        }
+        stream = (uint8_t)s;
+    } else if (stream > 7) {
+        return RTOS_ERR_PARAM;
+    } else if (hal_dma_claim(dma, stream) != RTOS_OK) {
+        return RTOS_ERR_RESOURCE;
+    }
+
+    h->dma = dma;
+    h->stream = stream;
+    h->cr = 0;
+    h->fcr = 0;
+    h->busy = 0;
+    h->flags = 0;
+    h->errors = 0;
+    h->callback = NULL;
+    h->arg = NULL;
+    rtos_sem_init(&h->done, 0);
+
+    hal_dma_enable_clock(dma);
+    hal_dma_disable(dma, stream);
+    hal_dma_set_handler(dma, stream, dma_handle_irq, h);
+
+    IRQn_Type irqn = hal_dma_irqn(dma, stream);
+    NVIC_SetPriority(irqn, RTOS_DMA_IRQ_PRIORITY);
+    NVIC_ClearPendingIRQ(irqn);
+    NVIC_EnableIRQ(irqn);
+
+    return RTOS_OK;
+}
+
+void hal_dma_free(hal_dma_handle_t *h) {
+    if (h == NULL) {
+        return;
+    }
+
+    hal_dma_disable(h->dma, h->stream);
+    NVIC_DisableIRQ(hal_dma_irqn(h->dma, h->stream));
+    hal_dma_set_handler(h->dma, h->stream, NULL, NULL);
+    hal_dma_release(h->dma, h->stream);
+    h->busy = 0;
+}
+
+rtos_status_t hal_dma_configure(hal_dma_handle_t *h, const hal_dma_config_t *cfg) {
+    if (h == NULL || cfg == NULL || cfg->channel > 7 ||
+        cfg->direction > HAL_DMA_MEM_TO_MEM ||
+        cfg->periph_size > HAL_DMA_SIZE_WORD ||
+        cfg->mem_size > HAL_DMA_SIZE_WORD || cfg->priority > 3) {
+        return RTOS_ERR_PARAM;
+    }
+
+    /* Only DMA2 can do memory-to-memory, and never circularly */
+    if (cfg->direction == HAL_DMA_MEM_TO_MEM &&
+        (h->dma != DMA2 || cfg->circular || cfg->double_buffer)) {
+        return RTOS_ERR_PARAM;
+    }
+
+    if (h->busy) {
+        return RTOS_ERR_STATE;
+    }
+
+    uint32_t cr = ((uint32_t)cfg->channel << DMA_SxCR_CHSEL_Pos) |
+                  ((uint32_t)cfg->direction << 6) |
+                  ((uint32_t)cfg->periph_size << DMA_SxCR_PSIZE_Pos) |
+                  ((uint32_t)cfg->mem_size << DMA_SxCR_MSIZE_Pos) |
+                  ((uint32_t)cfg->priority << DMA_SxCR_PL_Pos) |
+                  DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_DMEIE;
+
+    if (cfg->periph_inc) {
+        cr |= DMA_SxCR_PINC;
+    }
+    if (cfg->mem_inc) {
+        cr |= DMA_SxCR_MINC;
+    }
+    if (cfg->circular) {
+        cr |= DMA_SxCR_CIRC;
+    }
+    if (cfg->double_buffer) {
+        cr |= DMA_SxCR_DBM | DMA_SxCR_CIRC;
+    }
+    if (cfg->half_irq) {
+        cr |= DMA_SxCR_HTIE;
+    }
+
+    h->cr = cr;
+
+    /* Direct mode cannot pack or do memory-to-memory: use the FIFO */
+    if (cfg->direction == HAL_DMA_MEM_TO_MEM || cfg->periph_size != cfg->mem_size) {
+        h->fcr = DMA_SxFCR_DMDIS | DMA_SxFCR_FTH_FULL;
+    } else {
+        h->fcr = 0;
+    }
+
+    return RTOS_OK;
+}
+
+void hal_dma_set_callback(hal_dma_handle_t *h, hal_dma_handler_t callback,
+                          void *arg) {
+    uint32_t state = rtos_enter_critical();
+    h->callback = callback;
+    h->arg = arg;
+    rtos_exit_critical(state);
+}
+
+rtos_status_t hal_dma_start(hal_dma_handle_t *h, uint32_t periph_addr,
+                            void *mem0, void *mem1, uint32_t count) {
+    if (h == NULL || mem0 == NULL || count == 0 || count > 0xFFFF) {
+        return RTOS_ERR_PARAM;
+    }
+
+    if ((h->cr & DMA_SxCR_DBM) && mem1 == NULL) {
+        return RTOS_ERR_PARAM;
+    }
+
+    DMA_Stream_TypeDef *s = hal_dma_stream(h->dma, h->stream);
+
+    uint32_t state = rtos_enter_critical();
+
+    if (h->busy) {
+        rtos_exit_critical(state);
+        return RTOS_ERR_STATE;
+    }
+
+    hal_dma_disable(h->dma, h->stream);
+
+    h->busy = 1;
+    h->flags = 0;
+    (void)rtos_sem_try(&h->done);   /* Drop a completion from an earlier run */
+
+    s->PAR = periph_addr;
+    s->M0AR = (uint32_t)mem0;
+    s->M1AR = (uint32_t)mem1;
+    s->NDTR = count;
+    s->FCR = h->fcr;
+    s->CR = h->cr;
+    s->CR = h->cr | DMA_SxCR_EN;
+
+    rtos_exit_critical(state);
+
+    return RTOS_OK;
+}
+
+rtos_status_t hal_dma_wait(hal_dma_handle_t *h, uint32_t timeout_ms) {
+    if (h == NULL) {
+        return RTOS_ERR_PARAM;
+    }
+
+    rtos_status_t result = rtos_sem_wait(&h->done, timeout_ms);
+    if (result != RTOS_OK) {
+        return result;
+    }
+
+    return (h->flags & DMA_FLAG_TE) ? RTOS_ERR_STATE : RTOS_OK;
+}
+
+void hal_dma_stop(hal_dma_handle_t *h) {
+    if (h == NULL) {
+        return;
+    }
+
+    hal_dma_disable(h->dma, h->stream);
+    h->busy = 0;
+}
+
+uint32_t hal_dma_remaining(hal_dma_handle_t *h) {
+    return hal_dma_stream(h->dma, h->stream)->NDTR;
+}
+
+uint8_t hal_dma_current_target(hal_dma_handle_t *h) {
+    return (hal_dma_stream(h->dma, h->stream)->CR & DMA_SxCR_CT) ? 1 : 0;
+}
+
+rtos_status_t hal_dma_set_buffer(hal_dma_handle_t *h, uint8_t target, void *mem) {
+    DMA_Stream_TypeDef *s = hal_dma_stream(h->dma, h->stream);
+
+    if (mem == NULL || !(h->cr & DMA_SxCR_DBM)) {
+        return RTOS_ERR_PARAM;
+    }
+
+    /* The hardware ignores writes to the target in use */
+    if (hal_dma_current_target(h) == target && h->busy) {
+        return RTOS_ERR_STATE;
+    }
+
+    if (target == 0) {
+        s->M0AR = (uint32_t)mem;
+    } else {
+        s->M1AR = (uint32_t)mem;
+    }
+
+    return RTOS_OK;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Memory-to-Memory Copy Offload */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * One DMA2 stream is shared by all tasks. rtos_dma_memcpy_async takes a
+ * mutex that the same task releases in rtos_dma_memcpy_wait, so at most one
+ * copy is in flight. Unaligned heads and tails are copied by the CPU and the
+ * word-aligned middle goes through the DMA FIFO; copies too large for one
+ * NDTR load are continued in chunks from rtos_dma_memcpy_wait.
+ */
+
+#define DMA_MAX_ITEMS       0xFFFFUL
+#define CCM_BASE_ADDR       0x10000000UL
+#define CCM_END_ADDR        0x10010000UL
+
+typedef struct {
+    uint8_t *dst;
+    const uint8_t *src;
+    uint32_t remaining;         /* Bytes still to be started */
+    uint32_t unit;              /* 4 for word transfers, 1 for bytes */
+    uint32_t tail;              /* Bytes to copy by CPU after the DMA part */
+} dma_memcpy_job_t;
+
+static hal_dma_handle_t memcpy_dma;
+static rtos_mutex_t memcpy_lock;
+static dma_memcpy_job_t memcpy_job;
+static uint8_t memcpy_ready;
+
+static uint8_t dma_reachable(const void *p, uint32_t len) {
+    uint32_t addr = (uint32_t)p;
+
+    /* CCM is only connected to the CPU data bus */
+    return (addr + len <= CCM_BASE_ADDR || addr >= CCM_END_ADDR) ? 1 : 0;
+}
+
+static rtos_status_t dma_memcpy_setup(void) {
+    uint32_t state = rtos_enter_critical();
+
+    if (!memcpy_ready) {
+        if (hal_dma_alloc(&memcpy_dma, DMA2, RTOS_DMA_MEMCPY_STREAM) != RTOS_OK) {
+            rtos_exit_critical(state);
+            return RTOS_ERR_RESOURCE;
+        }
+        rtos_mutex_init(&memcpy_lock);
+        memcpy_ready = 1;
+    }
+
+    rtos_exit_critical(state);
+    return RTOS_OK;
+}
+
+static rtos_status_t dma_memcpy_next_chunk(void) {
+    dma_memcpy_job_t *job = &memcpy_job;
+    uint32_t items = job->remaining / job->unit;
+
+    if (items > DMA_MAX_ITEMS) {
+        items = DMA_MAX_ITEMS;
+    }
+
+    uint32_t bytes = items * job->unit;
+    rtos_status_t result = hal_dma_start(&memcpy_dma, (uint32_t)job->src,
+                                         job->dst, NULL, items);
+
+    job->src += bytes;
+    job->dst += bytes;
+    job->remaining -= bytes;
+
+    return result;
+}
+
+rtos_status_t rtos_dma_memcpy_async(void *dst, const void *src, uint32_t len) {
+    if (dst == NULL || src == NULL) {
+        return RTOS_ERR_PARAM;
+    }
+
+    /* Small or DMA-unreachable copies are cheaper on the CPU */
+    if (len < RTOS_DMA_MEMCPY_THRESHOLD ||
+        !dma_reachable(dst, len) || !dma_reachable(src, len) ||
+        dma_memcpy_setup() != RTOS_OK) {
+        rtos_memcpy(dst, src, len);
+        return RTOS_OK;
+    }
+
+    rtos_mutex_lock(&memcpy_lock, RTOS_WAIT_FOREVER);
+
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    uint32_t unit = 1;
+
+    /* Same alignment: copy the head by CPU and move words by DMA */
+    if ((((uint32_t)d ^ (uint32_t)s) & 0x3) == 0) {
+        while (((uint32_t)d & 0x3) != 0) {
+            *d++ = *s++;
+            len--;
+        }
+        unit = 4;
+    }
+
+    hal_dma_config_t cfg = {
+        .channel = 0,
+        .direction = HAL_DMA_MEM_TO_MEM,
+        .periph_size = (unit == 4) ? HAL_DMA_SIZE_WORD : HAL_DMA_SIZE_BYTE,
+        .mem_size = (unit == 4) ? HAL_DMA_SIZE_WORD : HAL_DMA_SIZE_BYTE,
+        .periph_inc = 1,
+        .mem_inc = 1,
+        .priority = 0,
+    };
+    hal_dma_configure(&memcpy_dma, &cfg);
+
+    memcpy_job.dst = d;
+    memcpy_job.src = s;
+    memcpy_job.unit = unit;
+    memcpy_job.tail = len & (unit - 1);
+    memcpy_job.remaining = len - memcpy_job.tail;
+
+    rtos_status_t result = dma_memcpy_next_chunk();
+    if (result != RTOS_OK) {
+        rtos_mutex_unlock(&memcpy_lock);
+    }
+
+    return result;
+}
+
+rtos_status_t rtos_dma_memcpy_wait(uint32_t timeout_ms) {
+    /* Nothing in flight for this task (synchronous fallback was used) */
+    if (!memcpy_ready || memcpy_lock.owner != rtos_task_current()) {
+        return RTOS_OK;
+    }
+
+    rtos_status_t result;
+
+    while (1) {
+        result = hal_dma_wait(&memcpy_dma, timeout_ms);
+        if (result != RTOS_OK || memcpy_job.remaining == 0) {
+            break;
+        }
+        result = dma_memcpy_next_chunk();
+        if (result != RTOS_OK) {
+            break;
+        }
+    }
+
+    if (result == RTOS_ERR_TIMEOUT) {
+        /* Keep ownership: the transfer is still running */
+        return result;
+    }
+
+    /* Tail bytes after the word-aligned part */
+    for (uint32_t i = 0; i < memcpy_job.tail; i++) {
+        memcpy_job.dst[i] = memcpy_job.src[i];
+    }
+    memcpy_job.tail = 0;
+
+    rtos_mutex_unlock(&memcpy_lock);
+    return result;
+}
+
+rtos_status_t rtos_dma_memcpy(void *dst, const void *src, uint32_t len) {
+    rtos_status_t result = rtos_dma_memcpy_async(dst, src, len);
+    if (result != RTOS_OK) {
+        return result;
+    }
+    return rtos_dma_memcpy_wait(RTOS_WAIT_FOREVER);
+}
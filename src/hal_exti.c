@@ -0,0 +1,244 @@
+/**
+ * @file hal_exti.c
+ * @brief EXTI HAL Implementation
+ *
+ * Routes GPIO edges to per-line callbacks or semaphores, with optional
+ * debouncing done by a one-shot soft timer instead of a busy wait.
+ */
+
+#include "hal.h"
+#include "rtos.h"
+#include "stm32f4xx.h"
+
+/*---------------------------------------------------------------------------*/
+/* Line State */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    GPIO_TypeDef *port;         /* NULL when the line is free */
+    uint8_t edge;               /* HAL_EXTI_RISING / FALLING / BOTH */
+    uint8_t level;              /* Last debounced level */
+    uint16_t debounce_ms;       /* 0 = report every edge immediately */
+    hal_exti_cb_t callback;
+    void *arg;
+    rtos_sem_t *sem;
+    rtos_timer_t timer;
+    uint32_t events;            /* Edges reported */
+} exti_line_t;
+
+static exti_line_t exti_lines[16];
+
+static IRQn_Type exti_irqn(uint8_t pin) {
+    if (pin <= 4) {
+        return (IRQn_Type)(EXTI0_IRQn + pin);
+    }
+    return (pin <= 9) ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+}
+
+static uint8_t exti_read(exti_line_t *line, uint8_t pin) {
+    return (line->port->IDR & (1U << pin)) ? 1 : 0;
+}
+
+static void exti_notify(exti_line_t *line, uint8_t pin, uint8_t level) {
+    line->events++;
+
+    if (line->callback != NULL) {
+        line->callback(pin, level, line->arg);
+    }
+    if (line->sem != NULL) {
+        rtos_sem_post(line->sem);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Debounce */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * The first edge masks the line and arms the timer. Bounces during the
+ * window are latched in PR but never interrupt. On expiry the pin is
+ * sampled once: a change from the last stable level that matches the
+ * configured edge is reported, then PR is cleared and the line unmasked.
+ */
+static void exti_debounce_expired(void *arg) {
+    uint8_t pin = (uint8_t)(uint32_t)arg;
+    exti_line_t *line = &exti_lines[pin];
+    uint32_t bit = 1UL << pin;
+
+    if (line->port == NULL) {
+        return;
+    }
+
+    uint8_t level = exti_read(line, pin);
+
+    if (level != line->level) {
+        line->level = level;
+        if ((level && (line->edge & HAL_EXTI_RISING)) ||
+            (!level && (line->edge & HAL_EXTI_FALLING))) {
+            exti_notify(line, pin, level);
+        }
+    }
+
+    EXTI->PR = bit;
+    EXTI->IMR |= bit;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Interrupt Dispatch */
+/*---------------------------------------------------------------------------*/
+
+static void exti_irq(uint8_t pin) {
+    exti_line_t *line = &exti_lines[pin];
+    uint32_t bit = 1UL << pin;
+
+    if (line->debounce_ms != 0) {
+        EXTI->IMR &= ~bit;
+        EXTI->PR = bit;
+        rtos_timer_start_once(&line->timer, line->debounce_ms,
+                              exti_debounce_expired, (void *)(uint32_t)pin);
+        return;
+    }
+
+    EXTI->PR = bit;
+
+    if (line->port != NULL) {
+        uint8_t level = exti_read(line, pin);
+        line->level = level;
+        exti_notify(line, pin, level);
+    }
+}
+
+static void exti_irq_range(uint8_t first, uint8_t last) {
+    uint32_t pending = EXTI->PR & EXTI->IMR;
+
+    for (uint8_t pin = first; pin <= last; pin++) {
+        if (pending & (1UL << pin)) {
+            exti_irq(pin);
+        }
+    }
+}
+
+void EXTI0_IRQHandler(void) { rtos_isr_enter(); exti_irq(0); rtos_isr_exit(); }
+void EXTI1_IRQHandler(void) { rtos_isr_enter(); exti_irq(1); rtos_isr_exit(); }
+void EXTI2_IRQHandler(void) { rtos_isr_enter(); exti_irq(2); rtos_isr_exit(); }
+void EXTI3_IRQHandler(void) { rtos_isr_enter(); exti_irq(3); rtos_isr_exit(); }
+void EXTI4_IRQHandler(void) { rtos_isr_enter(); exti_irq(4); rtos_isr_exit(); }
+void EXTI9_5_IRQHandler(void) { rtos_isr_enter(); exti_irq_range(5, 9); rtos_isr_exit(); }
+void EXTI15_10_IRQHandler(void) { rtos_isr_enter(); exti_irq_range(10, 15); rtos_isr_exit(); }
+
+/*---------------------------------------------------------------------------*/
+/* Configuration */
+/*---------------------------------------------------------------------------*/
+
+rtos_status_t hal_exti_attach(const hal_exti_config_t *config) {
+    if (config == NULL || config->port == NULL || config->pin > 15 ||
+        config->edge == 0 || config->edge > HAL_EXTI_BOTH ||
+        (config->callback == NULL && config->sem == NULL)) {
+        return RTOS_ERR_PARAM;
+    }
+
+    uint8_t pin = config->pin;
+    exti_line_t *line = &exti_lines[pin];
+    uint32_t bit = 1UL << pin;
+    uint32_t port_index = ((uint32_t)config->port - GPIOA_BASE) / 0x400;
+
+    if (line->port != NULL) {
+        return RTOS_ERR_RESOURCE;
+    }
+
+    hal_gpio_enable_clock(config->port);
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+    uint32_t state = rtos_enter_critical();
+
+    line->port = config->port;
+    line->edge = config->edge;
+    line->debounce_ms = config->debounce_ms;
+    line->callback = config->callback;
+    line->arg = config->arg;
+    line->sem = config->sem;
+    line->events = 0;
+    line->level = exti_read(line, pin);
+    rtos_timer_init(&line->timer);
+
+    /* Route the port to this line */
+    uint32_t shift = (pin & 0x3) * 4;
+    SYSCFG->EXTICR[pin >> 2] = (SYSCFG->EXTICR[pin >> 2] & ~(0xFUL << shift)) |
+                               (port_index << shift);
+
+    /* Debounced lines trigger on both edges so releases are tracked too */
+    uint8_t edge = (line->debounce_ms != 0) ? HAL_EXTI_BOTH : line->edge;
+    if (edge & HAL_EXTI_RISING) {
+        EXTI->RTSR |= bit;
+    } else {
+        EXTI->RTSR &= ~bit;
+    }
+    if (edge & HAL_EXTI_FALLING) {
+        EXTI->FTSR |= bit;
+    } else {
+        EXTI->FTSR &= ~bit;
+    }
+
+    EXTI->PR = bit;
+    EXTI->IMR |= bit;
+
+    rtos_exit_critical(state);
+
+    IRQn_Type irqn = exti_irqn(pin);
+    NVIC_SetPriority(irqn, RTOS_EXTI_IRQ_PRIORITY);
+    NVIC_EnableIRQ(irqn);
+
+    return RTOS_OK;
+}
+
+void hal_exti_detach(uint8_t pin) {
+    if (pin > 15) {
+        return;
+    }
+
+    exti_line_t *line = &exti_lines[pin];
+    uint32_t bit = 1UL << pin;
+
+    uint32_t state = rtos_enter_critical();
+
+    EXTI->IMR &= ~bit;
+    EXTI->RTSR &= ~bit;
+    EXTI->FTSR &= ~bit;
+    EXTI->PR = bit;
+    rtos_timer_stop(&line->timer);
+    line->port = NULL;
+
+    rtos_exit_critical(state);
+
+    /* Shared vectors stay enabled while another line in the group is used */
+    uint32_t group = (pin <= 4) ? bit : (pin <= 9) ? 0x03E0UL : 0xFC00UL;
+    if ((EXTI->IMR & group) == 0) {
+        NVIC_DisableIRQ(exti_irqn(pin));
+    }
+}
+
+void hal_exti_enable(uint8_t pin) {
+    if (pin > 15 || exti_lines[pin].port == NULL) {
+        return;
+    }
+
+    uint32_t state = rtos_enter_critical();
+    EXTI->PR = 1UL << pin;
+    EXTI->IMR |= 1UL << pin;
+    rtos_exit_critical(state);
+}
+
+void hal_exti_disable(uint8_t pin) {
+    if (pin > 15) {
+        return;
+    }
+
+    uint32_t state = rtos_enter_critical();
+    EXTI->IMR &= ~(1UL << pin);
+    rtos_timer_stop(&exti_lines[pin].timer);
+    rtos_exit_critical(state);
+}
+
+uint32_t hal_exti_events(uint8_t pin) {
+    return (pin <= 15) ? exti_lines[pin].events : 0;
+}
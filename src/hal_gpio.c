@@ -75,20 +75,44 @@ void hal_gpio_init(const hal_gpio_config_t *config) {
 /* GPIO Output Control */
 /*---------------------------------------------------------------------------*/
 
+/*
+ * All writes go through BSRR so each is a single store that cannot race
+ * with an interrupt changing other pins of the same port. The out-of-line
+ * versions are kept for callers that take their address; hot paths use
+ * the hal_gpio_fast_* inlines from hal.h.
+ */
+
 void hal_gpio_set(GPIO_TypeDef *port, uint8_t pin) {
-    port->BSRR = (1 << pin);  /* Set bit in lower 16 bits = set pin */
+    hal_gpio_fast_set(port, pin);
 }
 
 void hal_gpio_clear(GPIO_TypeDef *port, uint8_t pin) {
-    port->BSRR = (1 << (pin + 16));  /* Set bit in upper 16 bits = reset pin */
+    hal_gpio_fast_clear(port, pin);
 }
 
 void hal_gpio_toggle(GPIO_TypeDef *port, uint8_t pin) {
-    port->ODR ^= (1 << pin);
+    hal_gpio_fast_toggle(port, pin);
 }
 
 uint8_t hal_gpio_read(GPIO_TypeDef *port, uint8_t pin) {
-    return (port->IDR & (1 << pin)) ? 1 : 0;
+    return hal_gpio_fast_read(port, pin);
+}
+
+/*---------------------------------------------------------------------------*/
+/* GPIO Port Access */
+/*---------------------------------------------------------------------------*/
+
+void hal_gpio_write_mask(GPIO_TypeDef *port, uint16_t set_mask, uint16_t clear_mask) {
+    /* BSRR gives set priority when both halves name the same pin */
+    port->BSRR = ((uint32_t)clear_mask << 16) | set_mask;
+}
+
+void hal_gpio_write_port(GPIO_TypeDef *port, uint16_t mask, uint16_t value) {
+    hal_gpio_write_mask(port, value & mask, (uint16_t)(~value & mask));
+}
+
+uint16_t hal_gpio_read_port(GPIO_TypeDef *port) {
+    return (uint16_t)port->IDR;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -96,8 +120,8 @@ uint8_t hal_gpio_read(GPIO_TypeDef *port, uint8_t pin) {
 /*---------------------------------------------------------------------------*/
 
 void hal_system_init(void) {
-    /* Initialize system clocks */
-    /* QEMU starts with 16MHz HSI clock, which is fine for our purposes */
+    /* Initialize system clocks (QEMU has no RCC model and stays on HSI) */
+    hal_clock_init(RTOS_SYSCLK_HZ);
 
     /* Configure UART GPIO pins */
     /* USART2: PA2 (TX), PA3 (RX) */
@@ -152,8 +176,8 @@ void hal_system_init(void) {
 
 void hal_delay_ms(uint32_t ms) {
     /* Simple busy-wait delay */
-    /* Approximate: 4 cycles per loop iteration at 16MHz = 4000 iterations/ms */
-    volatile uint32_t count = ms * 4000;
+    /* Approximate: 4 cycles per loop iteration */
+    volatile uint32_t count = ms * (hal_clock_hclk() / 4000);
     while (count--) {
         __asm volatile ("nop");
     }
@@ -0,0 +1,139 @@
+/**
+ * @file hal_log.c
+ * @brief Deferred Binary Log Implementation
+ *
+ * Producers reserve space in a word ring with LDREX/STREX, fill in the
+ * arguments and commit by writing the frame header last. A single drain
+ * task ships committed frames to the sink and decoding happens on the host.
+ */
+
+#include "hal.h"
+#include "rtos.h"
+#include "stm32f4xx.h"
+
+#if RTOS_ENABLE_LOG
+
+#if (RTOS_LOG_BUFFER_WORDS & (RTOS_LOG_BUFFER_WORDS - 1)) != 0
+#error "RTOS_LOG_BUFFER_WORDS must be a power of 2"
+#endif
+
+#define LOG_MASK            (RTOS_LOG_BUFFER_WORDS - 1)
+#define LOG_FRAME_WORDS     (HAL_LOG_MAX_ARGS + 2)
+
+/*---------------------------------------------------------------------------*/
+/* Log Ring State */
+/*---------------------------------------------------------------------------*/
+
+static uint32_t log_ring[RTOS_LOG_BUFFER_WORDS];
+static volatile uint32_t log_head;      /* Next word to reserve (producers) */
+static volatile uint32_t log_tail;      /* Next word to drain (consumer) */
+static volatile uint32_t log_dropped;   /* Frames lost to a full ring */
+
+static void log_uart_sink(const uint8_t *data, uint32_t len);
+static hal_log_sink_t log_sink = log_uart_sink;
+
+/*---------------------------------------------------------------------------*/
+/* Default Sink */
+/*---------------------------------------------------------------------------*/
+
+static void log_uart_sink(const uint8_t *data, uint32_t len) {
+    /* Raw bytes, no newline translation */
+    for (uint32_t i = 0; i < len; i++) {
+        hal_uart_putc(USART2, (char)data[i]);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Producer Side */
+/*---------------------------------------------------------------------------*/
+
+void hal_log_write(uint32_t fmt_id, const uint32_t *args, uint32_t nargs) {
+    if (nargs > HAL_LOG_MAX_ARGS) {
+        nargs = HAL_LOG_MAX_ARGS;
+    }
+
+    uint32_t words = nargs + 2;
+    uint32_t head;
+
+    /* Reserve space: the only contended step, retried on STREX failure */
+    do {
+        head = __LDREXW(&log_head);
+        if (head + words - log_tail > RTOS_LOG_BUFFER_WORDS) {
+            __CLREX();
+            uint32_t dropped;
+            do {
+                dropped = __LDREXW(&log_dropped);
+            } while (__STREXW(dropped + 1, &log_dropped));
+            return;
+        }
+    } while (__STREXW(head + words, &log_head));
+
+    /* Fill payload, then commit by publishing the header */
+    log_ring[(head + 1) & LOG_MASK] = rtos_now();
+    for (uint32_t i = 0; i < nargs; i++) {
+        log_ring[(head + 2 + i) & LOG_MASK] = args[i];
+    }
+
+    __DMB();
+    log_ring[head & LOG_MASK] = HAL_LOG_FRAME_VALID | (nargs << 24) |
+                                (fmt_id & 0x00FFFFFF);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Consumer Side */
+/*---------------------------------------------------------------------------*/
+
+uint32_t hal_log_drain(void) {
+    uint32_t frame[LOG_FRAME_WORDS];
+    uint32_t drained = 0;
+
+    while (log_tail != log_head) {
+        uint32_t tail = log_tail;
+        uint32_t header = log_ring[tail & LOG_MASK];
+
+        /* Reserved but not yet committed - producer still writing */
+        if (!(header & HAL_LOG_FRAME_VALID)) {
+            break;
+        }
+        __DMB();
+
+        uint32_t words = ((header >> 24) & 0x0F) + 2;
+
+        /* Copy out and clear so stale words never look like a header */
+        for (uint32_t i = 0; i < words; i++) {
+            frame[i] = log_ring[(tail + i) & LOG_MASK];
+            log_ring[(tail + i) & LOG_MASK] = 0;
+        }
+
+        __DMB();
+        log_tail = tail + words;
+
+        log_sink((const uint8_t *)frame, words * sizeof(uint32_t));
+        drained++;
+    }
+
+    return drained;
+}
+
+void hal_log_set_sink(hal_log_sink_t sink) {
+    log_sink = (sink != NULL) ? sink : log_uart_sink;
+}
+
+uint32_t hal_log_dropped(void) {
+    return log_dropped;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Drain Task */
+/*---------------------------------------------------------------------------*/
+
+void hal_log_drain_task(void *arg) {
+    (void)arg;
+
+    while (1) {
+        hal_log_drain();
+        rtos_delay(RTOS_LOG_DRAIN_PERIOD_MS);
+    }
+}
+
+#endif /* RTOS_ENABLE_LOG */
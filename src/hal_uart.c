@@ -2,10 +2,11 @@
  * @file hal_uart.c
  * @brief UART HAL Implementation
  *
- * Provides UART initialization and basic I/O for STM32F4.
+ * Provides UART initialization, polled and interrupt-driven I/O for STM32F4.
  */
 
 #include "hal.h"
+#include "rtos.h"
 #include "stm32f4xx.h"
 #include <stdarg.h>
 
@@ -28,9 +29,9 @@ void hal_uart_init(const hal_uart_config_t *config) {
     }
 
     /* Calculate baud rate divisor */
-    /* For 16MHz clock and 115200 baud: 16000000 / 115200 = 138.89 */
+    /* For 42MHz PCLK1 and 115200 baud: 42000000 / 115200 = 364.58 */
     /* BRR = mantissa << 4 | fraction */
-    uint32_t pclk = RTOS_CPU_CLOCK_HZ;  /* Assume peripheral clock = CPU clock */
+    uint32_t pclk = (uart == USART1) ? hal_clock_pclk2() : hal_clock_pclk1();
     uint32_t div = (pclk + config->baud / 2) / config->baud;
 
     uart->BRR = div;
@@ -102,37 +103,766 @@ uint8_t hal_uart_tx_ready(USART_TypeDef *uart) {
 }
 
 /*---------------------------------------------------------------------------*/
-/* Simple Printf Implementation */
+/* Interrupt-Driven UART */
 /*---------------------------------------------------------------------------*/
 
-static USART_TypeDef *g_printf_uart = USART2;
+/*
+ * Each ring uses free-running indices: the task side owns one index, the
+ * ISR owns the other. Binary semaphores wake tasks when the TX ring
+ * drains from full or the RX ring fills from empty; a mutex per direction
+ * serializes tasks sharing the port.
+ */
+typedef struct {
+    uint8_t *tx_buf;
+    uint32_t tx_mask;
+    volatile uint32_t tx_head;      /* Written by tasks */
+    volatile uint32_t tx_tail;      /* Written by ISR */
+    uint8_t *rx_buf;
+    uint32_t rx_mask;
+    volatile uint32_t rx_head;      /* Written by ISR */
+    volatile uint32_t rx_tail;      /* Written by tasks */
+    rtos_sem_t tx_sem;              /* Posted when TX space frees up */
+    rtos_sem_t rx_sem;              /* Posted when RX data arrives */
+    rtos_mutex_t tx_lock;
+    rtos_mutex_t rx_lock;
+    hal_uart_stats_t stats;
+    uint8_t enabled;
+} uart_port_t;
+
+static uart_port_t uart1_port;
+static uart_port_t uart2_port;
+
+static uint32_t uart_dma_rx_overruns(USART_TypeDef *uart);
+static void uart_dma_rx_idle(USART_TypeDef *uart);
+
+static uart_port_t *uart_port(USART_TypeDef *uart) {
+    if (uart == USART1) {
+        return &uart1_port;
+    } else if (uart == USART2) {
+        return &uart2_port;
+    }
+    return NULL;
+}
+
+static uint8_t is_pow2(uint32_t n) {
+    return (n != 0 && (n & (n - 1)) == 0) ? 1 : 0;
+}
+
+rtos_status_t hal_uart_irq_init(USART_TypeDef *uart,
+                                uint8_t *tx_buf, uint32_t tx_size,
+                                uint8_t *rx_buf, uint32_t rx_size) {
+    uart_port_t *port = uart_port(uart);
+
+    if (port == NULL || tx_buf == NULL || rx_buf == NULL ||
+        !is_pow2(tx_size) || !is_pow2(rx_size)) {
+        return RTOS_ERR_PARAM;
+    }
+
+    IRQn_Type irqn = (uart == USART1) ? USART1_IRQn : USART2_IRQn;
+    NVIC_DisableIRQ(irqn);
+
+    port->tx_buf = tx_buf;
+    port->tx_mask = tx_size - 1;
+    port->tx_head = 0;
+    port->tx_tail = 0;
+    port->rx_buf = rx_buf;
+    port->rx_mask = rx_size - 1;
+    port->rx_head = 0;
+    port->rx_tail = 0;
+    port->stats.rx_overruns = 0;
+    port->stats.hw_overruns = 0;
+    port->stats.framing_errors = 0;
+    rtos_sem_init(&port->tx_sem, 0);
+    rtos_sem_init(&port->rx_sem, 0);
+    rtos_mutex_init(&port->tx_lock);
+    rtos_mutex_init(&port->rx_lock);
+    port->enabled = 1;
+
+    /* Receive continuously; TXE interrupt is enabled only while sending */
+    uart->CR1 |= USART_CR1_RXNEIE;
+
+    NVIC_SetPriority(irqn, RTOS_UART_IRQ_PRIORITY);
+    NVIC_ClearPendingIRQ(irqn);
+    NVIC_EnableIRQ(irqn);
+
+    return RTOS_OK;
+}
+
+/* Convert elapsed ticks into the remaining part of a millisecond timeout */
+static uint32_t remaining_ms(uint32_t start, uint32_t timeout_ms) {
+    if (timeout_ms == RTOS_WAIT_FOREVER) {
+        return RTOS_WAIT_FOREVER;
+    }
+
+    uint32_t elapsed = (rtos_now() - start) * RTOS_TICK_PERIOD_MS;
+    return (elapsed < timeout_ms) ? (timeout_ms - elapsed) : RTOS_NO_WAIT;
+}
+
+uint32_t hal_uart_write(USART_TypeDef *uart, const void *buf, uint32_t len,
+                        uint32_t timeout_ms) {
+    uart_port_t *port = uart_port(uart);
+    const uint8_t *data = (const uint8_t *)buf;
+    uint32_t start = rtos_now();
+    uint32_t written = 0;
+
+    if (port == NULL || !port->enabled || data == NULL) {
+        return 0;
+    }
+
+    if (rtos_mutex_lock(&port->tx_lock, timeout_ms) != RTOS_OK) {
+        return 0;
+    }
+
+    while (written < len) {
+        uint32_t head = port->tx_head;
+        uint32_t space = (port->tx_mask + 1) - (head - port->tx_tail);
+
+        if (space == 0) {
+            /* Ring full: sleep until the ISR frees space */
+            uint32_t wait = remaining_ms(start, timeout_ms);
+            if (wait == RTOS_NO_WAIT ||
+                rtos_sem_wait(&port->tx_sem, wait) != RTOS_OK) {
+                break;
+            }
+            continue;
+        }
+
+        while (space-- > 0 && written < len) {
+            port->tx_buf[head++ & port->tx_mask] = data[written++];
+        }
+        port->tx_head = head;
+
+        /* CR1 is also modified by the ISR */
+        uint32_t state = rtos_enter_critical();
+        uart->CR1 |= USART_CR1_TXEIE;
+        rtos_exit_critical(state);
+    }
+
+    rtos_mutex_unlock(&port->tx_lock);
+    return written;
+}
+
+uint32_t hal_uart_read(USART_TypeDef *uart, void *buf, uint32_t len,
+                       uint32_t timeout_ms) {
+    uart_port_t *port = uart_port(uart);
+    uint8_t *data = (uint8_t *)buf;
+    uint32_t start = rtos_now();
+    uint32_t count = 0;
+
+    if (port == NULL || !port->enabled || data == NULL || len == 0) {
+        return 0;
+    }
+
+    if (rtos_mutex_lock(&port->rx_lock, timeout_ms) != RTOS_OK) {
+        return 0;
+    }
+
+    /* Ring empty: sleep until the ISR delivers data */
+    while (port->rx_head == port->rx_tail) {
+        uint32_t wait = remaining_ms(start, timeout_ms);
+        if (wait == RTOS_NO_WAIT ||
+            rtos_sem_wait(&port->rx_sem, wait) != RTOS_OK) {
+            rtos_mutex_unlock(&port->rx_lock);
+            return 0;
+        }
+    }
+
+    uint32_t tail = port->rx_tail;
+    uint32_t head = port->rx_head;
+    while (tail != head && count < len) {
+        data[count++] = port->rx_buf[tail++ & port->rx_mask];
+    }
+    port->rx_tail = tail;
+
+    rtos_mutex_unlock(&port->rx_lock);
+    return count;
+}
+
+void hal_uart_get_stats(USART_TypeDef *uart, hal_uart_stats_t *stats) {
+    uart_port_t *port = uart_port(uart);
+
+    if (port == NULL || stats == NULL) {
+        return;
+    }
+
+    uint32_t state = rtos_enter_critical();
+    *stats = port->stats;
+    stats->dma_rx_overruns = uart_dma_rx_overruns(uart);
+    rtos_exit_critical(state);
+}
+
+/*---------------------------------------------------------------------------*/
+/* UART Interrupt Handlers */
+/*---------------------------------------------------------------------------*/
+
+static void uart_irq(USART_TypeDef *uart, uart_port_t *port) {
+    uint32_t sr = uart->SR;
+
+    /* Idle line during circular DMA reception */
+    if ((sr & USART_SR_IDLE) && (uart->CR1 & USART_CR1_IDLEIE)) {
+        (void)uart->DR;                 /* SR then DR read clears IDLE */
+        uart_dma_rx_idle(uart);
+    }
+
+    if (!port->enabled) {
+        return;
+    }
+
+    /*
+     * Receive: reading DR also clears ORE/FE/NF. Only while RXNEIE is set;
+     * under DMA reception a byte pending here belongs to the DMA request
+     * and must not be taken by a TXE or IDLE interrupt.
+     */
+    if ((sr & (USART_SR_RXNE | USART_SR_ORE)) && (uart->CR1 & USART_CR1_RXNEIE)) {
+        uint8_t byte = (uint8_t)(uart->DR & 0xFF);
+        uint32_t head = port->rx_head;
+        uint32_t tail = port->rx_tail;
+
+        if (sr & USART_SR_ORE) {
+            port->stats.hw_overruns++;
+        }
+        if (sr & USART_SR_FE) {
+            port->stats.framing_errors++;
+        }
+
+        if (head - tail > port->rx_mask) {
+            port->stats.rx_overruns++;
+        } else {
+            port->rx_buf[head & port->rx_mask] = byte;
+            port->rx_head = head + 1;
+
+            /* Only the empty -> non-empty transition needs a wakeup */
+            if (head == tail) {
+                rtos_sem_post(&port->rx_sem);
+            }
+        }
+    }
+
+    /* Transmit */
+    if ((sr & USART_SR_TXE) && (uart->CR1 & USART_CR1_TXEIE)) {
+        uint32_t tail = port->tx_tail;
+        uint32_t head = port->tx_head;
+
+        if (tail != head) {
+            uart->DR = port->tx_buf[tail & port->tx_mask];
+            port->tx_tail = tail + 1;
+
+            /* Only the full -> not-full transition needs a wakeup */
+            if (head - tail == port->tx_mask + 1) {
+                rtos_sem_post(&port->tx_sem);
+            }
+        } else {
+            uart->CR1 &= ~USART_CR1_TXEIE;
+        }
+    }
+}
+
+void USART1_IRQHandler(void) {
+    rtos_isr_enter();
+    uart_irq(USART1, &uart1_port);
+    rtos_isr_exit();
+}
+
+void USART2_IRQHandler(void) {
+    rtos_isr_enter();
+    uart_irq(USART2, &uart2_port);
+    rtos_isr_exit();
+}
+
+/*---------------------------------------------------------------------------*/
+/* DMA UART Transmit */
+/*---------------------------------------------------------------------------*/
+
+#define UART_DMA_SLOTS          2
+
+typedef struct {
+    const void *buf;
+    uint32_t len;
+    hal_uart_dma_cb_t done;
+    void *arg;
+} uart_dma_req_t;
+
+typedef struct {
+    USART_TypeDef *uart;
+    DMA_TypeDef *dma;
+    uint8_t stream;
+    uint8_t channel;
+    uint8_t active;                 /* Slot currently owned by DMA */
+    volatile uint8_t count;         /* Slots in use (in flight + queued) */
+    uart_dma_req_t req[UART_DMA_SLOTS];
+    rtos_sem_t slot_sem;            /* Posted on every completion */
+    uint32_t errors;
+} uart_dma_tx_t;
+
+/* USART1 TX: DMA2 Stream 7, Channel 4 */
+static uart_dma_tx_t uart1_dma_tx = {
+    .uart = USART1,
+    .dma = DMA2,
+    .stream = 7,
+    .channel = 4,
+};
+
+/* USART2 TX: DMA1 Stream 6, Channel 4 */
+static uart_dma_tx_t uart2_dma_tx = {
+    .uart = USART2,
+    .dma = DMA1,
+    .stream = 6,
+    .channel = 4,
+};
+
+static uart_dma_tx_t *uart_dma_tx(USART_TypeDef *uart) {
+    if (uart == USART1) {
+        return &uart1_dma_tx;
+    }
+    if (uart == USART2) {
+        return &uart2_dma_tx;
+    }
+    return NULL;
+}
+
+static void uart_dma_tx_start(uart_dma_tx_t *tx) {
+    DMA_Stream_TypeDef *s = hal_dma_stream(tx->dma, tx->stream);
+    uart_dma_req_t *req = &tx->req[tx->active];
+
+    s->M0AR = (uint32_t)req->buf;
+    s->NDTR = req->len;
+    /* SR flags are cleared by writing 0: read-modify-write could drop RXNE */
+    tx->uart->SR = ~USART_SR_TC;
+    s->CR |= DMA_SxCR_EN;
+}
+
+static void uart_dma_tx_irq(uint32_t flags, void *arg) {
+    uart_dma_tx_t *tx = (uart_dma_tx_t *)arg;
+
+    if (!(flags & (DMA_FLAG_TC | DMA_FLAG_TE))) {
+        return;
+    }
+
+    if (flags & DMA_FLAG_TE) {
+        tx->errors++;
+    }
+
+    /* Retire the finished slot and start the queued one */
+    uart_dma_req_t done = tx->req[tx->active];
+    tx->active ^= 1;
+    tx->count--;
+
+    if (tx->count > 0) {
+        uart_dma_tx_start(tx);
+    }
+
+    rtos_sem_post(&tx->slot_sem);
+
+    if (done.done != NULL) {
+        done.done(done.buf, done.len, done.arg);
+    }
+}
+
+rtos_status_t hal_uart_dma_tx_init(USART_TypeDef *uart) {
+    uart_dma_tx_t *tx = uart_dma_tx(uart);
+
+    if (tx == NULL) {
+        return RTOS_ERR_PARAM;
+    }
+
+    if (hal_dma_claim(tx->dma, tx->stream) != RTOS_OK) {
+        return RTOS_ERR_RESOURCE;
+    }
+
+    hal_dma_enable_clock(tx->dma);
+    hal_dma_disable(tx->dma, tx->stream);
+
+    tx->active = 0;
+    tx->count = 0;
+    tx->errors = 0;
+    rtos_sem_init(&tx->slot_sem, 0);
+
+    DMA_Stream_TypeDef *s = hal_dma_stream(tx->dma, tx->stream);
+    s->PAR = (uint32_t)&uart->DR;
+    s->FCR = 0;                                     /* Direct mode */
+    s->CR = ((uint32_t)tx->channel << DMA_SxCR_CHSEL_Pos) |
+            DMA_SxCR_DIR_M2P | DMA_SxCR_MINC |
+            DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+    hal_dma_set_handler(tx->dma, tx->stream, uart_dma_tx_irq, tx);
+
+    uart->CR3 |= USART_CR3_DMAT;
+
+    IRQn_Type irqn = hal_dma_irqn(tx->dma, tx->stream);
+    NVIC_SetPriority(irqn, RTOS_UART_IRQ_PRIORITY);
+    NVIC_ClearPendingIRQ(irqn);
+    NVIC_EnableIRQ(irqn);
+
+    return RTOS_OK;
+}
+
+rtos_status_t hal_uart_dma_submit(USART_TypeDef *uart, const void *buf,
+                                  uint32_t len, hal_uart_dma_cb_t done,
+                                  void *arg) {
+    uart_dma_tx_t *tx = uart_dma_tx(uart);
+
+    if (tx == NULL || buf == NULL || len == 0 || len > 0xFFFF) {
+        return RTOS_ERR_PARAM;
+    }
+
+    uint32_t state = rtos_enter_critical();
+
+    if (tx->count == UART_DMA_SLOTS) {
+        rtos_exit_critical(state);
+        return RTOS_ERR_RESOURCE;
+    }
+
+    uart_dma_req_t *req = &tx->req[(tx->active + tx->count) % UART_DMA_SLOTS];
+    req->buf = buf;
+    req->len = len;
+    req->done = done;
+    req->arg = arg;
+    tx->count++;
+
+    /* Idle stream: start now, otherwise the ISR chains it */
+    if (tx->count == 1) {
+        uart_dma_tx_start(tx);
+    }
+
+    rtos_exit_critical(state);
+    return RTOS_OK;
+}
+
+rtos_status_t hal_uart_dma_tx_wait(USART_TypeDef *uart, uint32_t timeout_ms) {
+    uart_dma_tx_t *tx = uart_dma_tx(uart);
+
+    if (tx == NULL) {
+        return RTOS_ERR_PARAM;
+    }
+
+    /* Completions may have posted while slots were still free */
+    while (tx->count == UART_DMA_SLOTS) {
+        rtos_status_t result = rtos_sem_wait(&tx->slot_sem, timeout_ms);
+        if (result != RTOS_OK) {
+            return result;
+        }
+    }
+
+    return RTOS_OK;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Circular DMA UART Receive */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * The stream runs in circular mode forever. Half-transfer, transfer-complete
+ * and USART idle-line events wake the reader, which is handed the new bytes
+ * in place. The write position is reconstructed from the wrap count kept by
+ * the TC interrupt plus NDTR, so overruns can be detected exactly.
+ */
+typedef struct {
+    DMA_TypeDef *dma;
+    uint8_t stream;
+    uint8_t channel;
+    uint8_t enabled;
+    uint8_t *buf;
+    uint32_t size;
+    volatile uint32_t wraps;        /* Completed passes over the buffer */
+    uint32_t read_pos;              /* Bytes handed to the reader (free-running) */
+    uint32_t overruns;              /* Times the reader was lapped */
+    rtos_sem_t event_sem;           /* Posted on HT, TC and IDLE */
+} uart_dma_rx_t;
+
+/* USART1 RX: DMA2 Stream 5, Channel 4 */
+static uart_dma_rx_t uart1_dma_rx = {
+    .dma = DMA2,
+    .stream = 5,
+    .channel = 4,
+};
+
+/* USART2 RX: DMA1 Stream 5, Channel 4 */
+static uart_dma_rx_t uart2_dma_rx = {
+    .dma = DMA1,
+    .stream = 5,
+    .channel = 4,
+};
+
+static uart_dma_rx_t *uart_dma_rx(USART_TypeDef *uart) {
+    if (uart == USART1) {
+        return &uart1_dma_rx;
+    }
+    if (uart == USART2) {
+        return &uart2_dma_rx;
+    }
+    return NULL;
+}
+
+static uint32_t uart_dma_rx_overruns(USART_TypeDef *uart) {
+    uart_dma_rx_t *rx = uart_dma_rx(uart);
+    return (rx != NULL) ? rx->overruns : 0;
+}
+
+static void uart_dma_rx_idle(USART_TypeDef *uart) {
+    uart_dma_rx_t *rx = uart_dma_rx(uart);
+
+    if (rx != NULL && rx->enabled) {
+        rtos_sem_post(&rx->event_sem);
+    }
+}
+
+static void uart_dma_rx_irq(uint32_t flags, void *arg) {
+    uart_dma_rx_t *rx = (uart_dma_rx_t *)arg;
+
+    if (flags & DMA_FLAG_TC) {
+        rx->wraps++;
+    }
+
+    if (flags & (DMA_FLAG_HT | DMA_FLAG_TC)) {
+        rtos_sem_post(&rx->event_sem);
+    }
+}
 
-/* Semihosting for QEMU output */
-static void semihosting_putc(char c) {
-    /* ARM semihosting SYS_WRITEC */
+/* Total bytes written by DMA since start (call with interrupts masked) */
+static uint32_t uart_dma_rx_written(uart_dma_rx_t *rx) {
+    DMA_Stream_TypeDef *s = hal_dma_stream(rx->dma, rx->stream);
+    uint32_t tc;
+    uint32_t ndtr;
+
+    /* A wrap whose TC interrupt is still pending must be counted too */
+    do {
+        tc = hal_dma_read_flags(rx->dma, rx->stream) & DMA_FLAG_TC;
+        ndtr = s->NDTR;
+    } while (tc != (hal_dma_read_flags(rx->dma, rx->stream) & DMA_FLAG_TC));
+
+    return (rx->wraps + (tc ? 1 : 0)) * rx->size + (rx->size - ndtr);
+}
+
+rtos_status_t hal_uart_dma_rx_start(USART_TypeDef *uart, uint8_t *buf,
+                                    uint32_t size) {
+    uart_dma_rx_t *rx = uart_dma_rx(uart);
+
+    if (rx == NULL || buf == NULL || size < 2 || size > 0xFFFF) {
+        return RTOS_ERR_PARAM;
+    }
+
+    /* Restarting a running receiver keeps its claim */
+    if (!rx->enabled && hal_dma_claim(rx->dma, rx->stream) != RTOS_OK) {
+        return RTOS_ERR_RESOURCE;
+    }
+
+    hal_dma_enable_clock(rx->dma);
+    hal_dma_disable(rx->dma, rx->stream);
+
+    rx->buf = buf;
+    rx->size = size;
+    rx->wraps = 0;
+    rx->read_pos = 0;
+    rx->overruns = 0;
+    rtos_sem_init(&rx->event_sem, 0);
+
+    DMA_Stream_TypeDef *s = hal_dma_stream(rx->dma, rx->stream);
+    s->PAR = (uint32_t)&uart->DR;
+    s->M0AR = (uint32_t)buf;
+    s->NDTR = size;
+    s->FCR = 0;                                     /* Direct mode */
+    s->CR = ((uint32_t)rx->channel << DMA_SxCR_CHSEL_Pos) |
+            (2UL << DMA_SxCR_PL_Pos) |              /* High priority */
+            DMA_SxCR_DIR_P2M | DMA_SxCR_MINC | DMA_SxCR_CIRC |
+            DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+    hal_dma_set_handler(rx->dma, rx->stream, uart_dma_rx_irq, rx);
+    rx->enabled = 1;
+
+    /* Bytes now go to DMA, not to the RXNE interrupt */
+    uart->CR1 &= ~USART_CR1_RXNEIE;
+    uart->CR3 |= USART_CR3_DMAR;
+    s->CR |= DMA_SxCR_EN;
+    uart->CR1 |= USART_CR1_IDLEIE;
+
+    IRQn_Type dma_irqn = hal_dma_irqn(rx->dma, rx->stream);
+    IRQn_Type uart_irqn = (uart == USART1) ? USART1_IRQn : USART2_IRQn;
+    NVIC_SetPriority(dma_irqn, RTOS_UART_IRQ_PRIORITY);
+    NVIC_SetPriority(uart_irqn, RTOS_UART_IRQ_PRIORITY);
+    NVIC_EnableIRQ(dma_irqn);
+    NVIC_EnableIRQ(uart_irqn);
+
+    return RTOS_OK;
+}
+
+uint32_t hal_uart_dma_rx_wait(USART_TypeDef *uart, const uint8_t **data,
+                              uint32_t timeout_ms) {
+    uart_dma_rx_t *rx = uart_dma_rx(uart);
+
+    if (rx == NULL || !rx->enabled || data == NULL) {
+        return 0;
+    }
+
+    while (1) {
+        uint32_t state = rtos_enter_critical();
+        uint32_t written = uart_dma_rx_written(rx);
+        rtos_exit_critical(state);
+
+        uint32_t available = written - rx->read_pos;
+
+        if (available > rx->size) {
+            /* Reader was lapped: the old data is gone, restart at the head */
+            rx->overruns++;
+            rx->read_pos = written;
+            available = 0;
+        }
+
+        if (available > 0) {
+            /* Hand out the contiguous part up to the end of the buffer */
+            uint32_t offset = rx->read_pos % rx->size;
+            uint32_t len = rx->size - offset;
+            if (len > available) {
+                len = available;
+            }
+
+            *data = &rx->buf[offset];
+            rx->read_pos += len;
+            return len;
+        }
+
+        if (rtos_sem_wait(&rx->event_sem, timeout_ms) != RTOS_OK) {
+            return 0;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Semihosting */
+/*---------------------------------------------------------------------------*/
+
+#define SEMIHOST_SYS_OPEN       0x01
+#define SEMIHOST_SYS_CLOSE      0x02
+#define SEMIHOST_SYS_WRITE      0x05
+#define SEMIHOST_SYS_READ       0x06
+
+static int32_t semihost_call(uint32_t op, const void *arg) {
+    int32_t result;
     __asm volatile (
-        "mov r0, #0x03\n"   /* SYS_WRITEC */
-        "mov r1, %0\n"
+        "mov r0, %1\n"
+        "mov r1, %2\n"
         "bkpt #0xAB\n"
-        :
-        : "r" (&c)
+        "mov %0, r0\n"
+        : "=r" (result)
+        : "r" (op), "r" (arg)
         : "r0", "r1", "memory"
-      );
+    );
+    return result;
 }
-static void print_char(char c) {
-    semihosting_putc(c);
+
+int32_t hal_semihost_open(const char *path, uint32_t mode) {
+    uint32_t len = 0;
+    while (path[len] != '\0') {
+        len++;
+    }
+
+    uint32_t args[3] = { (uint32_t)path, mode, len };
+    return semihost_call(SEMIHOST_SYS_OPEN, args);
 }
 
-static void print_string(const char *s) {
-    while (*s) {
-        if (*s == '\n') {
-            print_char('\r');
+void hal_semihost_write(int32_t handle, const void *buf, uint32_t len) {
+    if (handle < 0 || len == 0) {
+        return;
+    }
+
+    /* One trap for the whole buffer */
+    uint32_t args[3] = { (uint32_t)handle, (uint32_t)buf, len };
+    semihost_call(SEMIHOST_SYS_WRITE, args);
+}
+
+uint32_t hal_semihost_read(int32_t handle, void *buf, uint32_t len) {
+    if (handle < 0 || len == 0) {
+        return 0;
+    }
+
+    /* SYS_READ returns the number of bytes not read */
+    uint32_t args[3] = { (uint32_t)handle, (uint32_t)buf, len };
+    int32_t left = semihost_call(SEMIHOST_SYS_READ, args);
+
+    if (left < 0 || (uint32_t)left > len) {
+        return 0;
+    }
+    return len - (uint32_t)left;
+}
+
+void hal_semihost_close(int32_t handle) {
+    if (handle < 0) {
+        return;
+    }
+
+    uint32_t args[1] = { (uint32_t)handle };
+    semihost_call(SEMIHOST_SYS_CLOSE, args);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Buffered Console */
+/*---------------------------------------------------------------------------*/
+
+static USART_TypeDef *g_printf_uart = USART2;
+
+/* Host terminal handle, opened on first use (-1 = not open yet) */
+static int32_t g_console_tty = -1;
+
+/* Redirect target from hal_console_set_handle (-1 = the terminal) */
+static int32_t g_console_handle = -1;
+
+void hal_console_set_handle(int32_t handle) {
+    g_console_handle = handle;
+}
+
+void hal_console_write(const char *buf, uint32_t len) {
+    int32_t handle = g_console_handle;
+
+    if (handle < 0) {
+        if (g_console_tty < 0) {
+            /* Tasks printing for the first time must not each open one */
+            uint32_t state = rtos_enter_critical();
+            if (g_console_tty < 0) {
+                g_console_tty = hal_semihost_open(":tt", HAL_SEMIHOST_MODE_W);
+            }
+            rtos_exit_critical(state);
         }
-        print_char(*s++);
+        handle = g_console_tty;
+    }
+    hal_semihost_write(handle, buf, len);
+}
+
+/*
+ * Output is collected in a buffer on the caller's stack and written with a
+ * single SYS_WRITE, so each hal_printf call up to RTOS_CONSOLE_BUFFER_SIZE
+ * reaches the host in one piece without any locking between tasks.
+ * hal_snprintf uses the same formatter on the caller's buffer.
+ */
+typedef struct {
+    char *buf;
+    uint32_t size;
+    uint32_t len;
+    uint8_t console;    /* 1 = flush to the console when full, 0 = truncate */
+} print_buf_t;
+
+static void print_flush(print_buf_t *out) {
+    if (out->len > 0) {
+        hal_console_write(out->buf, out->len);
+        out->len = 0;
+    }
+}
+
+static void print_char(print_buf_t *out, char c) {
+    if (out->len < out->size) {
+        out->buf[out->len++] = c;
+    }
+    if (out->len == out->size && out->console) {
+        print_flush(out);
+    }
+}
+
+static void print_string(print_buf_t *out, const char *s) {
+    while (*s) {
+        print_char(out, *s++);
     }
 }
 
-static void print_uint(uint32_t val, int base, int min_width, char pad) {
+static void print_uint(print_buf_t *out, uint32_t val, int base,
+                       int min_width, char pad) {
     char buf[12];
     int i = 0;
     const char *digits = "0123456789ABCDEF";
@@ -153,23 +883,20 @@ static void print_uint(uint32_t val, int base, int min_width, char pad) {
 
     /* Print in reverse */
     while (i > 0) {
-        print_char(buf[--i]);
+        print_char(out, buf[--i]);
     }
 }
 
-static void print_int(int32_t val, int min_width, char pad) {
+static void print_int(print_buf_t *out, int32_t val, int min_width, char pad) {
     if (val < 0) {
-        print_char('-');
+        print_char(out, '-');
         val = -val;
         if (min_width > 0) min_width--;
     }
-    print_uint((uint32_t)val, 10, min_width, pad);
+    print_uint(out, (uint32_t)val, 10, min_width, pad);
 }
 
-void hal_printf(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-
+static void print_format(print_buf_t *out, const char *fmt, va_list args) {
     while (*fmt) {
         if (*fmt == '%') {
             fmt++;
@@ -192,50 +919,74 @@ void hal_printf(const char *fmt, ...) {
             switch (*fmt) {
                 case 'd':
                 case 'i':
-                    print_int(va_arg(args, int32_t), width, pad);
+                    print_int(out, va_arg(args, int32_t), width, pad);
                     break;
 
                 case 'u':
-                    print_uint(va_arg(args, uint32_t), 10, width, pad);
+                    print_uint(out, va_arg(args, uint32_t), 10, width, pad);
                     break;
 
                 case 'x':
                 case 'X':
-                    print_uint(va_arg(args, uint32_t), 16, width, pad);
+                    print_uint(out, va_arg(args, uint32_t), 16, width, pad);
                     break;
 
                 case 'p':
-                    print_string("0x");
-                    print_uint(va_arg(args, uint32_t), 16, 8, '0');
+                    print_string(out, "0x");
+                    print_uint(out, va_arg(args, uint32_t), 16, 8, '0');
                     break;
 
                 case 's':
-                    print_string(va_arg(args, const char *));
+                    print_string(out, va_arg(args, const char *));
                     break;
 
                 case 'c':
-                    print_char((char)va_arg(args, int));
+                    print_char(out, (char)va_arg(args, int));
                     break;
 
                 case '%':
-                    print_char('%');
+                    print_char(out, '%');
                     break;
 
                 default:
-                    print_char('%');
-                    print_char(*fmt);
+                    print_char(out, '%');
+                    print_char(out, *fmt);
                     break;
             }
         } else {
-            if (*fmt == '\n') {
-                print_char('\r');
-            }
-            print_char(*fmt);
+            print_char(out, *fmt);
         }
         fmt++;
     }
+}
+
+void hal_printf(const char *fmt, ...) {
+    char buf[RTOS_CONSOLE_BUFFER_SIZE];
+    print_buf_t out = { buf, sizeof(buf), 0, 1 };
+    va_list args;
 
+    va_start(args, fmt);
+    print_format(&out, fmt, args);
     va_end(args);
+
+    print_flush(&out);
+}
+
+uint32_t hal_snprintf(char *buf, uint32_t size, const char *fmt, ...) {
+    if (size == 0) {
+        return 0;
+    }
+
+    /* Room for the terminator; output past it is dropped */
+    print_buf_t out = { buf, size - 1, 0, 0 };
+    va_list args;
+
+    va_start(args, fmt);
+    print_format(&out, fmt, args);
+    va_end(args);
+
+    buf[out.len] = '\0';
+    return out.len;
 }
 
 void hal_debug(const char *tag, const char *msg) {
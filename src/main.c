@@ -20,17 +20,61 @@
 
 #define TASK_STACK_SIZE     256     /* Stack size in words */
 
+/*
+ * Sizes from a training run: T3 writes stack_sizes.h (rtos_stack_report)
+ * after STACK_TRAINING_MS. Copy it next to rtos_config.h to use it.
+ */
+#if defined(__has_include)
+#if __has_include("stack_sizes.h")
+#include "stack_sizes.h"
+#endif
+#endif
+
+#ifndef STACK_WORDS_T1
+#define STACK_WORDS_T1      TASK_STACK_SIZE
+#endif
+#ifndef STACK_WORDS_T2
+#define STACK_WORDS_T2      TASK_STACK_SIZE
+#endif
+#ifndef STACK_WORDS_T3
+#define STACK_WORDS_T3      TASK_STACK_SIZE
+#endif
+
+#define STACK_TRAINING_MS   10000
+
+/*
+ * With RTOS_STATIC_SYSTEM the tasks and objects below come initialized
+ * from rtos_system.c, generated from system.cfg; main only starts them.
+ */
+#if RTOS_STATIC_SYSTEM
+#include "rtos_system.h"
+
+void task1_fn(void *arg);
+void task2_fn(void *arg);
+void task3_fn(void *arg);
+void heartbeat_callback(void *arg);
+#else
+
 /* Task 1 - High priority (5ms period) */
-static uint32_t task1_stack[TASK_STACK_SIZE];
-static rtos_tcb_t task1_tcb;
+static RTOS_KERNEL_DATA uint32_t task1_stack[STACK_WORDS_T1];
+static RTOS_KERNEL_DATA rtos_tcb_t task1_tcb;
 
 /* Task 2 - Medium priority (20ms period) */
-static uint32_t task2_stack[TASK_STACK_SIZE];
-static rtos_tcb_t task2_tcb;
+static RTOS_KERNEL_DATA uint32_t task2_stack[STACK_WORDS_T2];
+static RTOS_KERNEL_DATA rtos_tcb_t task2_tcb;
 
 /* Task 3 - Low priority (background logger) */
-static uint32_t task3_stack[TASK_STACK_SIZE];
-static rtos_tcb_t task3_tcb;
+static RTOS_KERNEL_DATA uint32_t task3_stack[STACK_WORDS_T3];
+static RTOS_KERNEL_DATA rtos_tcb_t task3_tcb;
+
+#if RTOS_ENABLE_LOG
+/* Log drain - Lowest priority (ships deferred log frames) */
+#ifndef STACK_WORDS_LOG
+#define STACK_WORDS_LOG     128     /* Stack size in words */
+#endif
+static RTOS_KERNEL_DATA uint32_t log_stack[STACK_WORDS_LOG];
+static RTOS_KERNEL_DATA rtos_tcb_t log_tcb;
+#endif
 
 /*---------------------------------------------------------------------------*/
 /* Synchronization Objects */
@@ -51,6 +95,8 @@ static rtos_queue_t msg_queue;
 
 static rtos_timer_t heartbeat_timer;
 
+#endif /* RTOS_STATIC_SYSTEM */
+
 /*---------------------------------------------------------------------------*/
 /* Statistics */
 /*---------------------------------------------------------------------------*/
@@ -59,22 +105,35 @@ static volatile uint32_t task1_count = 0;
 static volatile uint32_t task2_count = 0;
 static volatile uint32_t task3_count = 0;
 
+/*---------------------------------------------------------------------------*/
+/* Log Sink */
+/*---------------------------------------------------------------------------*/
+
+#if RTOS_ENABLE_LOG
+/* Deferred log frames go to a host file; decode with scripts/log_decode.py */
+static int32_t log_file = -1;
+
+static void log_file_sink(const uint8_t *data, uint32_t len) {
+    hal_semihost_write(log_file, data, len);
+}
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* Timer Callback */
 /*---------------------------------------------------------------------------*/
 
-static void heartbeat_callback(void *arg) {
+void heartbeat_callback(void *arg) {
     (void)arg;
 
     /* Toggle LED */
-    hal_gpio_toggle(GPIOA, 5);
+    hal_gpio_fast_toggle(GPIOA, 5);
 }
 
 /*---------------------------------------------------------------------------*/
 /* Task 1 - High Priority Fast Task (5ms period) */
 /*---------------------------------------------------------------------------*/
 
-static void task1_fn(void *arg) {
+void task1_fn(void *arg) {
     (void)arg;
 
     uint32_t last_wake = rtos_now();
@@ -93,10 +152,10 @@ static void task1_fn(void *arg) {
         msg = tick;
         rtos_queue_send(&msg_queue, &msg, RTOS_NO_WAIT);
 
-        /* Print every 200 iterations (1 second) */
+        /* Log every 200 iterations (1 second) - deferred, no formatting here */
         if (task1_count % 200 == 0) {
-            hal_printf("[T1] tick=%u, runs=%u, jitter=%d\n",
-                       tick, task1_count, jitter);
+            HAL_LOG("[T1] tick=%u, runs=%u, jitter=%d\n",
+                    tick, task1_count, jitter);
         }
 
         /* Wait until next period */
@@ -109,7 +168,7 @@ static void task1_fn(void *arg) {
 /* Task 2 - Medium Priority Slow Task (20ms period) */
 /*---------------------------------------------------------------------------*/
 
-static void task2_fn(void *arg) {
+void task2_fn(void *arg) {
     (void)arg;
 
     uint32_t last_wake = rtos_now();
@@ -142,7 +201,28 @@ static void task2_fn(void *arg) {
 /* Task 3 - Low Priority Background Logger */
 /*---------------------------------------------------------------------------*/
 
-static void task3_fn(void *arg) {
+#if RTOS_ENABLE_STACK_CHECK
+static uint8_t stack_report_done;
+static char stack_report_buf[1024];
+
+static void stack_report_write(void) {
+    /* Formatted first, then one SYS_WRITE: no other task's output lands in it */
+    uint32_t len = rtos_stack_report(stack_report_buf, sizeof(stack_report_buf));
+    int32_t file = hal_semihost_open("stack_sizes.h", HAL_SEMIHOST_MODE_W);
+
+    if (file < 0) {
+        hal_console_write(stack_report_buf, len);
+        return;
+    }
+
+    hal_semihost_write(file, stack_report_buf, len);
+    hal_semihost_close(file);
+
+    hal_printf("[T3] Stack report written to stack_sizes.h\n");
+}
+#endif
+
+void task3_fn(void *arg) {
     (void)arg;
 
     uint32_t msg;
@@ -168,10 +248,21 @@ static void task3_fn(void *arg) {
                        now,
                        rtos_stats_context_switches(),
                        (rtos_stats_idle_ticks() * 100) / now);
+            hal_printf("[STATS] isr=%u/%u (depth 1/2), max_nest=%u, isr_sw=%u\n",
+                       rtos_stats_isr_entries(1), rtos_stats_isr_entries(2),
+                       rtos_stats_isr_max_nesting(), rtos_stats_isr_switches());
 #else
             hal_printf("[T3] tick=%u, msgs_processed=%u\n", now, task3_count);
 #endif
         }
+
+#if RTOS_ENABLE_STACK_CHECK
+        /* End of the training run: record stack sizes once */
+        if (!stack_report_done && now >= STACK_TRAINING_MS) {
+            stack_report_done = 1;
+            stack_report_write();
+        }
+#endif
     }
 }
 
@@ -179,6 +270,27 @@ static void task3_fn(void *arg) {
 /* Priority Inversion Demo */
 /*---------------------------------------------------------------------------*/
 
+/*---------------------------------------------------------------------------*/
+/* Kernel Hooks */
+/*---------------------------------------------------------------------------*/
+
+#if RTOS_ENABLE_BOOT_PROFILE
+void rtos_boot_hook(uint32_t cycles) {
+    if (cycles != 0) {
+        hal_printf("[BOOT] Reset to first task: %u cycles (%u us)\n",
+                   cycles, cycles / (hal_clock_hclk() / 1000000));
+    } else {
+        hal_printf("[BOOT] Reset to first task: no cycle counter\n");
+    }
+}
+#endif
+
+#if RTOS_ENABLE_MPU_GUARD
+void rtos_stack_overflow_hook(rtos_tcb_t *tcb) {
+    hal_printf("[FAULT] Stack overflow in task %s\n", rtos_task_name(tcb));
+}
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* Main Entry Point */
 /*---------------------------------------------------------------------------*/
@@ -192,11 +304,14 @@ int main(void) {
     hal_printf("  Custom RTOS for ARM Cortex-M4\n");
     hal_printf("  Running on QEMU netduinoplus2\n");
     hal_printf("========================================\n");
+    hal_printf("[BOOT] SYSCLK %d Hz, PCLK1 %d Hz, PCLK2 %d Hz\n",
+               hal_clock_sysclk(), hal_clock_pclk1(), hal_clock_pclk2());
     hal_printf("[BOOT] RTOS starting, tick rate: %d Hz\n", RTOS_TICK_RATE_HZ);
 
     /* Initialize RTOS */
     rtos_init();
 
+#if !RTOS_STATIC_SYSTEM
     /* Initialize synchronization objects */
     rtos_mutex_init(&shared_mutex);
     rtos_sem_init(&sync_sem, 0);
@@ -209,19 +324,34 @@ int main(void) {
     /* Create demo tasks */
     hal_printf("[TASK] Creating T1 (prio=1, period=5ms)\n");
     rtos_task_create(task1_fn, "T1", 1,
-                     task1_stack, TASK_STACK_SIZE,
+                     task1_stack, STACK_WORDS_T1,
                      &task1_tcb, NULL);
 
     hal_printf("[TASK] Creating T2 (prio=2, period=20ms)\n");
     rtos_task_create(task2_fn, "T2", 2,
-                     task2_stack, TASK_STACK_SIZE,
+                     task2_stack, STACK_WORDS_T2,
                      &task2_tcb, NULL);
 
     hal_printf("[TASK] Creating T3 (prio=3, background)\n");
     rtos_task_create(task3_fn, "T3", 3,
-                     task3_stack, TASK_STACK_SIZE,
+                     task3_stack, STACK_WORDS_T3,
                      &task3_tcb, NULL);
 
+#if RTOS_ENABLE_LOG
+    hal_printf("[TASK] Creating LOG (prio=%d, drain)\n", RTOS_MAX_PRIORITIES - 1);
+    rtos_task_create(hal_log_drain_task, "LOG", RTOS_MAX_PRIORITIES - 1,
+                     log_stack, STACK_WORDS_LOG,
+                     &log_tcb, NULL);
+#endif
+#endif /* !RTOS_STATIC_SYSTEM */
+
+#if RTOS_ENABLE_LOG
+    log_file = hal_semihost_open("rtos_log.bin", HAL_SEMIHOST_MODE_WB);
+    if (log_file >= 0) {
+        hal_log_set_sink(log_file_sink);
+    }
+#endif
+
     hal_printf("[SCHED] Starting scheduler\n");
     hal_printf("----------------------------------------\n");
 
@@ -9,18 +9,23 @@
 #include "rtos_internal.h"
 #include "stm32f4xx.h"
 #include "hal.h"
-#include <string.h>
 
+/*
+ * A static system (RTOS_STATIC_SYSTEM) defines g_kernel and the idle task
+ * as initialized data in the generated rtos_system.c instead.
+ */
+#if !RTOS_STATIC_SYSTEM
 /*---------------------------------------------------------------------------*/
 /* Global Kernel Instance */
 /*---------------------------------------------------------------------------*/
-rtos_kernel_t g_kernel;
+RTOS_KERNEL_DATA rtos_kernel_t g_kernel;
 
 /*---------------------------------------------------------------------------*/
 /* Idle Task Resources */
 /*---------------------------------------------------------------------------*/
-static rtos_tcb_t idle_tcb;
-static uint32_t idle_stack[RTOS_IDLE_STACK_SIZE];
+static RTOS_KERNEL_DATA rtos_tcb_t idle_tcb;
+static RTOS_KERNEL_DATA uint32_t idle_stack[RTOS_IDLE_STACK_SIZE];
+#endif
 
 /*---------------------------------------------------------------------------*/
 /* List Operations */
@@ -31,11 +36,11 @@ void rtos_list_init(rtos_list_t *list) {
     list->tail = NULL;
 }
 
-uint8_t rtos_list_is_empty(const rtos_list_t *list) {
+RTOS_RAMFUNC uint8_t rtos_list_is_empty(const rtos_list_t *list) {
     return (list->head == NULL) ? 1 : 0;
 }
 
-void rtos_list_add_tail(rtos_list_t *list, rtos_tcb_t *tcb) {
+RTOS_RAMFUNC void rtos_list_add_tail(rtos_list_t *list, rtos_tcb_t *tcb) {
     tcb->next = NULL;
     tcb->prev = list->tail;
 
@@ -47,7 +52,7 @@ void rtos_list_add_tail(rtos_list_t *list, rtos_tcb_t *tcb) {
     list->tail = tcb;
 }
 
-void rtos_list_add_head(rtos_list_t *list, rtos_tcb_t *tcb) {
+RTOS_RAMFUNC void rtos_list_add_head(rtos_list_t *list, rtos_tcb_t *tcb) {
     tcb->prev = NULL;
     tcb->next = list->head;
 
@@ -59,7 +64,7 @@ void rtos_list_add_head(rtos_list_t *list, rtos_tcb_t *tcb) {
     list->head = tcb;
 }
 
-void rtos_list_add_priority(rtos_list_t *list, rtos_tcb_t *tcb) {
+RTOS_RAMFUNC void rtos_list_add_priority(rtos_list_t *list, rtos_tcb_t *tcb) {
     /* Insert in priority order (lower priority value = higher priority) */
     if (list->head == NULL) {
         /* Empty list */
@@ -91,7 +96,7 @@ void rtos_list_add_priority(rtos_list_t *list, rtos_tcb_t *tcb) {
     }
 }
 
-void rtos_list_remove(rtos_list_t *list, rtos_tcb_t *tcb) {
+RTOS_RAMFUNC void rtos_list_remove(rtos_list_t *list, rtos_tcb_t *tcb) {
     if (tcb->prev != NULL) {
         tcb->prev->next = tcb->next;
     } else {
@@ -108,7 +113,7 @@ void rtos_list_remove(rtos_list_t *list, rtos_tcb_t *tcb) {
     tcb->prev = NULL;
 }
 
-rtos_tcb_t *rtos_list_pop_head(rtos_list_t *list) {
+RTOS_RAMFUNC rtos_tcb_t *rtos_list_pop_head(rtos_list_t *list) {
     rtos_tcb_t *tcb = list->head;
 
     if (tcb != NULL) {
@@ -129,7 +134,14 @@ rtos_tcb_t *rtos_list_pop_head(rtos_list_t *list) {
 /* Ready List Operations */
 /*---------------------------------------------------------------------------*/
 
-void rtos_add_ready(rtos_tcb_t *tcb) {
+/*
+ * The running task stays on its ready list, at the head, so the head of
+ * the highest non-empty list is always the task that should run. Wake and
+ * block paths set need_resched when they change that task; PendSV is only
+ * pended when the flag is set.
+ */
+
+RTOS_RAMFUNC void rtos_add_ready(rtos_tcb_t *tcb) {
     uint32_t priority = tcb->priority;
 
     /* Add to the tail of the ready list for this priority */
@@ -139,9 +151,15 @@ void rtos_add_ready(rtos_tcb_t *tcb) {
     g_kernel.priority_bitmap |= (1UL << (31 - priority));
 
     tcb->state = RTOS_TASK_READY;
+
+    /* Preempt the running task only for a strictly higher priority */
+    if (g_kernel.current_task != NULL &&
+        priority < g_kernel.current_task->priority) {
+        g_kernel.need_resched = 1;
+    }
 }
 
-void rtos_remove_ready(rtos_tcb_t *tcb) {
+RTOS_RAMFUNC void rtos_remove_ready(rtos_tcb_t *tcb) {
     uint32_t priority = tcb->priority;
 
     /* Remove from ready list */
@@ -153,7 +171,57 @@ void rtos_remove_ready(rtos_tcb_t *tcb) {
     }
 }
 
-rtos_tcb_t *rtos_get_highest_priority_task(void) {
+RTOS_RAMFUNC void rtos_block_current(rtos_task_state_t state) {
+    rtos_tcb_t *tcb = g_kernel.current_task;
+
+    /* Off the ready list; PendSV picks whoever is now at the front */
+    rtos_remove_ready(tcb);
+    tcb->state = state;
+    g_kernel.need_resched = 1;
+}
+
+RTOS_RAMFUNC void rtos_rotate_current(void) {
+    rtos_tcb_t *tcb = g_kernel.current_task;
+
+    /* Round-robin: only when another task of the same priority is ready */
+    if (tcb != NULL && tcb->state == RTOS_TASK_RUNNING && tcb->next != NULL) {
+        rtos_list_t *list = &g_kernel.ready_list[tcb->priority];
+
+        rtos_list_remove(list, tcb);
+        rtos_list_add_tail(list, tcb);
+        g_kernel.need_resched = 1;
+    }
+}
+
+RTOS_RAMFUNC void rtos_set_priority(rtos_tcb_t *tcb, uint32_t priority) {
+    if (tcb->state == RTOS_TASK_RUNNING) {
+        /* Stays at the front of its new list; yield if that is now too low */
+        rtos_remove_ready(tcb);
+        tcb->priority = priority;
+        rtos_list_add_head(&g_kernel.ready_list[priority], tcb);
+        g_kernel.priority_bitmap |= (1UL << (31 - priority));
+
+        if (__CLZ(g_kernel.priority_bitmap) < priority) {
+            g_kernel.need_resched = 1;
+        }
+    } else if (tcb->state == RTOS_TASK_READY) {
+        rtos_remove_ready(tcb);
+        tcb->priority = priority;
+        rtos_add_ready(tcb);
+    } else {
+        tcb->priority = priority;
+    }
+}
+
+RTOS_RAMFUNC void rtos_reschedule(void) {
+    /* Inside rtos_isr_enter/exit the outermost exit decides, once */
+    if (g_kernel.need_resched && g_kernel.scheduler_running &&
+        !g_kernel.scheduler_locked && g_kernel.isr_nesting == 0) {
+        rtos_trigger_context_switch();
+    }
+}
+
+RTOS_RAMFUNC rtos_tcb_t *rtos_get_highest_priority_task(void) {
     if (g_kernel.priority_bitmap == 0) {
         return NULL;
     }
@@ -169,105 +237,140 @@ rtos_tcb_t *rtos_get_highest_priority_task(void) {
 /* Delay List Operations */
 /*---------------------------------------------------------------------------*/
 
-void rtos_add_to_delay_list(rtos_tcb_t *tcb, uint32_t ticks) {
+/*
+ * The delay list has its own link so a task can wait on a semaphore, mutex
+ * or queue (next/prev) with a timeout at the same time.
+ */
+
+RTOS_RAMFUNC void rtos_add_to_delay_list(rtos_tcb_t *tcb, uint32_t ticks) {
     tcb->wake_tick = g_kernel.tick_count + ticks;
     tcb->state = RTOS_TASK_BLOCKED;
+    tcb->flags |= RTOS_TCB_DELAYED;
 
-    /* Add to delay list sorted by wake_tick */
-    if (g_kernel.delay_list.head == NULL) {
-        tcb->next = NULL;
-        tcb->prev = NULL;
-        g_kernel.delay_list.head = tcb;
-        g_kernel.delay_list.tail = tcb;
-        return;
+    /* Insert sorted by wake_tick, after tasks waking on the same tick */
+    rtos_tcb_t **link = &g_kernel.delay_list;
+    while (*link != NULL && (int32_t)((*link)->wake_tick - tcb->wake_tick) <= 0) {
+        link = &(*link)->delay_next;
     }
 
-    /* Find insertion point */
-    rtos_tcb_t *current = g_kernel.delay_list.head;
-    while (current != NULL && (int32_t)(current->wake_tick - tcb->wake_tick) <= 0) {
-        current = current->next;
+    tcb->delay_next = *link;
+    *link = tcb;
+}
+
+RTOS_RAMFUNC void rtos_remove_from_delay_list(rtos_tcb_t *tcb) {
+    rtos_tcb_t **link = &g_kernel.delay_list;
+
+    while (*link != NULL) {
+        if (*link == tcb) {
+            *link = tcb->delay_next;
+            break;
+        }
+        link = &(*link)->delay_next;
     }
 
-    if (current == NULL) {
-        /* Add at tail */
-        tcb->next = NULL;
-        tcb->prev = g_kernel.delay_list.tail;
-        g_kernel.delay_list.tail->next = tcb;
-        g_kernel.delay_list.tail = tcb;
-    } else if (current == g_kernel.delay_list.head) {
-        /* Add at head */
-        tcb->prev = NULL;
-        tcb->next = current;
-        current->prev = tcb;
-        g_kernel.delay_list.head = tcb;
-    } else {
-        /* Insert before current */
-        tcb->next = current;
-        tcb->prev = current->prev;
-        current->prev->next = tcb;
-        current->prev = tcb;
+    tcb->delay_next = NULL;
+    tcb->flags &= (uint8_t)~RTOS_TCB_DELAYED;
+}
+
+RTOS_RAMFUNC void rtos_check_delayed_tasks(void) {
+    rtos_tcb_t *tcb;
+
+    /* List is sorted, so stop at the first task not yet due */
+    while ((tcb = g_kernel.delay_list) != NULL &&
+           (int32_t)(g_kernel.tick_count - tcb->wake_tick) >= 0) {
+        g_kernel.delay_list = tcb->delay_next;
+        tcb->delay_next = NULL;
+        tcb->flags &= (uint8_t)~RTOS_TCB_DELAYED;
+
+        /* A timed wait: take it off the wait list, the waiter sees the flag */
+        if (tcb->wait_list != NULL) {
+            rtos_list_remove(tcb->wait_list, tcb);
+            tcb->wait_list = NULL;
+            tcb->flags |= RTOS_TCB_TIMEOUT;
+        }
+
+        /* Add back to ready list */
+        rtos_add_ready(tcb);
     }
 }
 
-void rtos_check_delayed_tasks(void) {
-    rtos_tcb_t *tcb = g_kernel.delay_list.head;
+/*---------------------------------------------------------------------------*/
+/* Scheduler */
+/*---------------------------------------------------------------------------*/
 
-    while (tcb != NULL) {
-        /* Check if it's time to wake this task */
-        if ((int32_t)(g_kernel.tick_count - tcb->wake_tick) >= 0) {
-            rtos_tcb_t *next = tcb->next;
+RTOS_RAMFUNC rtos_tcb_t *rtos_schedule(void) {
+    /* This is called from PendSV with interrupts disabled */
+    rtos_tcb_t *current = g_kernel.current_task;
 
-            /* Remove from delay list */
-            rtos_list_remove(&g_kernel.delay_list, tcb);
+    g_kernel.need_resched = 0;
 
-            /* Add back to ready list */
-            rtos_add_ready(tcb);
+    /* Head of the highest ready list; the idle task is always ready */
+    rtos_tcb_t *next = rtos_get_highest_priority_task();
 
-            tcb = next;
-        } else {
-            /* List is sorted, so no more tasks to wake */
-            break;
+    if (next != current) {
+        /* A preempted task keeps its place at the front of its list */
+        if (current->state == RTOS_TASK_RUNNING) {
+            current->state = RTOS_TASK_READY;
         }
+
+#if RTOS_ENABLE_STATS
+        next->run_count++;
+        g_kernel.context_switches++;
+#endif
     }
+
+    /*
+     * Also when next is current: a task woken between blocking and this
+     * PendSV is READY again but keeps the CPU.
+     */
+    next->state = RTOS_TASK_RUNNING;
+
+    /* PendSV switches only if this differs from current_task */
+    return next;
 }
 
 /*---------------------------------------------------------------------------*/
-/* Scheduler */
+/* Interrupt Nesting */
 /*---------------------------------------------------------------------------*/
 
-void rtos_schedule(void) {
-    /* This is called from PendSV with interrupts disabled */
+/*
+ * Kernel calls made between rtos_isr_enter and rtos_isr_exit only update
+ * need_resched; the outermost exit pends PendSV once for all of them,
+ * however many nested handlers woke tasks.
+ */
+
+RTOS_RAMFUNC void rtos_isr_enter(void) {
+    uint32_t state = rtos_enter_critical();
+    uint8_t depth = ++g_kernel.isr_nesting;
 
-    /* Update statistics for current task */
 #if RTOS_ENABLE_STATS
-    if (g_kernel.current_task != NULL) {
-        g_kernel.current_task->total_ticks++;
-    }
-    g_kernel.context_switches++;
-#endif
+    uint32_t level = (depth <= RTOS_ISR_NEST_LEVELS) ? depth - 1U : RTOS_ISR_NEST_LEVELS - 1U;
 
-    /* If current task is still running/ready, put it back in ready list */
-    if (g_kernel.current_task != NULL &&
-        g_kernel.current_task->state == RTOS_TASK_RUNNING) {
-        g_kernel.current_task->state = RTOS_TASK_READY;
-        rtos_add_ready(g_kernel.current_task);
+    g_kernel.isr_entries[level]++;
+    if (depth > g_kernel.isr_max_nesting) {
+        g_kernel.isr_max_nesting = depth;
     }
+#else
+    (void)depth;
+#endif
 
-    /* Get highest priority ready task */
-    rtos_tcb_t *next = rtos_get_highest_priority_task();
+    rtos_exit_critical(state);
+}
 
-    if (next != NULL) {
-        /* Remove from ready list */
-        rtos_remove_ready(next);
-        next->state = RTOS_TASK_RUNNING;
+RTOS_RAMFUNC void rtos_isr_exit(void) {
+    uint32_t state = rtos_enter_critical();
 
+    if (--g_kernel.isr_nesting == 0) {
 #if RTOS_ENABLE_STATS
-        next->run_count++;
+        if (g_kernel.need_resched && g_kernel.scheduler_running &&
+            !g_kernel.scheduler_locked) {
+            g_kernel.isr_switches++;
+        }
 #endif
+        rtos_reschedule();
     }
 
-    /* Switch to next task */
-    g_kernel.current_task = next;
+    rtos_exit_critical(state);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -280,6 +383,12 @@ void rtos_idle_task(void *arg) {
     while (1) {
 #if RTOS_ENABLE_STATS
         g_kernel.idle_ticks++;
+#endif
+#if RTOS_ENABLE_STACK_CHECK && RTOS_STACK_PAINT_DEFERRED
+        rtos_stack_paint_step();
+#endif
+#if RTOS_ENABLE_STACK_CHECK
+        rtos_stack_monitor_step();
 #endif
         /* Low power wait for interrupt */
         __WFI();
@@ -290,26 +399,38 @@ void rtos_idle_task(void *arg) {
 /* Kernel API */
 /*---------------------------------------------------------------------------*/
 
+#if RTOS_ENABLE_BOOT_PROFILE
+/* Default boot hook: applications override it to report the boot time */
+__attribute__((weak)) void rtos_boot_hook(uint32_t cycles) {
+    (void)cycles;
+}
+#endif
+
 void rtos_init(void) {
+#if !RTOS_STATIC_SYSTEM
     /* Initialize kernel state */
-    memset(&g_kernel, 0, sizeof(g_kernel));
+    rtos_memset(&g_kernel, 0, sizeof(g_kernel));
 
     /* Initialize all ready lists */
     for (int i = 0; i < RTOS_MAX_PRIORITIES; i++) {
         rtos_list_init(&g_kernel.ready_list[i]);
     }
+#endif
 
-    /* Initialize delay list */
-    rtos_list_init(&g_kernel.delay_list);
+#if RTOS_ENABLE_STACK_CHECK
+    rtos_stack_monitor_init();
+#endif
 
     /* Initialize port (SysTick, PendSV priorities) */
     rtos_port_init();
 
+#if !RTOS_STATIC_SYSTEM
     /* Create idle task at lowest priority */
     rtos_task_create(rtos_idle_task, "Idle",
                      RTOS_MAX_PRIORITIES - 1,
                      idle_stack, RTOS_IDLE_STACK_SIZE,
                      &idle_tcb, NULL);
+#endif
 }
 
 void rtos_start(void) {
@@ -321,8 +442,7 @@ void rtos_start(void) {
         while (1);
     }
 
-    /* Remove from ready list */
-    rtos_remove_ready(g_kernel.current_task);
+    /* The running task stays at the head of its ready list */
     g_kernel.current_task->state = RTOS_TASK_RUNNING;
 
     /* Mark scheduler as running */
@@ -332,6 +452,10 @@ void rtos_start(void) {
     g_kernel.current_task->run_count++;
 #endif
 
+#if RTOS_ENABLE_BOOT_PROFILE
+    rtos_boot_hook(DWT->CYCCNT);
+#endif
+
     /* Start first task */
     rtos_port_start_first_task();
 
@@ -363,4 +487,23 @@ uint32_t rtos_stats_idle_ticks(void) {
 uint32_t rtos_stats_task_runs(rtos_tcb_t *tcb) {
     return tcb->run_count;
 }
+
+uint32_t rtos_stats_task_ticks(rtos_tcb_t *tcb) {
+    return tcb->total_ticks;
+}
+
+uint32_t rtos_stats_isr_entries(uint32_t depth) {
+    if (depth == 0 || depth > RTOS_ISR_NEST_LEVELS) {
+        return 0;
+    }
+    return g_kernel.isr_entries[depth - 1];
+}
+
+uint32_t rtos_stats_isr_switches(void) {
+    return g_kernel.isr_switches;
+}
+
+uint8_t rtos_stats_isr_max_nesting(void) {
+    return g_kernel.isr_max_nesting;
+}
 #endif
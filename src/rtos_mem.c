@@ -0,0 +1,140 @@
+/**
+ * @file rtos_mem.c
+ * @brief Kernel Memory Copy and Fill
+ *
+ * Replaces newlib's generic memcpy/memset on the kernel paths. Word-aligned
+ * bulk moves use 32-byte LDM/STM bursts; misaligned heads and tails are
+ * done bytewise, and a source that stays misaligned against the
+ * destination is read with unaligned LDRs (handled in hardware on the M4).
+ */
+
+#include "rtos.h"
+#include "rtos_internal.h"
+
+/*---------------------------------------------------------------------------*/
+/* Helpers */
+/*---------------------------------------------------------------------------*/
+
+/* Unaligned word load; compiles to a plain LDR on the Cortex-M4 */
+typedef struct {
+    uint32_t v;
+} __attribute__((packed, may_alias)) mem_unaligned_t;
+
+/* Keep GCC from turning the byte loops back into memcpy/memset calls */
+#define MEM_NO_LIBCALL  __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+/*---------------------------------------------------------------------------*/
+/* Copy */
+/*---------------------------------------------------------------------------*/
+
+RTOS_RAMFUNC MEM_NO_LIBCALL
+void *rtos_memcpy(void *dst, const void *src, uint32_t len) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    if (len >= 8) {
+        /* Head: bring the destination to a word boundary */
+        while ((uintptr_t)d & 3) {
+            *d++ = *s++;
+            len--;
+        }
+
+        if (((uintptr_t)s & 3) == 0) {
+#if defined(__thumb2__)
+            uint32_t bursts = len >> 5;
+
+            if (bursts != 0) {
+                __asm volatile (
+                    "1:                                   \n"
+                    "    ldmia %1!, {r3-r6, r8-r10, r12}  \n"
+                    "    stmia %0!, {r3-r6, r8-r10, r12}  \n"
+                    "    subs  %2, %2, #1                 \n"
+                    "    bne   1b                         \n"
+                    : "+r" (d), "+r" (s), "+r" (bursts)
+                    :
+                    : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12",
+                      "cc", "memory"
+                );
+                len &= 31;
+            }
+#endif
+            while (len >= 4) {
+                *(rtos_word_t *)d = *(const rtos_word_t *)s;
+                d += 4;
+                s += 4;
+                len -= 4;
+            }
+        } else {
+            while (len >= 4) {
+                *(rtos_word_t *)d = ((const mem_unaligned_t *)s)->v;
+                d += 4;
+                s += 4;
+                len -= 4;
+            }
+        }
+    }
+
+    /* Tail (and short copies) */
+    while (len != 0) {
+        *d++ = *s++;
+        len--;
+    }
+
+    return dst;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Fill */
+/*---------------------------------------------------------------------------*/
+
+RTOS_RAMFUNC MEM_NO_LIBCALL
+void *rtos_memset(void *dst, uint8_t value, uint32_t len) {
+    uint8_t *d = (uint8_t *)dst;
+
+    if (len >= 8) {
+        uint32_t word = value * 0x01010101UL;
+
+        while ((uintptr_t)d & 3) {
+            *d++ = value;
+            len--;
+        }
+
+#if defined(__thumb2__)
+        uint32_t bursts = len >> 5;
+
+        if (bursts != 0) {
+            __asm volatile (
+                "    mov   r3, %2                     \n"
+                "    mov   r4, %2                     \n"
+                "    mov   r5, %2                     \n"
+                "    mov   r6, %2                     \n"
+                "    mov   r8, %2                     \n"
+                "    mov   r9, %2                     \n"
+                "    mov   r10, %2                    \n"
+                "    mov   r12, %2                    \n"
+                "1:                                   \n"
+                "    stmia %0!, {r3-r6, r8-r10, r12}  \n"
+                "    subs  %1, %1, #1                 \n"
+                "    bne   1b                         \n"
+                : "+r" (d), "+r" (bursts)
+                : "r" (word)
+                : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12",
+                  "cc", "memory"
+            );
+            len &= 31;
+        }
+#endif
+        while (len >= 4) {
+            *(rtos_word_t *)d = word;
+            d += 4;
+            len -= 4;
+        }
+    }
+
+    while (len != 0) {
+        *d++ = value;
+        len--;
+    }
+
+    return dst;
+}
@@ -19,13 +19,21 @@ extern rtos_kernel_t g_kernel;
 /*---------------------------------------------------------------------------*/
 /* Port Configuration */
 /*---------------------------------------------------------------------------*/
-void rtos_task_exit(void);
 
 /* Priority configuration for PendSV and SysTick */
 /* PendSV must be lowest priority to allow other interrupts to preempt */
 #define PENDSV_PRIORITY     0xFF    /* Lowest priority (255) */
 #define SYSTICK_PRIORITY    0xFF    /* Same low priority */
 
+#if RTOS_ENABLE_MPU_GUARD
+/* PendSV needs the guard field and the RBAR address as immediates */
+#define PENDSV_GUARD_OPERANDS \
+    , [rbar_off] "I" (offsetof(rtos_tcb_t, mpu_rbar)), \
+      [mpu_rbar] "i" (MPU_BASE + offsetof(MPU_Type, RBAR))
+#else
+#define PENDSV_GUARD_OPERANDS
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* Port Initialization */
 /*---------------------------------------------------------------------------*/
@@ -36,13 +44,120 @@ void rtos_port_init(void) {
     /* Set SysTick to lowest priority */
     SCB->SHP[SCB_SHP_SYSTICK_IDX] = SYSTICK_PRIORITY;
 
-    /* Configure SysTick for 1kHz tick rate */
-    SysTick->LOAD = RTOS_SYSTICK_RELOAD;
+    /* Configure SysTick for the tick rate from the actual core clock */
+    SysTick->LOAD = (hal_clock_hclk() / RTOS_TICK_RATE_HZ) - 1;
     SysTick->VAL = 0;
     SysTick->CTRL = SYSTICK_CTRL_CLKSOURCE_Msk |    /* Use processor clock */
                     SYSTICK_CTRL_TICKINT_Msk |       /* Enable interrupt */
                     SYSTICK_CTRL_ENABLE_Msk;         /* Enable SysTick */
+
+#if RTOS_ENABLE_MPU_GUARD
+    /*
+     * Only the guard region is defined; everything else uses the default
+     * memory map, since all code runs privileged. It stays enabled with the
+     * same size and attributes; PendSV moves it to each task as it is
+     * switched in.
+     */
+    MPU->CTRL = 0;
+    MPU->RNR = RTOS_MPU_GUARD_REGION;
+    MPU->RBAR = (uint32_t)rtos_port_spare_guard | MPU_RBAR_VALID | RTOS_MPU_GUARD_REGION;
+    MPU->RASR = MPU_GUARD_RASR;
+    MPU->CTRL = MPU_CTRL_PRIVDEFENA | MPU_CTRL_ENABLE;
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA;
+    __DSB();
+    __ISB();
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/* MPU Stack Guard */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * The guard is the first RTOS_MPU_GUARD_SIZE-aligned block inside the
+ * stack. Any access to it - a push past the bottom, a large local array,
+ * exception stacking - raises MemManage before memory below the stack is
+ * touched. Stacks too small to hold an aligned guard run unguarded: their
+ * guard sits on a spare block nothing uses, so a switch only writes RBAR.
+ */
+#if RTOS_ENABLE_MPU_GUARD
+uint32_t rtos_port_spare_guard[RTOS_MPU_GUARD_SIZE / sizeof(uint32_t)]
+    __attribute__((aligned(RTOS_MPU_GUARD_SIZE)));
+#endif
+
+void rtos_port_stack_guard_init(rtos_tcb_t *tcb) {
+#if RTOS_ENABLE_MPU_GUARD
+    uint32_t base = ((uint32_t)tcb->stack_base + RTOS_MPU_GUARD_SIZE - 1) &
+                    ~(RTOS_MPU_GUARD_SIZE - 1UL);
+    uint32_t top = (uint32_t)(tcb->stack_base + tcb->stack_size);
+
+    /* Keep at least the guard size above the guard for the task itself */
+    if (base + 2 * RTOS_MPU_GUARD_SIZE > top) {
+        base = (uint32_t)rtos_port_spare_guard;
+    }
+    tcb->mpu_rbar = base | MPU_RBAR_VALID | RTOS_MPU_GUARD_REGION;
+#else
+    (void)tcb;
+#endif
+}
+
+/* Words from the stack base to the end of the guard (0 if unguarded) */
+uint32_t rtos_port_stack_guard_words(const rtos_tcb_t *tcb) {
+#if RTOS_ENABLE_MPU_GUARD
+    uint32_t guard = tcb->mpu_rbar & ~0x1FUL;
+
+    if (guard == (uint32_t)rtos_port_spare_guard) {
+        return 0;
+    }
+    uint32_t end = guard + RTOS_MPU_GUARD_SIZE;
+    return (end - (uint32_t)tcb->stack_base) / sizeof(uint32_t);
+#else
+    (void)tcb;
+    return 0;
+#endif
+}
+
+#if RTOS_ENABLE_MPU_GUARD
+/* Default overflow hook: nothing to add, MemManage_Handler halts after it */
+__attribute__((weak)) void rtos_stack_overflow_hook(rtos_tcb_t *tcb) {
+    (void)tcb;
+}
+
+/*
+ * Only the running task's stack is guarded, and handlers run on MSP, so a
+ * guard hit (or a stacking fault on PSP) always belongs to current_task.
+ * The guard stopped the access, but the task cannot continue: PendSV would
+ * have to save its context into the guard, so the system halts here.
+ */
+void MemManage_Handler(void) {
+    uint32_t cfsr = SCB->CFSR & SCB_CFSR_MMFSR_Msk;
+    uint32_t addr = SCB->MMFAR;
+    rtos_tcb_t *tcb = g_kernel.current_task;
+
+    __disable_irq();
+
+    uint8_t overflow = 0;
+    if (tcb != NULL && rtos_port_stack_guard_words(tcb) != 0) {
+        uint32_t guard = tcb->mpu_rbar & ~0x1FUL;
+
+        if (cfsr & (SCB_CFSR_MSTKERR | SCB_CFSR_MUNSTKERR)) {
+            overflow = 1;
+        } else if ((cfsr & SCB_CFSR_MMARVALID) &&
+                   addr >= guard && addr < guard + RTOS_MPU_GUARD_SIZE) {
+            overflow = 1;
+        }
+    }
+
+    if (overflow) {
+        rtos_stack_overflow_hook(tcb);
+    }
+
+    /* Leave CFSR/MMFAR intact for the debugger */
+    while (1) {
+        __asm volatile ("nop");
+    }
 }
+#endif
 
 /*---------------------------------------------------------------------------*/
 /* Stack Initialization */
@@ -94,7 +209,7 @@ void rtos_task_exit(void) {
 /*---------------------------------------------------------------------------*/
 /* Trigger Context Switch */
 /*---------------------------------------------------------------------------*/
-void rtos_trigger_context_switch(void) {
+RTOS_RAMFUNC void rtos_trigger_context_switch(void) {
     /* Set PendSV pending bit to trigger context switch */
     SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
     __DSB();
@@ -108,6 +223,13 @@ void rtos_port_start_first_task(void) {
     /* Get the first task's stack pointer */
     uint32_t *sp = g_kernel.current_task->stack_ptr;
 
+#if RTOS_ENABLE_MPU_GUARD
+    /* PendSV takes over from the first switch on */
+    MPU->RBAR = g_kernel.current_task->mpu_rbar;
+    __DSB();
+    __ISB();
+#endif
+
     __asm volatile (
         /* Set PSP to first task's stack pointer */
         "msr psp, %0                \n"
@@ -154,35 +276,39 @@ void rtos_port_start_first_task(void) {
 /*---------------------------------------------------------------------------*/
 /* PendSV Handler - Context Switch */
 /*---------------------------------------------------------------------------*/
-__attribute__((naked))
+__attribute__((naked)) RTOS_RAMFUNC
 void PendSV_Handler(void) {
     __asm volatile (
         /* Disable interrupts */
         "cpsid i                    \n"
 
-        /* Get current PSP */
-        "mrs r0, psp                \n"
-
-        /* Save R4-R11 to current task's stack */
-        "stmdb r0!, {r4-r11}        \n"
-
-        /* Get address of current_task */
+        /* Pick the next task first; R4-R11 are callee-saved across the call */
         "ldr r1, =g_kernel          \n"
-
-        /* Save current stack pointer to current task's TCB */
-        /* g_kernel.current_task is at offset 4*RTOS_MAX_PRIORITIES + 4 */
-        /* But current_task pointer is after ready_list array */
-        /* Actually, we need to load current_task pointer first */
-        "ldr r2, [r1, %[curr_off]]  \n"  /* r2 = g_kernel.current_task */
-        "str r0, [r2, #0]           \n"  /* tcb->stack_ptr = r0 */
-
-        /* Call scheduler to select next task */
         "push {r1, lr}              \n"
-        "bl rtos_schedule           \n"
+        "bl rtos_schedule           \n"  /* r0 = next task */
         "pop {r1, lr}               \n"
 
-        /* Load new current_task */
-        "ldr r2, [r1, %[curr_off]]  \n"  /* r2 = g_kernel.current_task (updated) */
+        /* Fast path: same task, nothing to save or restore */
+        "ldr r2, [r1, %[curr_off]]  \n"  /* r2 = g_kernel.current_task */
+        "cmp r0, r2                 \n"
+        "beq 1f                     \n"
+
+        /* Save R4-R11 to current task's stack */
+        "mrs r3, psp                \n"
+        "stmdb r3!, {r4-r11}        \n"
+        "str r3, [r2, #0]           \n"  /* tcb->stack_ptr = r3 */
+
+        /* Switch current_task */
+        "str r0, [r1, %[curr_off]]  \n"
+        "mov r2, r0                 \n"  /* r2 = new current_task */
+
+#if RTOS_ENABLE_MPU_GUARD
+        /* Move the stack guard to the new task (RBAR selects the region) */
+        "ldr r0, [r2, %[rbar_off]]  \n"
+        "ldr r3, =%c[mpu_rbar]      \n"
+        "str r0, [r3, #0]           \n"  /* MPU->RBAR */
+        "dsb                        \n"
+#endif
 
         /* Get new task's stack pointer */
         "ldr r0, [r2, #0]           \n"  /* r0 = tcb->stack_ptr */
@@ -193,15 +319,17 @@ void PendSV_Handler(void) {
         /* Set PSP to new task's stack */
         "msr psp, r0                \n"
 
-        /* Enable interrupts */
-        "cpsie i                    \n"
-
         /* Return to new task using PSP */
         "ldr lr, =0xFFFFFFFD        \n"  /* EXC_RETURN: Thread mode, PSP */
+
+        "1:                         \n"
+        /* Enable interrupts */
+        "cpsie i                    \n"
         "bx lr                      \n"
 
         :
         : [curr_off] "I" (offsetof(rtos_kernel_t, current_task))
+          PENDSV_GUARD_OPERANDS
         : "memory"
     );
 }
@@ -209,42 +337,47 @@ void PendSV_Handler(void) {
 /*---------------------------------------------------------------------------*/
 /* SysTick Handler - System Tick */
 /*---------------------------------------------------------------------------*/
-void SysTick_Handler(void) {
+RTOS_RAMFUNC void SysTick_Handler(void) {
+    rtos_isr_enter();
+
     uint32_t state = rtos_enter_critical();
 
     /* Increment tick counter */
     g_kernel.tick_count++;
 
+#if RTOS_ENABLE_STATS
+    if (g_kernel.current_task != NULL) {
+        g_kernel.current_task->total_ticks++;
+    }
+#endif
+
     /* Process timers */
     rtos_timer_tick();
 
-    /* Wake up delayed tasks */
+    /* Wake up delayed tasks (sets need_resched on a preempting wake) */
     rtos_check_delayed_tasks();
 
-    /* Check if we need to switch tasks */
+    /* Time slice among equal priorities */
     if (g_kernel.scheduler_running && !g_kernel.scheduler_locked) {
-        /* Get highest priority ready task */
-        rtos_tcb_t *next = rtos_get_highest_priority_task();
-
-        if (next != g_kernel.current_task) {
-            /* Trigger context switch */
-            rtos_trigger_context_switch();
-        }
+        rtos_rotate_current();
     }
 
     rtos_exit_critical(state);
+
+    /* Switch only if needed, once for the whole tick */
+    rtos_isr_exit();
 }
 
 /*---------------------------------------------------------------------------*/
 /* Critical Section Implementation */
 /*---------------------------------------------------------------------------*/
-uint32_t rtos_enter_critical(void) {
+RTOS_RAMFUNC uint32_t rtos_enter_critical(void) {
     uint32_t primask = __get_PRIMASK();
     __disable_irq();
     return primask;
 }
 
-void rtos_exit_critical(uint32_t state) {
+RTOS_RAMFUNC void rtos_exit_critical(uint32_t state) {
     __set_PRIMASK(state);
 }
 
@@ -257,6 +390,59 @@ void rtos_critical_exit(uint32_t state) {
     rtos_exit_critical(state);
 }
 
+/*---------------------------------------------------------------------------*/
+/* Interrupt Registration */
+/*---------------------------------------------------------------------------*/
+
+#if RTOS_ENABLE_RAM_VECTORS
+extern rtos_irq_handler_t ram_vector_table[VECTOR_COUNT];   /* startup.c */
+#endif
+
+rtos_status_t rtos_irq_register(int32_t irqn, rtos_irq_handler_t handler,
+                                uint8_t priority) {
+#if RTOS_ENABLE_RAM_VECTORS
+    if (irqn < 0 || irqn >= NVIC_IRQ_COUNT || handler == NULL ||
+        priority >= (1U << __NVIC_PRIO_BITS)) {
+        return RTOS_ERR_PARAM;
+    }
+
+    /* Single word store: the vector is never seen half-written */
+    uint32_t state = rtos_enter_critical();
+    ram_vector_table[16 + irqn] = handler;
+    NVIC_SetPriority((IRQn_Type)irqn, priority);
+    __DSB();
+    rtos_exit_critical(state);
+
+    return RTOS_OK;
+#else
+    (void)irqn;
+    (void)handler;
+    (void)priority;
+    return RTOS_ERR_STATE;
+#endif
+}
+
+void rtos_irq_enable(int32_t irqn) {
+    if (irqn >= 0 && irqn < NVIC_IRQ_COUNT) {
+        NVIC_ClearPendingIRQ((IRQn_Type)irqn);
+        NVIC_EnableIRQ((IRQn_Type)irqn);
+    }
+}
+
+void rtos_irq_disable(int32_t irqn) {
+    if (irqn >= 0 && irqn < NVIC_IRQ_COUNT) {
+        NVIC_DisableIRQ((IRQn_Type)irqn);
+        __DSB();
+        __ISB();
+    }
+}
+
+void rtos_irq_set_priority(int32_t irqn, uint8_t priority) {
+    if (irqn >= 0 && irqn < NVIC_IRQ_COUNT) {
+        NVIC_SetPriority((IRQn_Type)irqn, priority);
+    }
+}
+
 /*---------------------------------------------------------------------------*/
 /* ISR Detection */
 /*---------------------------------------------------------------------------*/
@@ -8,7 +8,6 @@
 #include "rtos.h"
 #include "rtos_internal.h"
 #include "stm32f4xx.h"
-#include <string.h>
 
 /*---------------------------------------------------------------------------*/
 /* External References */
@@ -18,41 +17,58 @@ extern rtos_kernel_t g_kernel;
 /*---------------------------------------------------------------------------*/
 /* Helper: Block Current Task on Wait List */
 /*---------------------------------------------------------------------------*/
-static rtos_status_t block_on_wait_list(rtos_list_t *wait_list, void *wait_obj,
-                                         uint32_t timeout_ms) {
+static rtos_status_t block_on_wait_list(rtos_list_t *wait_list, uint32_t timeout_ms) {
     rtos_tcb_t *current = g_kernel.current_task;
 
-    /* Add to wait list (priority sorted for fair scheduling) */
+    /* Off the ready list, onto the wait list (priority sorted for fair scheduling) */
+    rtos_block_current(RTOS_TASK_BLOCKED);
     rtos_list_add_priority(wait_list, current);
 
-    current->state = RTOS_TASK_BLOCKED;
-    current->wait_object = wait_obj;
+    current->wait_list = wait_list;
+    current->flags &= (uint8_t)~RTOS_TCB_TIMEOUT;
 
     if (timeout_ms != RTOS_WAIT_FOREVER) {
         /* Add to delay list for timeout */
         uint32_t ticks = (timeout_ms * RTOS_TICK_RATE_HZ) / 1000;
         if (ticks == 0) ticks = 1;
-        current->wake_tick = g_kernel.tick_count + ticks;
-    } else {
-        current->wake_tick = 0;  /* No timeout */
+        rtos_add_to_delay_list(current, ticks);
     }
 
     return RTOS_OK;
 }
 
+/*---------------------------------------------------------------------------*/
+/* Helper: Check Whether the Wait Timed Out */
+/*---------------------------------------------------------------------------*/
+RTOS_RAMFUNC static rtos_status_t wait_result(void) {
+    rtos_tcb_t *current = g_kernel.current_task;
+    uint32_t state = rtos_enter_critical();
+    rtos_status_t result = RTOS_OK;
+
+    /* The tick (or a suspend) already took us off the wait list */
+    if (current->flags & RTOS_TCB_TIMEOUT) {
+        current->flags &= (uint8_t)~RTOS_TCB_TIMEOUT;
+        result = RTOS_ERR_TIMEOUT;
+    }
+
+    rtos_exit_critical(state);
+
+    return result;
+}
+
 /*---------------------------------------------------------------------------*/
 /* Helper: Wake Task from Wait List */
 /*---------------------------------------------------------------------------*/
-static rtos_tcb_t *wake_highest_priority_waiter(rtos_list_t *wait_list) {
+RTOS_RAMFUNC static rtos_tcb_t *wake_highest_priority_waiter(rtos_list_t *wait_list) {
     rtos_tcb_t *tcb = rtos_list_pop_head(wait_list);
 
     if (tcb != NULL) {
-        /* Remove from delay list if it was there */
-        if (tcb->wake_tick != 0) {
-            rtos_list_remove(&g_kernel.delay_list, tcb);
+        /* Cancel the timeout if it had one */
+        if (tcb->flags & RTOS_TCB_DELAYED) {
+            rtos_remove_from_delay_list(tcb);
         }
 
-        tcb->wait_object = NULL;
+        tcb->wait_list = NULL;
         rtos_add_ready(tcb);
     }
 
@@ -74,7 +90,7 @@ rtos_status_t rtos_sem_init(rtos_sem_t *sem, uint32_t initial) {
     return RTOS_OK;
 }
 
-rtos_status_t rtos_sem_wait(rtos_sem_t *sem, uint32_t timeout_ms) {
+RTOS_RAMFUNC rtos_status_t rtos_sem_wait(rtos_sem_t *sem, uint32_t timeout_ms) {
     if (sem == NULL) {
         return RTOS_ERR_PARAM;
     }
@@ -95,31 +111,18 @@ rtos_status_t rtos_sem_wait(rtos_sem_t *sem, uint32_t timeout_ms) {
     }
 
     /* Block current task */
-    block_on_wait_list(&sem->wait_list, sem, timeout_ms);
+    block_on_wait_list(&sem->wait_list, timeout_ms);
 
     rtos_exit_critical(state);
 
     /* Trigger context switch */
-    rtos_trigger_context_switch();
+    rtos_reschedule();
 
     /* When we wake up, check if we got the semaphore or timed out */
-    state = rtos_enter_critical();
-
-    rtos_status_t result = RTOS_OK;
-
-    /* If we're still on the wait list, we timed out */
-    if (g_kernel.current_task->wait_object == sem) {
-        rtos_list_remove(&sem->wait_list, g_kernel.current_task);
-        g_kernel.current_task->wait_object = NULL;
-        result = RTOS_ERR_TIMEOUT;
-    }
-
-    rtos_exit_critical(state);
-
-    return result;
+    return wait_result();
 }
 
-rtos_status_t rtos_sem_post(rtos_sem_t *sem) {
+RTOS_RAMFUNC rtos_status_t rtos_sem_post(rtos_sem_t *sem) {
     if (sem == NULL) {
         return RTOS_ERR_PARAM;
     }
@@ -129,15 +132,12 @@ rtos_status_t rtos_sem_post(rtos_sem_t *sem) {
     /* Check if any task is waiting */
     if (!rtos_list_is_empty(&sem->wait_list)) {
         /* Wake highest priority waiter */
-        rtos_tcb_t *woken = wake_highest_priority_waiter(&sem->wait_list);
+        wake_highest_priority_waiter(&sem->wait_list);
 
         rtos_exit_critical(state);
 
         /* If woken task has higher priority, yield */
-        if (woken != NULL && g_kernel.scheduler_running &&
-            woken->priority < g_kernel.current_task->priority) {
-            rtos_trigger_context_switch();
-        }
+        rtos_reschedule();
     } else {
         /* No waiters, increment count */
         if (sem->count < 1) {  /* Binary semaphore max is 1 */
@@ -207,42 +207,20 @@ rtos_status_t rtos_mutex_lock(rtos_mutex_t *mtx, uint32_t timeout_ms) {
     if (current->priority < mtx->owner->priority) {
         /* Current task has higher priority (lower number) */
         /* Boost owner's priority */
-        rtos_tcb_t *owner = mtx->owner;
-
-        /* Remove owner from ready list at old priority */
-        if (owner->state == RTOS_TASK_READY) {
-            rtos_remove_ready(owner);
-            owner->priority = current->priority;
-            rtos_add_ready(owner);
-        } else {
-            owner->priority = current->priority;
-        }
+        rtos_set_priority(mtx->owner, current->priority);
     }
 #endif
 
     /* Block current task */
-    block_on_wait_list(&mtx->wait_list, mtx, timeout_ms);
+    block_on_wait_list(&mtx->wait_list, timeout_ms);
 
     rtos_exit_critical(state);
 
     /* Trigger context switch */
-    rtos_trigger_context_switch();
+    rtos_reschedule();
 
     /* When we wake up, check result */
-    state = rtos_enter_critical();
-
-    rtos_status_t result = RTOS_OK;
-
-    if (g_kernel.current_task->wait_object == mtx) {
-        /* Still on wait list = timed out */
-        rtos_list_remove(&mtx->wait_list, g_kernel.current_task);
-        g_kernel.current_task->wait_object = NULL;
-        result = RTOS_ERR_TIMEOUT;
-    }
-
-    rtos_exit_critical(state);
-
-    return result;
+    return wait_result();
 }
 
 rtos_status_t rtos_mutex_unlock(rtos_mutex_t *mtx) {
@@ -270,14 +248,7 @@ rtos_status_t rtos_mutex_unlock(rtos_mutex_t *mtx) {
 #if RTOS_ENABLE_PRIORITY_INHERITANCE
     /* Restore original priority */
     if (current->priority != mtx->original_priority) {
-        /* Remove from ready list at boosted priority */
-        if (current->state == RTOS_TASK_READY) {
-            rtos_remove_ready(current);
-            current->priority = mtx->original_priority;
-            rtos_add_ready(current);
-        } else {
-            current->priority = mtx->original_priority;
-        }
+        rtos_set_priority(current, mtx->original_priority);
     }
 #endif
 
@@ -286,35 +257,19 @@ rtos_status_t rtos_mutex_unlock(rtos_mutex_t *mtx) {
 
     /* Wake highest priority waiter if any */
     if (!rtos_list_is_empty(&mtx->wait_list)) {
-        rtos_tcb_t *woken = rtos_list_pop_head(&mtx->wait_list);
-
-        if (woken != NULL) {
-            /* Remove from delay list if necessary */
-            if (woken->wake_tick != 0) {
-                rtos_list_remove(&g_kernel.delay_list, woken);
-            }
+        rtos_tcb_t *woken = wake_highest_priority_waiter(&mtx->wait_list);
 
-            /* Transfer ownership to woken task */
-            mtx->owner = woken;
-            mtx->original_priority = woken->base_priority;
-            mtx->lock_count = 1;
-
-            woken->wait_object = NULL;
-            rtos_add_ready(woken);
-
-            rtos_exit_critical(state);
-
-            /* Yield if woken task has higher priority */
-            if (g_kernel.scheduler_running &&
-                woken->priority < current->priority) {
-                rtos_trigger_context_switch();
-            }
-
-            return RTOS_OK;
-        }
+        /* Transfer ownership to woken task */
+        mtx->owner = woken;
+        mtx->original_priority = woken->base_priority;
+        mtx->lock_count = 1;
     }
 
     rtos_exit_critical(state);
+
+    /* Yield if woken task has higher priority (or ours was restored) */
+    rtos_reschedule();
+
     return RTOS_OK;
 }
 
@@ -326,6 +281,11 @@ rtos_status_t rtos_mutex_try(rtos_mutex_t *mtx) {
 /* Message Queue */
 /*---------------------------------------------------------------------------*/
 
+/* Next ring index: a compare instead of a UDIV by the runtime capacity */
+static inline uint32_t queue_next(const rtos_queue_t *q, uint32_t index) {
+    return (index + 1 == q->capacity) ? 0 : index + 1;
+}
+
 rtos_status_t rtos_queue_init(rtos_queue_t *q, void *buffer,
                                uint32_t msg_size, uint32_t capacity) {
     if (q == NULL || buffer == NULL || msg_size == 0 || capacity == 0) {
@@ -344,7 +304,7 @@ rtos_status_t rtos_queue_init(rtos_queue_t *q, void *buffer,
     return RTOS_OK;
 }
 
-rtos_status_t rtos_queue_send(rtos_queue_t *q, const void *msg, uint32_t timeout_ms) {
+RTOS_RAMFUNC rtos_status_t rtos_queue_send(rtos_queue_t *q, const void *msg, uint32_t timeout_ms) {
     if (q == NULL || msg == NULL) {
         return RTOS_ERR_PARAM;
     }
@@ -354,20 +314,17 @@ rtos_status_t rtos_queue_send(rtos_queue_t *q, const void *msg, uint32_t timeout
     /* Check if queue has space */
     if (q->count < q->capacity) {
         /* Copy message to queue */
-        memcpy(&q->buffer[q->head * q->msg_size], msg, q->msg_size);
-        q->head = (q->head + 1) % q->capacity;
+        rtos_memcpy_msg(&q->buffer[q->head * q->msg_size], msg, q->msg_size);
+        q->head = queue_next(q, q->head);
         q->count++;
 
         /* Wake a waiting receiver if any */
         if (!rtos_list_is_empty(&q->recv_wait)) {
-            rtos_tcb_t *woken = wake_highest_priority_waiter(&q->recv_wait);
+            wake_highest_priority_waiter(&q->recv_wait);
 
             rtos_exit_critical(state);
 
-            if (woken != NULL && g_kernel.scheduler_running &&
-                woken->priority < g_kernel.current_task->priority) {
-                rtos_trigger_context_switch();
-            }
+            rtos_reschedule();
 
             return RTOS_OK;
         }
@@ -383,25 +340,22 @@ rtos_status_t rtos_queue_send(rtos_queue_t *q, const void *msg, uint32_t timeout
     }
 
     /* Block on send wait list */
-    block_on_wait_list(&q->send_wait, q, timeout_ms);
+    block_on_wait_list(&q->send_wait, timeout_ms);
 
     rtos_exit_critical(state);
-    rtos_trigger_context_switch();
+    rtos_reschedule();
 
     /* Check if we can send now or timed out */
-    state = rtos_enter_critical();
-
-    if (g_kernel.current_task->wait_object == q) {
-        rtos_list_remove(&q->send_wait, g_kernel.current_task);
-        g_kernel.current_task->wait_object = NULL;
-        rtos_exit_critical(state);
+    if (wait_result() != RTOS_OK) {
         return RTOS_ERR_TIMEOUT;
     }
 
+    state = rtos_enter_critical();
+
     /* Try to send again */
     if (q->count < q->capacity) {
-        memcpy(&q->buffer[q->head * q->msg_size], msg, q->msg_size);
-        q->head = (q->head + 1) % q->capacity;
+        rtos_memcpy_msg(&q->buffer[q->head * q->msg_size], msg, q->msg_size);
+        q->head = queue_next(q, q->head);
         q->count++;
         rtos_exit_critical(state);
         return RTOS_OK;
@@ -411,7 +365,7 @@ rtos_status_t rtos_queue_send(rtos_queue_t *q, const void *msg, uint32_t timeout
     return RTOS_ERR_RESOURCE;
 }
 
-rtos_status_t rtos_queue_recv(rtos_queue_t *q, void *msg, uint32_t timeout_ms) {
+RTOS_RAMFUNC rtos_status_t rtos_queue_recv(rtos_queue_t *q, void *msg, uint32_t timeout_ms) {
     if (q == NULL || msg == NULL) {
         return RTOS_ERR_PARAM;
     }
@@ -421,20 +375,17 @@ rtos_status_t rtos_queue_recv(rtos_queue_t *q, void *msg, uint32_t timeout_ms) {
     /* Check if queue has messages */
     if (q->count > 0) {
         /* Copy message from queue */
-        memcpy(msg, &q->buffer[q->tail * q->msg_size], q->msg_size);
-        q->tail = (q->tail + 1) % q->capacity;
+        rtos_memcpy_msg(msg, &q->buffer[q->tail * q->msg_size], q->msg_size);
+        q->tail = queue_next(q, q->tail);
         q->count--;
 
         /* Wake a waiting sender if any */
         if (!rtos_list_is_empty(&q->send_wait)) {
-            rtos_tcb_t *woken = wake_highest_priority_waiter(&q->send_wait);
+            wake_highest_priority_waiter(&q->send_wait);
 
             rtos_exit_critical(state);
 
-            if (woken != NULL && g_kernel.scheduler_running &&
-                woken->priority < g_kernel.current_task->priority) {
-                rtos_trigger_context_switch();
-            }
+            rtos_reschedule();
 
             return RTOS_OK;
         }
@@ -450,25 +401,22 @@ rtos_status_t rtos_queue_recv(rtos_queue_t *q, void *msg, uint32_t timeout_ms) {
     }
 
     /* Block on receive wait list */
-    block_on_wait_list(&q->recv_wait, q, timeout_ms);
+    block_on_wait_list(&q->recv_wait, timeout_ms);
 
     rtos_exit_critical(state);
-    rtos_trigger_context_switch();
+    rtos_reschedule();
 
     /* Check if we can receive now or timed out */
-    state = rtos_enter_critical();
-
-    if (g_kernel.current_task->wait_object == q) {
-        rtos_list_remove(&q->recv_wait, g_kernel.current_task);
-        g_kernel.current_task->wait_object = NULL;
-        rtos_exit_critical(state);
+    if (wait_result() != RTOS_OK) {
         return RTOS_ERR_TIMEOUT;
     }
 
+    state = rtos_enter_critical();
+
     /* Try to receive again */
     if (q->count > 0) {
-        memcpy(msg, &q->buffer[q->tail * q->msg_size], q->msg_size);
-        q->tail = (q->tail + 1) % q->capacity;
+        rtos_memcpy_msg(msg, &q->buffer[q->tail * q->msg_size], q->msg_size);
+        q->tail = queue_next(q, q->tail);
         q->count--;
         rtos_exit_critical(state);
         return RTOS_OK;
@@ -8,6 +8,7 @@
 #include "rtos.h"
 #include "rtos_internal.h"
 #include "stm32f4xx.h"
+#include "hal.h"
 #include <string.h>
 
 /*---------------------------------------------------------------------------*/
@@ -16,9 +17,36 @@
 extern rtos_kernel_t g_kernel;
 
 /*---------------------------------------------------------------------------*/
-/* Stack Marker for Overflow Detection */
+/* Stack Painting */
 /*---------------------------------------------------------------------------*/
-#define STACK_MARKER    0xDEADBEEF
+
+#if RTOS_ENABLE_STACK_CHECK
+/* Fill [dst, end) with the marker, four words per STM */
+static void stack_paint(uint32_t *dst, uint32_t *end) {
+#if defined(__thumb2__)
+    uint32_t *burst_end = dst + ((uint32_t)(end - dst) & ~3UL);
+
+    if (dst < burst_end) {
+        __asm volatile (
+            "    mov   r4, %2           \n"
+            "    mov   r5, %2           \n"
+            "    mov   r6, %2           \n"
+            "    mov   r8, %2           \n"
+            "1:                         \n"
+            "    stmia %0!, {r4-r6, r8} \n"
+            "    cmp   %0, %1           \n"
+            "    bne   1b               \n"
+            : "+r" (dst)
+            : "r" (burst_end), "r" (STACK_MARKER)
+            : "r4", "r5", "r6", "r8", "cc", "memory"
+        );
+    }
+#endif
+    while (dst < end) {
+        *dst++ = STACK_MARKER;
+    }
+}
+#endif
 
 /*---------------------------------------------------------------------------*/
 /* Task Creation */
@@ -37,15 +65,19 @@ rtos_status_t rtos_task_create(rtos_task_fn_t fn, const char *name,
         return RTOS_ERR_PARAM;
     }
 
-    if (stack_size < 32) {
+    if (stack_size < RTOS_MIN_STACK_WORDS || stack_size > UINT16_MAX) {
         return RTOS_ERR_PARAM;
     }
 
-    uint32_t state = rtos_enter_critical();
+    /*
+     * Nothing else can see the TCB or the stack until the task is on the
+     * ready list, so all setup runs with interrupts enabled.
+     */
 
     /* Initialize TCB */
-    memset(tcb, 0, sizeof(rtos_tcb_t));
+    rtos_memset(tcb, 0, sizeof(rtos_tcb_t));
 
+#if RTOS_ENABLE_TASK_NAMES
     /* Copy task name */
     if (name != NULL) {
         strncpy(tcb->name, name, sizeof(tcb->name) - 1);
@@ -53,6 +85,9 @@ rtos_status_t rtos_task_create(rtos_task_fn_t fn, const char *name,
     } else {
         strcpy(tcb->name, "unnamed");
     }
+#else
+    (void)name;
+#endif
 
     /* Set priorities */
     tcb->priority = priority;
@@ -60,13 +95,22 @@ rtos_status_t rtos_task_create(rtos_task_fn_t fn, const char *name,
 
     /* Set stack information */
     tcb->stack_base = stack;
-    tcb->stack_size = stack_size;
+    tcb->stack_size = (uint16_t)stack_size;
+    rtos_port_stack_guard_init(tcb);
+#if RTOS_ENABLE_STACK_CHECK
+    tcb->stack_hwm = (uint16_t)stack_size;
+#endif
 
 #if RTOS_ENABLE_STACK_CHECK
+#if RTOS_STACK_PAINT_DEFERRED
+    /* Guard words now so overflow checks work; the idle task does the rest */
+    uint32_t guard_words = rtos_port_stack_guard_words(tcb) + RTOS_STACK_GUARD_WORDS;
+    stack_paint(stack, stack + guard_words);
+    tcb->stack_painted = (uint16_t)guard_words;
+#else
     /* Fill stack with marker pattern for overflow detection */
-    for (uint32_t i = 0; i < stack_size; i++) {
-        stack[i] = STACK_MARKER;
-    }
+    stack_paint(stack, stack + stack_size);
+#endif
 #endif
 
     /* Initialize stack (stack grows downward) */
@@ -76,15 +120,32 @@ rtos_status_t rtos_task_create(rtos_task_fn_t fn, const char *name,
     /* Set initial state */
     tcb->state = RTOS_TASK_READY;
 
+    uint32_t state = rtos_enter_critical();
+
+    /* Append to the task list (creation order) */
+    rtos_tcb_t **link = &g_kernel.task_list;
+    while (*link != NULL) {
+        link = &(*link)->task_next;
+    }
+    *link = tcb;
+
+#if RTOS_ENABLE_STACK_CHECK && RTOS_STACK_PAINT_DEFERRED
+    /* Queue the stack for the idle painter, oldest first */
+    link = &g_kernel.paint_list;
+    while (*link != NULL) {
+        link = &(*link)->paint_next;
+    }
+    tcb->paint_next = NULL;
+    *link = tcb;
+#endif
+
     /* Add to ready list */
     rtos_add_ready(tcb);
 
     rtos_exit_critical(state);
 
-    /* If scheduler is running and new task has higher priority, yield */
-    if (g_kernel.scheduler_running && priority < g_kernel.current_task->priority) {
-        rtos_yield();
-    }
+    /* Switch if the new task has higher priority */
+    rtos_reschedule();
 
     return RTOS_OK;
 }
@@ -98,11 +159,14 @@ void rtos_yield(void) {
         return;
     }
 
-    /* Mark current task as ready (will be put back in ready list by scheduler) */
-    g_kernel.current_task->state = RTOS_TASK_READY;
+    uint32_t state = rtos_enter_critical();
+
+    /* Move behind the other tasks of this priority, if there are any */
+    rtos_rotate_current();
 
-    /* Trigger context switch */
-    rtos_trigger_context_switch();
+    rtos_exit_critical(state);
+
+    rtos_reschedule();
 }
 
 /*---------------------------------------------------------------------------*/
@@ -122,19 +186,14 @@ void rtos_delay(uint32_t ms) {
 
     uint32_t state = rtos_enter_critical();
 
-    /* Remove from ready list if needed */
-    if (g_kernel.current_task->state == RTOS_TASK_RUNNING) {
-        /* Task will be added to delay list, not ready list */
-        g_kernel.current_task->state = RTOS_TASK_BLOCKED;
-    }
-
-    /* Add to delay list */
+    /* Move from the ready list to the delay list */
+    rtos_block_current(RTOS_TASK_BLOCKED);
     rtos_add_to_delay_list(g_kernel.current_task, ticks);
 
     rtos_exit_critical(state);
 
     /* Trigger context switch */
-    rtos_trigger_context_switch();
+    rtos_reschedule();
 }
 
 void rtos_delay_until(uint32_t wake_tick) {
@@ -148,21 +207,14 @@ void rtos_delay_until(uint32_t wake_tick) {
     int32_t ticks = (int32_t)(wake_tick - g_kernel.tick_count);
 
     if (ticks > 0) {
-        /* Remove from ready list if needed */
-        if (g_kernel.current_task->state == RTOS_TASK_RUNNING) {
-            g_kernel.current_task->state = RTOS_TASK_BLOCKED;
-        }
-
-        /* Set absolute wake tick */
-        g_kernel.current_task->wake_tick = wake_tick;
-
-        /* Add to delay list */
-        rtos_add_to_delay_list(g_kernel.current_task, ticks);
+        /* Move from the ready list to the delay list */
+        rtos_block_current(RTOS_TASK_BLOCKED);
+        rtos_add_to_delay_list(g_kernel.current_task, (uint32_t)ticks);
 
         rtos_exit_critical(state);
 
         /* Trigger context switch */
-        rtos_trigger_context_switch();
+        rtos_reschedule();
     } else {
         /* Already past wake time */
         rtos_exit_critical(state);
@@ -193,13 +245,20 @@ rtos_status_t rtos_task_suspend(rtos_tcb_t *tcb) {
     }
 
     /* Remove from ready list if it's there */
-    if (tcb->state == RTOS_TASK_READY) {
+    if (tcb->state == RTOS_TASK_RUNNING) {
+        rtos_block_current(RTOS_TASK_SUSPENDED);
+    } else if (tcb->state == RTOS_TASK_READY) {
         rtos_remove_ready(tcb);
     }
 
-    /* Remove from delay list if blocked on delay */
-    if (tcb->state == RTOS_TASK_BLOCKED && tcb->wait_object == NULL) {
-        rtos_list_remove(&g_kernel.delay_list, tcb);
+    /* Remove from delay list and wait list; a wait ends as a timeout */
+    if (tcb->flags & RTOS_TCB_DELAYED) {
+        rtos_remove_from_delay_list(tcb);
+    }
+    if (tcb->wait_list != NULL) {
+        rtos_list_remove(tcb->wait_list, tcb);
+        tcb->wait_list = NULL;
+        tcb->flags |= RTOS_TCB_TIMEOUT;
     }
 
     tcb->state = RTOS_TASK_SUSPENDED;
@@ -207,9 +266,7 @@ rtos_status_t rtos_task_suspend(rtos_tcb_t *tcb) {
     rtos_exit_critical(state);
 
     /* If we suspended ourselves, yield */
-    if (tcb == g_kernel.current_task) {
-        rtos_trigger_context_switch();
-    }
+    rtos_reschedule();
 
     return RTOS_OK;
 }
@@ -233,9 +290,7 @@ rtos_status_t rtos_task_resume(rtos_tcb_t *tcb) {
     rtos_exit_critical(state);
 
     /* If resumed task has higher priority, yield */
-    if (g_kernel.scheduler_running && tcb->priority < g_kernel.current_task->priority) {
-        rtos_trigger_context_switch();
-    }
+    rtos_reschedule();
 
     return RTOS_OK;
 }
@@ -252,7 +307,11 @@ const char *rtos_task_name(rtos_tcb_t *tcb) {
     if (tcb == NULL) {
         tcb = g_kernel.current_task;
     }
+#if RTOS_ENABLE_TASK_NAMES
     return tcb ? tcb->name : "none";
+#else
+    return tcb ? "task" : "none";
+#endif
 }
 
 uint8_t rtos_task_priority(rtos_tcb_t *tcb) {
@@ -267,32 +326,238 @@ uint8_t rtos_task_priority(rtos_tcb_t *tcb) {
 /*---------------------------------------------------------------------------*/
 
 #if RTOS_ENABLE_STACK_CHECK
+/*
+ * High-water tracking: painted words are consumed from the top down, so
+ * the lowest word that no longer holds the marker is the deepest point the
+ * stack has reached. Each stack keeps that index (hwm); a scan only has to
+ * cover [start, hwm), and can be split into chunks since the index only
+ * ever moves down.
+ */
+
+/* Scan up to chunk words from *cursor; returns 1 when the pass is complete */
+static uint8_t stack_scan(const uint32_t *stack, uint32_t *cursor,
+                          uint32_t *hwm, uint32_t chunk) {
+    uint32_t i = *cursor;
+
+    if (i >= *hwm) {
+        return 1;
+    }
+
+    uint32_t limit = (chunk < *hwm - i) ? i + chunk : *hwm;
+
+    while (i < limit && stack[i] == STACK_MARKER) {
+        i++;
+    }
+
+    if (i < limit) {
+        if (i < *hwm) {
+            *hwm = i;
+        }
+        return 1;
+    }
+    *cursor = i;
+    return (i >= *hwm) ? 1 : 0;
+}
+
+static uint8_t task_stack_scan(rtos_tcb_t *tcb, uint32_t *cursor, uint32_t chunk) {
+    uint32_t hwm = tcb->stack_hwm;
+    uint8_t done = stack_scan(tcb->stack_base, cursor, &hwm, chunk);
+
+    tcb->stack_hwm = (uint16_t)hwm;
+    return done;
+}
+
+/* Main stack region, as reserved by linker.ld and painted by Reset_Handler */
+#ifndef MSP_BOTTOM
+extern uint32_t _estack;
+extern uint32_t _Min_Stack_Size;
+
+#define MSP_WORDS       ((uint32_t)&_Min_Stack_Size / sizeof(uint32_t))
+#define MSP_BOTTOM      (&_estack - MSP_WORDS)
+#endif
+
+void rtos_stack_monitor_init(void) {
+    g_kernel.monitor_task = NULL;
+    g_kernel.monitor_cursor = 0;
+    g_kernel.msp_hwm = MSP_WORDS;
+}
+
+/*
+ * One idle-loop step: check up to RTOS_STACK_MONITOR_CHUNK words of the
+ * current stack (the MSP first, then each task in turn). Reads only, so
+ * nothing needs to be locked against the task that owns the stack.
+ */
+void rtos_stack_monitor_step(void) {
+#if RTOS_STACK_PAINT_DEFERRED
+    /* Unpainted words would read as used */
+    if (g_kernel.paint_list != NULL) {
+        return;
+    }
+#endif
+
+    rtos_tcb_t *tcb = g_kernel.monitor_task;
+    uint8_t done;
+
+    if (tcb == NULL) {
+        done = stack_scan(MSP_BOTTOM, &g_kernel.monitor_cursor,
+                          &g_kernel.msp_hwm, RTOS_STACK_MONITOR_CHUNK);
+    } else {
+        done = task_stack_scan(tcb, &g_kernel.monitor_cursor,
+                               RTOS_STACK_MONITOR_CHUNK);
+    }
+
+    if (done) {
+        tcb = (tcb == NULL) ? g_kernel.task_list : tcb->task_next;
+        g_kernel.monitor_task = tcb;
+        g_kernel.monitor_cursor = (tcb != NULL) ? rtos_port_stack_guard_words(tcb) : 0;
+    }
+}
+
 uint32_t rtos_task_stack_unused(rtos_tcb_t *tcb) {
     if (tcb == NULL || tcb->stack_base == NULL) {
         return 0;
     }
 
-    uint32_t *stack = tcb->stack_base;
-    uint32_t unused = 0;
+    /*
+     * Count unused stack words from bottom, starting above the MPU guard
+     * (which is never usable and faults if the task reads its own). With
+     * deferred painting this under-reports until the idle task has reached
+     * the stack.
+     */
+    uint32_t start = rtos_port_stack_guard_words(tcb);
+    uint32_t cursor = start;
+    task_stack_scan(tcb, &cursor, tcb->stack_size);
+
+    return (tcb->stack_hwm - start) * sizeof(uint32_t);  /* Return in bytes */
+}
+
+uint32_t rtos_task_stack_peak(rtos_tcb_t *tcb) {
+    if (tcb == NULL) {
+        return 0;
+    }
+    return (tcb->stack_size - tcb->stack_hwm) * sizeof(uint32_t);
+}
+
+uint32_t rtos_msp_stack_peak(void) {
+    uint32_t cursor = 0;
+    stack_scan(MSP_BOTTOM, &cursor, &g_kernel.msp_hwm, MSP_WORDS);
+
+    return (MSP_WORDS - g_kernel.msp_hwm) * sizeof(uint32_t);
+}
+
+/* Peak plus margin, rounded up to 8 words */
+static uint32_t stack_recommend(uint32_t peak_words) {
+    uint32_t words = peak_words + (peak_words * RTOS_STACK_REPORT_MARGIN + 99) / 100;
+    return (words + 7) & ~7UL;
+}
+
+/*
+ * Formats a C header of stack sizes into the caller's buffer, so it can go
+ * to a file or the console in one write. Sizes are only as good as the
+ * workload that ran before this call.
+ */
+uint32_t rtos_stack_report(char *buf, uint32_t size) {
+    /* Worst-case guard alignment plus the guard itself */
+    uint32_t guard_words = RTOS_ENABLE_MPU_GUARD ?
+                           (2 * RTOS_MPU_GUARD_SIZE) / sizeof(uint32_t) : 0;
+
+    uint32_t len = hal_snprintf(buf, size,
+                                "/* Generated by rtos_stack_report(): peak use + %u%% */\n"
+                                "#ifndef RTOS_STACK_SIZES_H\n#define RTOS_STACK_SIZES_H\n\n",
+                                RTOS_STACK_REPORT_MARGIN);
+
+    uint32_t index = 0;
+
+    for (rtos_tcb_t *tcb = g_kernel.task_list; tcb != NULL; tcb = tcb->task_next) {
+#if RTOS_ENABLE_TASK_NAMES
+        char ident[sizeof(tcb->name)];
+        uint32_t i;
+
+        for (i = 0; tcb->name[i] != '\0' && i < sizeof(ident) - 1; i++) {
+            char c = tcb->name[i];
+            if (c >= 'a' && c <= 'z') {
+                c = (char)(c - 'a' + 'A');
+            } else if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) {
+                c = '_';
+            }
+            ident[i] = c;
+        }
+        ident[i] = '\0';
+#else
+        /* No names: tasks are numbered in creation order */
+        char ident[8] = "TASK";
+        ident[4] = (char)('0' + (index / 10) % 10);
+        ident[5] = (char)('0' + index % 10);
+        ident[6] = '\0';
+#endif
+        index++;
+
+        rtos_task_stack_unused(tcb);
+        uint32_t peak = tcb->stack_size - tcb->stack_hwm;
+        uint32_t words = stack_recommend(peak) + guard_words;
+
+        if (words < RTOS_MIN_STACK_WORDS) {
+            words = RTOS_MIN_STACK_WORDS;
+        }
+        len += hal_snprintf(buf + len, size - len,
+                            "#define STACK_WORDS_%s %u /* peak %u of %u words */\n",
+                            ident, words, peak, tcb->stack_size);
+    }
+
+    uint32_t msp_peak = rtos_msp_stack_peak() / sizeof(uint32_t);
+    len += hal_snprintf(buf + len, size - len,
+                        "\n/* _Min_Stack_Size in linker.ld (bytes), peak %u of %u */\n"
+                        "#define STACK_BYTES_MSP %u\n\n#endif\n",
+                        msp_peak * sizeof(uint32_t), MSP_WORDS * sizeof(uint32_t),
+                        stack_recommend(msp_peak) * sizeof(uint32_t));
+
+    return len;
+}
+
+#if RTOS_STACK_PAINT_DEFERRED
+/*
+ * Paints the next chunk of the oldest unfinished stack. Words the task has
+ * already used are non-zero, so painting stops at the first non-zero word
+ * and the high-water mark stays intact; it also never goes past the saved
+ * (or, for the idle task itself, the live) stack pointer. A zero word at
+ * the deepest point of earlier use is painted over and not counted as used.
+ */
+void rtos_stack_paint_step(void) {
+    uint32_t state = rtos_enter_critical();
+    rtos_tcb_t *tcb = g_kernel.paint_list;
+
+    if (tcb != NULL) {
+        uint32_t *stack = tcb->stack_base;
+        uint32_t *sp = (tcb == g_kernel.current_task) ? (uint32_t *)__get_PSP()
+                                                      : tcb->stack_ptr;
+        uint32_t limit = (sp > stack) ? (uint32_t)(sp - stack) : 0;
+        uint32_t end = tcb->stack_painted + RTOS_STACK_PAINT_CHUNK;
+        uint32_t i = tcb->stack_painted;
+
+        if (end > limit) {
+            end = limit;
+        }
+        while (i < end && stack[i] == 0) {
+            stack[i++] = STACK_MARKER;
+        }
+        tcb->stack_painted = (uint16_t)i;
 
-    /* Count unused stack words from bottom */
-    for (uint32_t i = 0; i < tcb->stack_size; i++) {
-        if (stack[i] == STACK_MARKER) {
-            unused++;
-        } else {
-            break;
+        if (i < end || i >= limit) {
+            g_kernel.paint_list = tcb->paint_next;
+            tcb->paint_next = NULL;
         }
     }
 
-    return unused * sizeof(uint32_t);  /* Return in bytes */
+    rtos_exit_critical(state);
 }
+#endif
 
 uint8_t rtos_task_stack_overflow(rtos_tcb_t *tcb) {
     if (tcb == NULL || tcb->stack_base == NULL) {
         return 0;
     }
 
-    /* Check if bottom of stack was overwritten */
-    return (tcb->stack_base[0] != STACK_MARKER) ? 1 : 0;
+    /* Check if bottom of stack (first word above the guard) was overwritten */
+    return (tcb->stack_base[rtos_port_stack_guard_words(tcb)] != STACK_MARKER) ? 1 : 0;
 }
 #endif
@@ -198,7 +198,7 @@ uint8_t rtos_timer_is_active(rtos_timer_t *timer) {
 /* Timer Tick Processing (called from SysTick ISR) */
 /*---------------------------------------------------------------------------*/
 
-void rtos_timer_tick(void) {
+RTOS_RAMFUNC void rtos_timer_tick(void) {
     /* Process expired timers */
     while (g_kernel.timer_list != NULL) {
         rtos_timer_t *timer = g_kernel.timer_list;
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include "include/stm32f4xx.h"
+#include "rtos_config.h"
 
 /*---------------------------------------------------------------------------*/
 /* External Symbols from Linker Script */
@@ -17,6 +18,15 @@ extern uint32_t _sdata;         /* Start of .data section in RAM */
 extern uint32_t _edata;         /* End of .data section in RAM */
 extern uint32_t _sbss;          /* Start of .bss section */
 extern uint32_t _ebss;          /* End of .bss section */
+extern uint32_t _siramfunc;     /* Start of .ramfunc section in Flash */
+extern uint32_t _sramfunc;      /* Start of .ramfunc section in RAM */
+extern uint32_t _eramfunc;      /* End of .ramfunc section in RAM */
+extern uint32_t _siccmdata;     /* Start of .ccmdata section in Flash */
+extern uint32_t _sccmdata;      /* Start of .ccmdata section in CCM */
+extern uint32_t _eccmdata;      /* End of .ccmdata section in CCM */
+extern uint32_t _sccmbss;       /* Start of .ccmbss section */
+extern uint32_t _eccmbss;       /* End of .ccmbss section */
+extern uint32_t _Min_Stack_Size; /* Main stack size (address = value) */
 
 /*---------------------------------------------------------------------------*/
 /* Function Prototypes */
@@ -53,9 +63,20 @@ void DMA1_Stream4_IRQHandler(void) __attribute__((weak, alias("Default_Handler")
 void DMA1_Stream5_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void DMA1_Stream6_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void ADC_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void EXTI9_5_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA1_Stream7_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA2_Stream0_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA2_Stream1_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA2_Stream2_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA2_Stream3_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA2_Stream4_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA2_Stream5_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA2_Stream6_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DMA2_Stream7_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void USART1_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void USART2_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void USART3_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void EXTI15_10_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 
 /* Main function prototype */
 extern int main(void);
@@ -105,48 +126,181 @@ const void *vector_table[] = {
     DMA1_Stream5_IRQHandler,    /* DMA1 Stream 5 */
     DMA1_Stream6_IRQHandler,    /* DMA1 Stream 6 */
     ADC_IRQHandler,             /* ADC1, ADC2, ADC3 */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
-    0,                          /* Reserved */
+    0,                          /* CAN1 TX */
+    0,                          /* CAN1 RX0 */
+    0,                          /* CAN1 RX1 */
+    0,                          /* CAN1 SCE */
+    EXTI9_5_IRQHandler,         /* EXTI Line[9:5] */
+    0,                          /* TIM1 Break / TIM9 */
+    0,                          /* TIM1 Update / TIM10 */
+    0,                          /* TIM1 Trigger and Commutation / TIM11 */
+    0,                          /* TIM1 Capture Compare */
+    0,                          /* TIM2 */
+    0,                          /* TIM3 */
+    0,                          /* TIM4 */
+    0,                          /* I2C1 Event */
+    0,                          /* I2C1 Error */
+    0,                          /* I2C2 Event */
+    0,                          /* I2C2 Error */
+    0,                          /* SPI1 */
+    0,                          /* SPI2 */
     USART1_IRQHandler,          /* USART1 */
     USART2_IRQHandler,          /* USART2 */
     USART3_IRQHandler,          /* USART3 */
+    EXTI15_10_IRQHandler,       /* EXTI Line[15:10] */
+    0,                          /* RTC Alarm */
+    0,                          /* USB OTG FS Wakeup */
+    0,                          /* TIM8 Break / TIM12 */
+    0,                          /* TIM8 Update / TIM13 */
+    0,                          /* TIM8 Trigger and Commutation / TIM14 */
+    0,                          /* TIM8 Capture Compare */
+    DMA1_Stream7_IRQHandler,    /* DMA1 Stream 7 */
+    0,                          /* FSMC */
+    0,                          /* SDIO */
+    0,                          /* TIM5 */
+    0,                          /* SPI3 */
+    0,                          /* UART4 */
+    0,                          /* UART5 */
+    0,                          /* TIM6 / DAC */
+    0,                          /* TIM7 */
+    DMA2_Stream0_IRQHandler,    /* DMA2 Stream 0 */
+    DMA2_Stream1_IRQHandler,    /* DMA2 Stream 1 */
+    DMA2_Stream2_IRQHandler,    /* DMA2 Stream 2 */
+    DMA2_Stream3_IRQHandler,    /* DMA2 Stream 3 */
+    DMA2_Stream4_IRQHandler,    /* DMA2 Stream 4 */
+    0,                          /* Ethernet */
+    0,                          /* Ethernet Wakeup */
+    0,                          /* CAN2 TX */
+    0,                          /* CAN2 RX0 */
+    0,                          /* CAN2 RX1 */
+    0,                          /* CAN2 SCE */
+    0,                          /* USB OTG FS */
+    DMA2_Stream5_IRQHandler,    /* DMA2 Stream 5 */
+    DMA2_Stream6_IRQHandler,    /* DMA2 Stream 6 */
+    DMA2_Stream7_IRQHandler,    /* DMA2 Stream 7 */
     /* ... more interrupts can be added as needed ... */
 };
 
+/*---------------------------------------------------------------------------*/
+/* RAM Vector Table */
+/*---------------------------------------------------------------------------*/
+#if RTOS_ENABLE_RAM_VECTORS
+/* VTOR needs the table aligned to its size rounded up to a power of two */
+#define VTOR_ALIGN          512
+
+_Static_assert(VECTOR_COUNT * sizeof(uint32_t) <= VTOR_ALIGN,
+               "VTOR_ALIGN too small for the vector table");
+_Static_assert(sizeof(vector_table) <= VECTOR_COUNT * sizeof(uint32_t),
+               "Flash vector table larger than VECTOR_COUNT");
+
+/* Filled from vector_table at reset; rtos_irq_register installs handlers */
+__attribute__((aligned(VTOR_ALIGN)))
+void (*ram_vector_table[VECTOR_COUNT])(void);
+#endif
+
+/*---------------------------------------------------------------------------*/
+/* Section Initialization */
+/*---------------------------------------------------------------------------*/
+
+/* Main stack paint pattern, the same as rtos_task.c uses for task stacks */
+#define MSP_STACK_MARKER    0xDEADBEEF
+#define MSP_PAINT_MARGIN    16      /* Words left below SP for startup_fill */
+
+/*
+ * Sections are word aligned but not burst aligned: four words move per
+ * LDM/STM pair, the remaining zero to three words one at a time. r8 is used
+ * in place of r7, which may be the Thumb frame pointer.
+ */
+static void startup_copy(uint32_t *dst, const uint32_t *src, const uint32_t *end) {
+    const uint32_t *burst_end = dst + ((uint32_t)(end - dst) & ~3UL);
+
+    if (dst < burst_end) {
+        __asm volatile (
+            "1:                         \n"
+            "    ldmia %1!, {r4-r6, r8} \n"
+            "    stmia %0!, {r4-r6, r8} \n"
+            "    cmp   %0, %2           \n"
+            "    bne   1b               \n"
+            : "+r" (dst), "+r" (src)
+            : "r" (burst_end)
+            : "r4", "r5", "r6", "r8", "cc", "memory"
+        );
+    }
+    while (dst < end) {
+        *dst++ = *src++;
+    }
+}
+
+static void startup_fill(uint32_t *dst, const uint32_t *end, uint32_t value) {
+    const uint32_t *burst_end = dst + ((uint32_t)(end - dst) & ~3UL);
+
+    if (dst < burst_end) {
+        __asm volatile (
+            "    mov   r4, %2           \n"
+            "    mov   r5, %2           \n"
+            "    mov   r6, %2           \n"
+            "    mov   r8, %2           \n"
+            "1:                         \n"
+            "    stmia %0!, {r4-r6, r8} \n"
+            "    cmp   %0, %1           \n"
+            "    bne   1b               \n"
+            : "+r" (dst)
+            : "r" (burst_end), "r" (value)
+            : "r4", "r5", "r6", "r8", "cc", "memory"
+        );
+    }
+    while (dst < end) {
+        *dst++ = value;
+    }
+}
+
 /*---------------------------------------------------------------------------*/
 /* Reset Handler - Entry Point */
 /*---------------------------------------------------------------------------*/
 void Reset_Handler(void) {
-    uint32_t *src, *dst;
+#if RTOS_ENABLE_BOOT_PROFILE
+    /* Start the cycle counter first so the boot hook sees the whole boot */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+
+    /* Copy RAM-resident code before anything can call it */
+    startup_copy(&_sramfunc, &_siramfunc, &_eramfunc);
 
     /* Copy .data section from Flash to RAM */
-    src = &_sidata;
-    dst = &_sdata;
-    while (dst < &_edata) {
-        *dst++ = *src++;
-    }
+    startup_copy(&_sdata, &_sidata, &_edata);
 
     /* Zero fill .bss section */
-    dst = &_sbss;
-    while (dst < &_ebss) {
-        *dst++ = 0;
+    startup_fill(&_sbss, &_ebss, 0);
+
+    /* Same for the core-coupled RAM (always clocked, no enable needed) */
+    startup_copy(&_sccmdata, &_siccmdata, &_eccmdata);
+    startup_fill(&_sccmbss, &_eccmbss, 0);
+
+#if RTOS_ENABLE_RAM_VECTORS
+    /* Vector fetches from SRAM, then unlisted IRQs default like the rest */
+    uint32_t flash_count = sizeof(vector_table) / sizeof(vector_table[0]);
+
+    startup_copy((uint32_t *)ram_vector_table, (const uint32_t *)vector_table,
+                 (const uint32_t *)&ram_vector_table[flash_count]);
+    for (uint32_t i = 1; i < VECTOR_COUNT; i++) {
+        if (ram_vector_table[i] == 0) {
+            ram_vector_table[i] = Default_Handler;
+        }
     }
 
+    SCB->VTOR = (uint32_t)ram_vector_table;
+    __DSB();
+    __ISB();
+#endif
+
+#if RTOS_ENABLE_STACK_CHECK
+    /* Paint the unused main stack for the kernel's MSP high-water mark */
+    startup_fill(&_estack - ((uint32_t)&_Min_Stack_Size / sizeof(uint32_t)),
+                 (uint32_t *)__get_MSP() - MSP_PAINT_MARGIN, MSP_STACK_MARKER);
+#endif
+
     /* Enable FPU (Cortex-M4 with FPU) */
     /* SCB->CPACR |= ((3UL << 10*2) | (3UL << 11*2)); */
     /* Note: Not using FPU in this RTOS for simplicity */
@@ -199,6 +353,10 @@ void SystemInit(void) {
     /* Reset RCC configuration to default state */
     /* This is optional as QEMU starts with a known state */
 
-    /* Set vector table offset to Flash base */
+    /* Set vector table offset to the active table */
+#if RTOS_ENABLE_RAM_VECTORS
+    SCB->VTOR = (uint32_t)ram_vector_table;
+#else
     SCB->VTOR = 0x08000000;
+#endif
 }